@@ -61,10 +61,27 @@
 #define TEMP_SENSOR_CASCADED_FILTER 1
 #endif
 
+/**
+ * Cascaded temp sensor filters are compiled for each b value, so they shift by constant amounts (see FilterCascadedT.h).
+ * This is faster, at the cost of a copy of the filter code per b value. Filter settings above CASCADED_FILTER_MAX_B
+ * are rejected. Off on the AVR, which doesn't have the flash.
+ */
+#ifndef TEMP_SENSOR_CONSTANT_SHIFT_FILTER
+#define TEMP_SENSOR_CONSTANT_SHIFT_FILTER 1
+#endif
+
 #ifndef TEMP_CONTROL_STATIC
 #define TEMP_CONTROL_STATIC 1
 #endif
 
+/**
+ * Storage class of the ticks object. Host tools that run a controller in each thread make it thread_local,
+ * so every controller has its own clock.
+ */
+#ifndef BREWPI_THREAD_LOCAL
+#define BREWPI_THREAD_LOCAL
+#endif
+
 /**
  * Enable the simulator. Real sensors/actuators are replaced with simulated versions. In particular, the values reported by
  * temp sensors are based on a model of the fridge/beer.
@@ -73,6 +90,89 @@
 #define BREWPI_SIMULATE 0
 #endif
 
+/**
+ * Support the binary framed piLink protocol, see PiLinkFrames.h.
+ */
+#ifndef BREWPI_PILINK_FRAMES
+#define BREWPI_PILINK_FRAMES 1
+#endif
+
+/**
+ * Push subscribed values to the host every control period, see the 'P' command.
+ */
+#ifndef BREWPI_TELEMETRY
+#define BREWPI_TELEMETRY 1
+#endif
+
+/**
+ * Buffer the piLink output in RAM and send it from the main loop, so long responses don't block the control task.
+ * See PiLinkTxBuffer.h.
+ */
+#ifndef BREWPI_PILINK_TX_BUFFER
+#define BREWPI_PILINK_TX_BUFFER 1
+#endif
+
+/**
+ * Set to 1 when the serial port has availableForWrite(), as HardwareSerial has from Arduino 1.6.6. The transmit
+ * buffer then sends no more than the port has room for, and never blocks. Without it, a fixed PILINK_TX_CHUNK is sent
+ * on each pass.
+ */
+#ifndef PILINK_PORT_AVAILABLE_FOR_WRITE
+#define PILINK_PORT_AVAILABLE_FOR_WRITE 0
+#endif
+
+/**
+ * Accept an array of device definitions in one 'U' command, validated together and installed in one pass.
+ */
+#ifndef BREWPI_DEVICE_BATCH
+#define BREWPI_DEVICE_BATCH 1
+#endif
+
+/**
+ * Keep a copy of the device table in RAM, indexed by hardware location, so listing devices and matching the devices
+ * found in a hardware scan don't read the eeprom for every slot.
+ */
+#ifndef BREWPI_DEVICE_CACHE
+#define BREWPI_DEVICE_CACHE 1
+#endif
+
+/**
+ * Store the settings and constants as records in a journal that moves through the eeprom, see EepromJournal.h,
+ * instead of rewriting the same cells on every change.
+ */
+#ifndef BREWPI_EEPROM_JOURNAL
+#define BREWPI_EEPROM_JOURNAL 1
+#endif
+
+/**
+ * Milliseconds the settings and constants have to be unchanged before they are written to the eeprom, so a series of
+ * changes, such as a temperature profile or the self learning estimators, is written once. 0 writes every change
+ * right away. The 'W' command writes the changes immediately.
+ */
+#ifndef BREWPI_EEPROM_FLUSH_DELAY
+#define BREWPI_EEPROM_FLUSH_DELAY 5000
+#endif
+
+/**
+ * Store the devices as tag-length-value records (eeprom format 5), so only configured devices take space and there
+ * can be more device slots. Needs the device cache and the journal. Without it, the fixed format 4 layout is used.
+ */
+#ifndef BREWPI_EEPROM_TLV
+#define BREWPI_EEPROM_TLV (BREWPI_DEVICE_CACHE && BREWPI_EEPROM_JOURNAL)
+#endif
+
+/**
+ * Number of device slots. Format 4 has room for 16. With records, the number of devices that fit depends on their
+ * type: a pin device takes 10 bytes and a onewire device 19, out of about 700.
+ */
+#ifndef BREWPI_DEVICE_SLOTS
+#if BREWPI_EEPROM_TLV
+#define BREWPI_DEVICE_SLOTS 64
+#else
+#define BREWPI_DEVICE_SLOTS 16
+#endif
+#endif
+
 #ifndef BREWPI_EEPROM_HELPER_COMMANDS
 #define BREWPI_EEPROM_HELPER_COMMANDS BREWPI_DEBUG || BREWPI_SIMULATE
 #endif
@@ -99,3 +199,26 @@
 #ifndef DISPLAY_TIME_HMS
 #define DISPLAY_TIME_HMS 1
 #endif
+
+/**
+ * Periods in milliseconds of the tasks run by the main loop.
+ * The control algorithm is tuned for one update per second, so only change the control period when simulating.
+ */
+#ifndef BREWPI_CONTROL_PERIOD
+#define BREWPI_CONTROL_PERIOD 1000
+#endif
+
+#ifndef BREWPI_UI_PERIOD
+#define BREWPI_UI_PERIOD 200
+#endif
+
+#ifndef BREWPI_DISPLAY_PERIOD
+#define BREWPI_DISPLAY_PERIOD 1000
+#endif
+
+/**
+ * Measure how long each phase of the main loop takes. The statistics are requested with the 'm' command.
+ */
+#ifndef BREWPI_LOOP_TIMING
+#define BREWPI_LOOP_TIMING 1
+#endif
@@ -37,6 +37,8 @@
 #include "Sensor.h"
 #include "SettingsManager.h"
 #include "UI.h"
+#include "Scheduler.h"
+#include "LoopTiming.h"
 
 #if BREWPI_SIMULATE
 	#include "Simulator.h"
@@ -52,7 +54,7 @@ void loop (void);
 
 /* Configure the counter and delay timer. The actual type of these will vary depending upon the environment.
  * They are non-virtual to keep code size minimal, so typedefs and preprocessing are used to select the actual compile-time type used. */
-TicksImpl ticks = TicksImpl(TICKS_IMPL_CONFIG);
+BREWPI_THREAD_LOCAL TicksImpl ticks = TicksImpl(TICKS_IMPL_CONFIG);
 DelayImpl wait = DelayImpl(DELAY_IMPL_CONFIG);
 
 DisplayType realDisplay;
@@ -61,6 +63,66 @@ DisplayType DISPLAY_REF display = realDisplay;
 ValueActuator alarm;
 UI ui;
 
+/*
+ * The control algorithm relies on being updated once per second: the filters and the integrator assume a fixed timestep.
+ * When the control task is delayed, it runs again to catch up on up to 2 missed updates.
+ */
+static void controlTask(void)
+{
+	uint8_t oldState;
+
+	TIME_PHASE(PHASE_UPDATE_TEMPERATURES, tempControl.updateTemperatures());
+	TIME_PHASE(PHASE_DETECT_PEAKS, tempControl.detectPeaks());
+	TIME_PHASE(PHASE_UPDATE_PID, tempControl.updatePID());
+	oldState = tempControl.getState();
+	TIME_PHASE(PHASE_UPDATE_STATE, tempControl.updateState());
+	if(oldState != tempControl.getState()){
+		piLink.printTemperatures(); // add a data point at every state transition
+	}
+	TIME_PHASE(PHASE_UPDATE_OUTPUTS, tempControl.updateOutputs());
+#if BREWPI_TELEMETRY
+	piLink.pushTelemetry();
+#endif
+}
+
+static void uiTask(void)
+{
+	TIME_PHASE(PHASE_UI, ui.update());
+}
+
+static void updateDisplay(void)
+{
+	// update the lcd for the chamber being displayed
+	display.printState();
+	display.printAllTemperatures();
+	display.printMode();
+	display.updateBacklight();
+}
+
+static void displayTask(void)
+{
+	TIME_PHASE(PHASE_DISPLAY, updateDisplay());
+}
+
+static void serialTask(void)
+{
+	TIME_PHASE(PHASE_RECEIVE, piLink.receive());
+	TIME_PHASE(PHASE_TRANSMIT, piLink.transmit());
+}
+
+static void eepromTask(void)
+{
+	TIME_PHASE(PHASE_EEPROM, eepromManager.update());
+}
+
+static ScheduledTask brewpiTasks[] = {
+	SCHEDULED_TASK(controlTask, BREWPI_CONTROL_PERIOD, 100, 2),
+	SCHEDULED_TASK(uiTask, BREWPI_UI_PERIOD, BREWPI_UI_PERIOD, 0),
+	SCHEDULED_TASK(displayTask, BREWPI_DISPLAY_PERIOD, 500, 0),
+	SCHEDULED_TASK(eepromTask, 1000, 1000, 0),		// writes the changed settings, see BREWPI_EEPROM_FLUSH_DELAY
+	SCHEDULED_TASK(serialTask, 0, 0, 0)		// listen for incoming serial data and send output on every pass
+};
+
 void setup()
 {
 	ui.init();
@@ -80,6 +142,8 @@ void setup()
 	display.init();
 	display.printStationaryText();
 	display.printState();
+
+	Scheduler::init(brewpiTasks, SCHEDULED_TASK_COUNT(brewpiTasks), ticks.millis());
 			
 	logDebug("init complete");
 }
@@ -87,34 +151,7 @@ void setup()
 
 void brewpiLoop(void)
 {
-	static unsigned long lastUpdate = 0;
-	uint8_t oldState;
-			
-	if(ticks.millis() - lastUpdate >= (1000)) { //update settings every second
-		lastUpdate = ticks.millis();
-			
-		tempControl.updateTemperatures();
-		tempControl.detectPeaks();
-		tempControl.updatePID();
-		oldState = tempControl.getState();
-		tempControl.updateState();
-		if(oldState != tempControl.getState()){
-			piLink.printTemperatures(); // add a data point at every state transition
-		}
-		tempControl.updateOutputs();
-
-		ui.update();
-
-		// update the lcd for the chamber being displayed
-		display.printState();
-		display.printAllTemperatures();
-		display.printMode();
-		display.updateBacklight();		
-	}	
-
-	//listen for incoming serial connections while waiting to update
-	piLink.receive();
-
+	Scheduler::run(brewpiTasks, SCHEDULED_TASK_COUNT(brewpiTasks), ticks.millis());
 }
 
 void loop() {
@@ -60,6 +60,17 @@
 
 #include "Platform.h"
 
+/*
+ * printf conversion for a string stored with PROGMEM. Without PROGMEM, strings are in RAM and %S would print a wide string.
+ */
+#ifndef PRINTF_PROGMEM_STRING
+#ifdef ARDUINO
+#define PRINTF_PROGMEM_STRING "%S"
+#else
+#define PRINTF_PROGMEM_STRING "%s"
+#endif
+#endif
+
 #include "Actuator.h"
 
 extern ValueActuator alarm;
@@ -0,0 +1,34 @@
+/*
+ * Copyright 2013 BrewPi/Elco Jacobs.
+ * Copyright 2013 Matthew McGowan
+ *
+ * This file is part of BrewPi.
+ * 
+ * BrewPi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * BrewPi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with BrewPi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "Brewpi.h"
+
+/**
+ * Adds a byte to a CRC-16/CCITT (polynomial 0x1021). Start with 0xFFFF.
+ */
+inline uint16_t crc16Update(uint16_t crc, uint8_t data)
+{
+	crc ^= uint16_t(data)<<8;
+	for (uint8_t i=0; i<8; i++)
+		crc = (crc & 0x8000) ? (crc<<1) ^ 0x1021 : (crc<<1);
+	return crc;
+}
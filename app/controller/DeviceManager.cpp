@@ -27,7 +27,10 @@
 #include "TempSensorDisconnected.h"
 #include "TempSensorExternal.h"
 #include "PiLink.h"
+#include "PiLinkFrames.h"
+#include "JsonWriter.h"
 #include "EepromFormat.h"
+#include "EepromRecords.h"
 
 #define CALIBRATION_OFFSET_PRECISION (4)
 
@@ -332,6 +335,7 @@ const char DEVICE_ATTRIB_PIO = 'n';
 const char DEVICE_ATTRIB_CALIBRATEADJUST = 'j';	// value to add to temp sensors to bring to correct temperature
 
 const char DEVICE_ATTRIB_VALUE = 'v';		// print current values
+const char DEVICE_ATTRIB_VALUE_AGE = 'g';	// milliseconds since the value was read
 const char DEVICE_ATTRIB_WRITE = 'w';		// write value to device
 
 const char DEVICE_ATTRIB_TYPE = 't';
@@ -367,25 +371,30 @@ void assignIfSet(int8_t value, uint8_t* target) {
 }
 
 /**
- * Updates the device definition. Only changes that result in a valid device, with no conflicts with other devices
- * are allowed. 
+ * Reads the device in the slot. A device that can't be read is cleared, so it is seen as unused.
  */
-void DeviceManager::parseDeviceDefinition(Stream& p)
-{	
+static void fetchDeviceOrClear(DeviceConfig& config, uint8_t slot)
+{
+	if (!eepromManager.fetchDevice(config, slot))
+		clear((uint8_t*)&config, sizeof(config));
+}
+
+/**
+ * Reads the device definition in the received JSON and applies it to the device in its slot, without installing it.
+ * Returns the slot, or -1 when no valid slot is given.
+ */
+static int8_t readDeviceDefinition(DeviceConfig& target, DeviceConfig& original)
+{
 	static DeviceDefinition dev;
 	fill((int8_t*)&dev, sizeof(dev));
 	
 	piLink.parseJson(&handleDeviceDefinition, &dev);
 	
-	if (!inRangeInt8(dev.id, 0, MAX_DEVICE_SLOT))			// no device id given, or it's out of range, can't do anything else.
-		return;
-	
-	// save the original device so we can revert
-	DeviceConfig target;
-	DeviceConfig original;
+	if (!inRangeInt8(dev.id, 0, MAX_DEVICE_SLOT-1))			// no device id given, or it's out of range, can't do anything else.
+		return -1;
 	
 	// todo - should ideally check if the eeprom is correctly initialized.
-	eepromManager.fetchDevice(original, dev.id);
+	fetchDeviceOrClear(original, dev.id);
 	memcpy(&target, &original, sizeof(target));
 	
 	assignIfSet(dev.chamber, &target.chamber);
@@ -413,8 +422,29 @@ void DeviceManager::parseDeviceDefinition(Stream& p)
 	if (target.deviceFunction==DEVICE_NONE) {
 		clear((uint8_t*)&target, sizeof(target));
 	}
+	return dev.id;
+}
+
+/**
+ * Updates the device definition. Only changes that result in a valid device, with no conflicts with other devices
+ * are allowed. 
+ */
+void DeviceManager::parseDeviceDefinition(Stream& p)
+{	
+	// save the original device so we can revert
+	DeviceConfig target;
+	DeviceConfig original;
+	int8_t id = readDeviceDefinition(target, original);
+	if (id<0)
+		return;
 	
-	bool valid = isDeviceValid(target, original, dev.id);
+	bool valid = isDeviceValid(target, original, id);
+#if BREWPI_EEPROM_TLV
+	if (valid && EepromRecords::deviceSize(target)>EepromRecords::deviceSize(original)+eepromManager.deviceRoomLeft()) {
+		logErrorInt(ERROR_NO_ROOM_FOR_DEVICE, id);
+		valid = false;
+	}
+#endif
 	DeviceConfig* print = &original;
 	if (valid) {		
 		print = &target;
@@ -423,17 +453,188 @@ void DeviceManager::parseDeviceDefinition(Stream& p)
 		// also remove any existing device for the new function, since install overwrites any existing definition.
 		uninstallDevice(target);
 		installDevice(target);		
-		eepromManager.storeDevice(target, dev.id);		
+		eepromManager.storeDevice(target, id);		
 	}	
 	else {
 		logError(ERROR_DEVICE_DEFINITION_UPDATE_SPEC_INVALID);
 	}
-	piLink.printResponse('U');
+	piLink.openDeviceResponse('U', false);
 	deviceManager.beginDeviceOutput();
-	deviceManager.printDevice(dev.id, *print, NULL, p);
-	piLink.printNewLine();
+	deviceManager.printDevice(id, *print, NULL, p);
+	piLink.closeDeviceResponse();
+}
+
+#if BREWPI_DEVICE_BATCH
+
+static DeviceConfig batchDevices[MAX_DEVICE_SLOT];	// the new definitions, by slot
+static uint8_t batchSlots[(MAX_DEVICE_SLOT+7)/8];		// bit per slot in the batch
+static bool batchValid;
+
+static bool inBatch(uint8_t slot)
+{
+	return batchSlots[slot>>3] & (1<<(slot&7));
+}
+
+void DeviceManager::beginDeviceBatch()
+{
+	memset(batchSlots, 0, sizeof(batchSlots));
+	batchValid = true;
+}
+
+void DeviceManager::addDeviceBatchEntry()
+{
+	DeviceConfig target;
+	DeviceConfig original;
+	int8_t id = readDeviceDefinition(target, original);
+	if (id<0 || inBatch(id)) {
+		logErrorInt(ERROR_INVALID_DEVICE_SLOT, id);
+		batchValid = false;
+		return;
+	}
+	memcpy(&batchDevices[id], &target, sizeof(target));
+	batchSlots[id>>3] |= 1<<(id&7);
+	if (!isDeviceValid(target, original, id))
+		batchValid = false;
+}
+
+void DeviceManager::rejectDeviceBatch()
+{
+	batchValid = false;
+}
+
+/**
+ * The definition of the device in the slot once the batch is applied.
+ */
+static void batchDevice(DeviceConfig& config, uint8_t slot)
+{
+	if (inBatch(slot))
+		memcpy(&config, &batchDevices[slot], sizeof(config));
+	else
+		fetchDeviceOrClear(config, slot);
+}
+
+#if BREWPI_EEPROM_TLV
+/**
+ * Bytes the record of the device in the slot grows by when the batch is applied.
+ */
+static int8_t batchGrowth(uint8_t slot)
+{
+	DeviceConfig stored;
+	fetchDeviceOrClear(stored, slot);
+	return EepromRecords::deviceSize(batchDevices[slot])-EepromRecords::deviceSize(stored);
+}
+#endif
+
+/**
+ * Checks that the devices in the batch don't share a function or hardware with each other or with the other devices.
+ */
+bool DeviceManager::isDeviceBatchValid()
+{
+	if (!batchValid)
+		return false;
+	DeviceConfig config;
+	DeviceConfig other;
+	for (uint8_t slot=0; slot<MAX_DEVICE_SLOT; slot++) {
+		if (!inBatch(slot))
+			continue;
+		batchDevice(config, slot);
+		if (config.deviceFunction==DEVICE_NONE || config.hw.deactivate)
+			continue;
+		for (uint8_t otherSlot=0; otherSlot<MAX_DEVICE_SLOT; otherSlot++) {
+			if (otherSlot==slot)
+				continue;
+			batchDevice(other, otherSlot);
+			if (other.deviceFunction==DEVICE_NONE || other.hw.deactivate)
+				continue;
+			if (config.deviceFunction==other.deviceFunction && config.chamber==other.chamber && config.beer==other.beer) {
+				logErrorIntInt(ERROR_DUPLICATE_DEVICE_FUNCTION, config.deviceFunction, otherSlot);
+				return false;
+			}
+			if (config.deviceHardware!=other.deviceHardware || config.hw.pinNr!=other.hw.pinNr)
+				continue;
+			bool sameHardware = config.deviceHardware==DEVICE_HARDWARE_PIN
+				|| (config.hw.address[0] && memcmp(config.hw.address, other.hw.address, sizeof(DeviceAddress))==0
+#if BREWPI_DS2413
+					&& (config.deviceHardware!=DEVICE_HARDWARE_ONEWIRE_2413 || config.hw.pio==other.hw.pio)
+#endif
+				);
+			if (sameHardware) {
+				logErrorIntInt(ERROR_DUPLICATE_DEVICE_HARDWARE, slot, otherSlot);
+				return false;
+			}
+		}
+	}
+#if BREWPI_EEPROM_TLV
+	// the batch is stored in one go, so only the total growth has to fit
+	int16_t growth = 0;
+	uint8_t grownSlot = 0;
+	for (uint8_t slot=0; slot<MAX_DEVICE_SLOT; slot++) {
+		if (!inBatch(slot))
+			continue;
+		int8_t slotGrowth = batchGrowth(slot);
+		if (slotGrowth>0)
+			grownSlot = slot;		// reported when the batch doesn't fit
+		growth += slotGrowth;
+	}
+	if (growth>int16_t(eepromManager.deviceRoomLeft())) {
+		logErrorInt(ERROR_NO_ROOM_FOR_DEVICE, grownSlot);
+		return false;
+	}
+#endif
+	return true;
 }
 
+/**
+ * Installs the devices in the batch when they are valid together, and replies with their definitions.
+ * All previous devices are removed before the new ones are installed, so functions can move between slots.
+ */
+void DeviceManager::applyDeviceBatch(Print& p)
+{
+	bool valid = isDeviceBatchValid();
+	DeviceConfig original;
+	if (valid) {
+		for (uint8_t slot=0; slot<MAX_DEVICE_SLOT; slot++) {
+			if (inBatch(slot)) {
+				fetchDeviceOrClear(original, slot);
+				uninstallDevice(original);
+			}
+		}
+		for (uint8_t slot=0; slot<MAX_DEVICE_SLOT; slot++) {
+			if (inBatch(slot)) {
+				uninstallDevice(batchDevices[slot]);
+				installDevice(batchDevices[slot]);
+			}
+		}
+#if BREWPI_EEPROM_TLV
+		eepromManager.storeDevices(batchDevices, batchSlots);
+#else
+		for (uint8_t slot=0; slot<MAX_DEVICE_SLOT; slot++) {
+			if (inBatch(slot))
+				eepromManager.storeDevice(batchDevices[slot], slot);
+		}
+#endif
+	}
+	else {
+		logError(ERROR_DEVICE_DEFINITION_UPDATE_SPEC_INVALID);
+	}
+	piLink.openDeviceResponse('U', true);
+	beginDeviceOutput();
+	for (uint8_t slot=0; slot<MAX_DEVICE_SLOT; slot++) {
+		if (inBatch(slot)) {
+			DeviceConfig* print = &batchDevices[slot];
+			if (!valid) {
+				fetchDeviceOrClear(original, slot);
+				print = &original;
+			}
+			printDevice(slot, *print, NULL, p);
+		}
+	}
+	piLink.closeDeviceResponse();
+	memset(batchSlots, 0, sizeof(batchSlots));
+}
+
+#endif
+
 /**
  * Determines if a given device definition is valid.
  * chamber/beer must be within bounds
@@ -480,7 +681,7 @@ bool DeviceManager::isDeviceValid(DeviceConfig& config, DeviceConfig& original,
 		
 	// todo - find device at another index with the same chamber/beer/function spec.
 	// with duplicate function defined for the same beer, that they will both try to create/delete the device in the target location. 
-	// The highest id will win.	
+	// The highest id will win. A device batch checks this, see isDeviceBatchValid().
 	DeviceType dt = deviceType(config.deviceFunction);
 	if (!isAssignable(dt, config.deviceHardware)) {
 		logErrorIntInt(ERROR_CANNOT_ASSIGN_TO_HARDWARE, dt, config.deviceHardware);
@@ -503,6 +704,7 @@ bool DeviceManager::isDeviceValid(DeviceConfig& config, DeviceConfig& original,
 #endif
 	// todo - for onewire temp, ensure address is unique	
 	// todo - for onewire 2413 check address+pio nr is unique
+	// (a device batch checks both, and pin uniqueness)
 	return true;
 }	
 
@@ -511,9 +713,11 @@ void printAttrib(Print& p, char c, int8_t val, bool first=false)
 	if (!first)
         	p.print(',');
 
-	char tempString[32]; // resulting string limited to 128 chars
-	sprintf_P(tempString, PSTR("\"%c\":%d"), c, val);
-	p.print(tempString);
+	p.print('"');
+	p.print(c);
+	p.print('"');
+	p.print(':');
+	JsonWriter::writeSigned(p, val);
 }
 
 inline bool hasInvert(DeviceHardware hw)
@@ -534,11 +738,32 @@ inline bool hasOnewire(DeviceHardware hw)
 	hw==DEVICE_HARDWARE_ONEWIRE_TEMP;
 }
 
-void DeviceManager::printDevice(device_slot_t slot, DeviceConfig& config, const char* value, Print& p)
+void DeviceManager::printDevice(device_slot_t slot, DeviceConfig& config, const char* value, Print& p, uint16_t valueAge)
 {	
 	char buf[17];
 
 	DeviceType dt = deviceType(config.deviceFunction);
+#if BREWPI_PILINK_FRAMES
+	if (piLink.isFramed()) {
+		PiLinkFrames::begin(piLink.deviceResponseType());
+		PiLinkFrames::write(slot);
+		PiLinkFrames::write(dt);
+		PiLinkFrames::write(config.chamber);
+		PiLinkFrames::write(config.beer);
+		PiLinkFrames::write(config.deviceFunction);
+		PiLinkFrames::write(config.deviceHardware);
+		PiLinkFrames::write(config.hw.pinNr);
+		PiLinkFrames::write(config.hw.invert);
+		PiLinkFrames::write(config.hw.deactivate);
+		for (uint8_t i=0; i<sizeof(config.hw.address); i++)
+			PiLinkFrames::write(config.hw.address[i]);
+		PiLinkFrames::write(config.hw.calibration);
+		PiLinkFrames::writeString(value);
+		PiLinkFrames::write16(valueAge);
+		PiLinkFrames::end();
+		return;
+	}
+#endif
 	if (!firstDeviceOutput) {
 		// p.print('\n');
 		p.print(',');
@@ -557,6 +782,10 @@ void DeviceManager::printDevice(device_slot_t slot, DeviceConfig& config, const
 	if (value && *value) {
 		p.print(",\"v\":");
 		p.print(value);
+		if (valueAge!=DEVICE_VALUE_AGE_UNKNOWN) {
+			p.print(",\"g\":");
+			JsonWriter::writeUnsigned(p, valueAge);
+		}
 	}
 	if (hasInvert(config.deviceHardware))	
 		printAttrib(p, DEVICE_ATTRIB_INVERT, config.hw.invert);
@@ -573,9 +802,8 @@ void DeviceManager::printDevice(device_slot_t slot, DeviceConfig& config, const
 	}
 #endif	
 	if (config.deviceHardware==DEVICE_HARDWARE_ONEWIRE_TEMP) {
-		tempDiffToString(buf, temperature(config.hw.calibration)<<(TEMP_FIXED_POINT_BITS-CALIBRATION_OFFSET_PRECISION), 3, 8);
 		p.print(",\"j\":");
-		p.print(buf);
+		JsonWriter::writeTempDiff(p, temperature(config.hw.calibration)<<(TEMP_FIXED_POINT_BITS-CALIBRATION_OFFSET_PRECISION), 3);
 	}
 	p.print('}');
 }	
@@ -609,7 +837,7 @@ void printBytes(uint8_t* data, uint8_t len, char* buf) // prints 8-bit data in h
 void DeviceManager::OutputEnumeratedDevices(DeviceConfig* config, void* pv)
 {
 	DeviceOutput* out = (DeviceOutput*)pv;
-	printDevice(out->slot, *config, out->value, *out->pp);
+	printDevice(out->slot, *config, out->value, *out->pp, out->valueAge);
 }
 
 bool DeviceManager::enumDevice(DeviceDisplay& dd, DeviceConfig& dc, uint8_t idx)
@@ -659,6 +887,9 @@ inline bool matchAddress(uint8_t* detected, uint8_t* configured, uint8_t count)
  */
 device_slot_t findHardwareDevice(DeviceConfig& find)
 {
+#if BREWPI_DEVICE_CACHE
+	return eepromManager.findDevice(find);
+#else
 	DeviceConfig config;
 	for (device_slot_t slot= 0; deviceManager.allDevices(config, slot); slot++) {
 		if (find.deviceHardware==config.deviceHardware) {
@@ -682,22 +913,44 @@ device_slot_t findHardwareDevice(DeviceConfig& find)
 		}
 	}
 	return INVALID_SLOT;
+#endif
 }
 
+/**
+ * Reads the value of a onewire temp sensor in a hardware scan. The bus was converted once at the start of the scan,
+ * see OneWireConversionScheduler::convertForScan(), so this only reads the scratchpad.
+ */
 inline void DeviceManager::readTempSensorValue(DeviceConfig::Hardware hw, char* out)
 {
 #if !BREWPI_SIMULATE
-	OneWire* bus = oneWireBus(hw.pinNr);
-	OneWireTempSensor sensor(bus, hw.address, 0);		// NB: this value is uncalibrated, since we don't have the calibration offset until the device is configured
+	DallasTemperature sensor(oneWireBus(hw.pinNr));
 	temperature temp = INVALID_TEMP;
-	if (sensor.init())
-		temp = sensor.read();
+#if ONEWIRE_PARASITE_SUPPORT
+	if (sensor.initConnection(hw.address))	// otherwise the scan has initialized the sensor when checking its power
+#endif
+	{
+		temperature raw = sensor.getTempRaw(hw.address);
+		if (raw!=DEVICE_DISCONNECTED)
+			temp = OneWireTempSensor::rawToTemp(raw, 0);	// NB: this value is uncalibrated, since we don't have the calibration offset until the device is configured
+	}
 	tempToString(out, temp, 3, 9);
 #else
 	strcpy_P(out, PSTR("0.00"));
 #endif	
 }
 
+/**
+ * Age of the value of an installed onewire temp sensor, which is read from the conversion cache of its bus.
+ */
+uint16_t DeviceManager::tempSensorValueAge(DeviceConfig::Hardware hw)
+{
+#if !BREWPI_SIMULATE
+	return OneWireConversionScheduler::valueAge(oneWireBus(hw.pinNr));
+#else
+	return DEVICE_VALUE_AGE_UNKNOWN;
+#endif
+}
+
 void DeviceManager::handleEnumeratedDevice(DeviceConfig& config, EnumerateHardware& h, EnumDevicesCallback callback, DeviceOutput& out)
 {
 	if (h.function && !isAssignable(deviceType(DeviceFunction(h.function)), config.deviceHardware)) 
@@ -715,11 +968,18 @@ void DeviceManager::handleEnumeratedDevice(DeviceConfig& config, EnumerateHardwa
 	}
 	
 	out.value[0] = 0;
+	out.valueAge = DEVICE_VALUE_AGE_UNKNOWN;
 	if (h.values) {
 //		logDebug("Fetching device value");
 		switch (config.deviceHardware) {
 			case DEVICE_HARDWARE_ONEWIRE_TEMP:
 				readTempSensorValue(config.hw, out.value);
+#if !BREWPI_SIMULATE
+				{
+					ticks_millis_t age = ticks.millis()-out.valueTime;
+					out.valueAge = age<DEVICE_VALUE_AGE_UNKNOWN ? uint16_t(age) : DEVICE_VALUE_AGE_UNKNOWN-1;
+				}
+#endif
 				break;
 			// unassigned pins could be input or output so we can't determine any other details from here.
 			// values can be read once the pin has been assigned a function
@@ -769,6 +1029,9 @@ void DeviceManager::enumerateOneWireDevices(EnumerateHardware& h, EnumDevicesCal
 //		logDebug("Enumerating one-wire devices on pin %d", pin);				
 		OneWire* wire = oneWireBus(pin);	
 		if (wire!=NULL) {
+			// one conversion for all temp sensors on the bus, rather than one per sensor
+			if (h.values)
+				output.valueTime = OneWireConversionScheduler::convertForScan(wire);
 			wire->reset_search();
 			while (wire->search(config.hw.address)) {
 				// hardware device type from OneWire family ID
@@ -872,7 +1135,8 @@ void UpdateDeviceState(DeviceDisplay& dd, DeviceConfig& dc, char* val)
 	}
 	else if (dd.value==1) {		// read values 
 		if (dt==DEVICETYPE_SWITCH_SENSOR) {
-			sprintf_P(val, STR_FMT_U, (unsigned int) ((SwitchSensor*)*ppv)->sense()!=0); // cheaper than itoa, because it overlaps with vsnprintf
+			val[0] = ((SwitchSensor*)*ppv)->sense() ? '1' : '0';
+			val[1] = 0;
 		}
 		else if (dt==DEVICETYPE_TEMP_SENSOR) {
 			BasicTempSensor& s = unwrapSensor(dc.deviceFunction, *ppv);
@@ -880,7 +1144,8 @@ void UpdateDeviceState(DeviceDisplay& dd, DeviceConfig& dc, char* val)
 			tempToString(val, temp, 3, 9);
 		}
 		else if (dt==DEVICETYPE_SWITCH_ACTUATOR) {
-			sprintf_P(val, STR_FMT_U, (unsigned int) ((Actuator*)*ppv)->isActive()!=0);			
+			val[0] = ((Actuator*)*ppv)->isActive() ? '1' : '0';
+			val[1] = 0;
 		}
 	}
 }
@@ -903,7 +1168,10 @@ void DeviceManager::listDevices(Stream& p) {
 			char val[10];
 			val[0] = 0;
 			UpdateDeviceState(dd, dc, val);
-			deviceManager.printDevice(idx, dc, val, p);			
+			uint16_t age = DEVICE_VALUE_AGE_UNKNOWN;
+			if (*val && dc.deviceHardware==DEVICE_HARDWARE_ONEWIRE_TEMP)
+				age = tempSensorValueAge(dc.hw);
+			deviceManager.printDevice(idx, dc, val, p, age);			
 		}
 	}	
 }
@@ -25,9 +25,14 @@
 #include "Actuator.h"
 #include "Sensor.h"
 #include "TempSensor.h"
+#include "Ticks.h"
 #include "OneWireDevices.h"
 #include "Pins.h"
+#ifdef WIRING
 #include "OneWire.h"
+#else
+class OneWire;
+#endif
 
 /**
  * A user has freedom to connect various devices to the arduino, either via extending the oneWire bus, or by assigning to specific pins, e.g. actuators, switch sensors.
@@ -41,7 +46,7 @@ class DeviceConfig;
 
 typedef int8_t device_slot_t;
 inline bool isDefinedSlot(device_slot_t s) { return s>=0; }
-const device_slot_t MAX_DEVICE_SLOT = 16;		// exclusive
+const device_slot_t MAX_DEVICE_SLOT = BREWPI_DEVICE_SLOTS;		// exclusive
 const device_slot_t INVALID_SLOT = -1;
 
 /*
@@ -180,10 +185,15 @@ struct DeviceAlternatives {
 typedef void (*EnumDevicesCallback)(DeviceConfig*, void* pv);
 class EnumerateHardware;
 
+/* Age of a device value that was not read from a conversion cache, so it has no known age. */
+#define DEVICE_VALUE_AGE_UNKNOWN 0xFFFF
+
 struct DeviceOutput
 {
 	device_slot_t	slot;
 	char value[10];
+	uint16_t valueAge;		// milliseconds since the value was read, or DEVICE_VALUE_AGE_UNKNOWN
+	ticks_millis_t valueTime;	// when the onewire temp sensor values of the scanned bus were converted
 	Print* pp;
 };
 
@@ -278,7 +288,18 @@ public:
 	static void uninstallDevice(DeviceConfig& config);
 	
 	static void parseDeviceDefinition(Stream& p);
-	static void printDevice(device_slot_t slot, DeviceConfig& config, const char* value, Print& p);
+
+#if BREWPI_DEVICE_BATCH
+	/*
+	 * A batch of device definitions, received as a JSON array with 'U'. The definitions are collected as they arrive,
+	 * and installed together by applyDeviceBatch() when they are valid together.
+	 */
+	static void beginDeviceBatch();
+	static void addDeviceBatchEntry();
+	static void rejectDeviceBatch();
+	static void applyDeviceBatch(Print& p);
+#endif
+	static void printDevice(device_slot_t slot, DeviceConfig& config, const char* value, Print& p, uint16_t valueAge=DEVICE_VALUE_AGE_UNKNOWN);
 		
 	/**
 	 * Iterate over the defined devices.
@@ -305,12 +326,16 @@ private:
 	static void OutputEnumeratedDevices(DeviceConfig* config, void* pv);
 	static void handleEnumeratedDevice(DeviceConfig& config, EnumerateHardware& h, EnumDevicesCallback callback, DeviceOutput& out);
 	static void readTempSensorValue(DeviceConfig::Hardware hw, char* out);
+	static uint16_t tempSensorValueAge(DeviceConfig::Hardware hw);
 	
 
 	static void* createDevice(DeviceConfig& config, DeviceType dc);
 	static void* createOneWireGPIO(DeviceConfig& config, DeviceType dt);
 	
 	static void beginDeviceOutput() { firstDeviceOutput = true; }
+#if BREWPI_DEVICE_BATCH
+	static bool isDeviceBatchValid();
+#endif
 
 	static OneWire* oneWireBus(uint8_t pin);
 
@@ -43,19 +43,47 @@ struct ChamberBlock
 	BeerBlock		beer[MAX_BEERS];	
 };
 
-struct EepromFormat
+/*
+ * Format 4: fixed blocks for the settings of 4 chambers with 6 beers each, and 16 devices.
+ */
+struct EepromFormatV4
 {
 	static const uint16_t MAX_EEPROM_SIZE = 1024;
 	static const uint8_t MAX_CHAMBERS = 4;
-	static const uint8_t MAX_DEVICES = MAX_DEVICE_SLOT;
+	static const uint8_t MAX_DEVICES = 16;
 
 	byte version;
 	byte numChambers;		// todo - remove this - and increase reserved space.
 	byte reserved[4];	
-	ChamberBlock chambers[MAX_CHAMBERS];
+	ChamberBlock chambers[1];		// only the first chamber is used
+	byte journal[(MAX_CHAMBERS-1)*sizeof(ChamberBlock)];	// the space of the other chambers holds the EepromJournal
 	DeviceConfig devices[MAX_DEVICES];
 };
 
+#if BREWPI_EEPROM_TLV
+/*
+ * Format 5: the settings journal, followed by tag-length-value records that only take space for what is configured,
+ * see EepromRecords.h.
+ */
+struct EepromFormat
+{
+	static const uint16_t MAX_EEPROM_SIZE = 1024;
+	static const uint8_t MAX_CHAMBERS = 4;
+	static const uint8_t MAX_DEVICES = MAX_DEVICE_SLOT;
+	static const uint16_t JOURNAL_SIZE = 320;
+
+	byte version;
+	byte reserved[5];
+	byte journal[JOURNAL_SIZE];
+	byte records[MAX_EEPROM_SIZE-6-JOURNAL_SIZE];
+};
+#else
+#if BREWPI_DEVICE_SLOTS>16
+#error "Format 4 has room for 16 devices"
+#endif
+typedef EepromFormatV4 EepromFormat;
+#endif
+
 
 // check at compile time that the structure will fit into eeprom
 void eepromSizeTooLarge()
@@ -81,7 +109,11 @@ void eepromSizeCheck() {
  * Increment this value each time a change is made that is not backwardly-compatible.
  * Either the eeprom will be reset to defaults, or external code will re-establish the values via the piLink interface. 
  */
+#if BREWPI_EEPROM_TLV
+#define EEPROM_FORMAT_VERSION 5
+#else
 #define EEPROM_FORMAT_VERSION 4
+#endif
 
 /*
  * Version history:
@@ -90,4 +122,8 @@ void eepromSizeCheck() {
  * rev 2: initial version dynaconfig
  * rev 3: deactivate flag in DeviceConfig, and additinoal padding to allow for some future expansion.
  * rev 4: added padding at start and reduced device count to 16. We can always increase later.
+ *        The unused chambers 1-3 were later taken by the settings journal. The layout is unchanged, so the settings
+ *        stored in chamber 0 are used until the journal has a newer record.
+ * rev 5: the journal holds all settings, and the devices are stored as records, so there can be more of them.
+ *        Format 4 is converted when the settings are applied. The AVR stays at format 4.
  */
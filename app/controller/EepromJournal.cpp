@@ -0,0 +1,172 @@
+/*
+ * Copyright 2013 BrewPi/Elco Jacobs.
+ * Copyright 2013 Matthew McGowan 
+ *
+ * This file is part of BrewPi.
+ * 
+ * BrewPi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * BrewPi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with BrewPi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Brewpi.h"
+#include <stddef.h>
+
+#include "EepromJournal.h"
+#include "Crc16.h"
+
+#if BREWPI_EEPROM_JOURNAL
+
+#define RECORD_HEADER_SIZE 6	// type, data size and the 32 bit sequence number, low byte first
+#define RECORD_CRC_SIZE 2
+
+eptr_t EepromJournal::start;
+uint16_t EepromJournal::bankSize;
+eptr_t EepromJournal::newest[JOURNAL_RECORD_TYPES];
+eptr_t EepromJournal::head;
+uint32_t EepromJournal::sequence;
+
+eptr_t EepromJournal::bankEnd(eptr_t offset)
+{
+	return (offset<start+bankSize) ? start+bankSize : start+2*bankSize;
+}
+
+bool EepromJournal::headInFirstBank()
+{
+	return head<=start+bankSize;
+}
+
+bool EepromJournal::readRecord(eptr_t offset, Record& record)
+{
+	uint8_t header[RECORD_HEADER_SIZE];
+	eepromAccess.readBlock(header, offset, RECORD_HEADER_SIZE);
+	record.type = header[0];
+	record.size = header[1];
+	if (record.type==0 || record.type>JOURNAL_RECORD_TYPES
+		|| offset+RECORD_HEADER_SIZE+record.size+RECORD_CRC_SIZE>bankEnd(offset))
+		return false;
+
+	uint16_t crc = 0xFFFF;
+	for (uint8_t i=0; i<RECORD_HEADER_SIZE; i++)
+		crc = crc16Update(crc, header[i]);
+	eptr_t data = offset+RECORD_HEADER_SIZE;
+	for (uint8_t i=0; i<record.size; i++)
+		crc = crc16Update(crc, eepromAccess.readByte(data+i));
+	eptr_t end = data+record.size;
+	if (crc!=(eepromAccess.readByte(end) | (eepromAccess.readByte(end+1)<<8)))
+		return false;
+
+	record.sequence = header[2] | (uint32_t(header[3])<<8) | (uint32_t(header[4])<<16) | (uint32_t(header[5])<<24);
+	return true;
+}
+
+void EepromJournal::init(eptr_t offset, uint16_t size)
+{
+	start = offset;
+	bankSize = size/2;
+	uint32_t newestSequence[JOURNAL_RECORD_TYPES];
+	for (uint8_t t=0; t<JOURNAL_RECORD_TYPES; t++)
+		newest[t] = 0;
+	head = start;
+	sequence = 0;
+
+	bool found = false;
+	for (eptr_t bank=start; bank<start+2*bankSize; bank+=bankSize) {
+		// the records of a bank follow each other from its start. Older records after the head of the bank are
+		// either cut off or have lower sequence numbers.
+		Record record;
+		for (eptr_t offset=bank; readRecord(offset, record); offset+=RECORD_HEADER_SIZE+record.size+RECORD_CRC_SIZE) {
+			uint8_t t = record.type-1;
+			if (!newest[t] || int32_t(record.sequence-newestSequence[t])>0) {
+				newest[t] = offset;
+				newestSequence[t] = record.sequence;
+			}
+			if (!found || int32_t(record.sequence-sequence)>0) {
+				found = true;
+				sequence = record.sequence;
+				head = offset+RECORD_HEADER_SIZE+record.size+RECORD_CRC_SIZE;
+			}
+		}
+	}
+}
+
+bool EepromJournal::fetch(uint8_t type, void* data, uint8_t size)
+{
+	Record record;
+	eptr_t offset = newest[type-1];
+	if (!offset || !readRecord(offset, record) || record.size!=size)
+		return false;
+	eepromAccess.readBlock(data, offset+RECORD_HEADER_SIZE, size);
+	return true;
+}
+
+bool EepromJournal::isNewest(uint8_t type, const uint8_t* data, uint8_t size)
+{
+	Record record;
+	eptr_t offset = newest[type-1];
+	if (!offset || !readRecord(offset, record) || record.size!=size)
+		return false;
+	offset += RECORD_HEADER_SIZE;
+	for (uint8_t i=0; i<size; i++) {
+		if (eepromAccess.readByte(offset+i)!=data[i])
+			return false;
+	}
+	return true;
+}
+
+void EepromJournal::store(uint8_t type, const void* data, uint8_t size)
+{
+	if (isNewest(type, (const uint8_t*)data, size))
+		return;		// unchanged, like eeprom_update_block
+	eptr_t end = headInFirstBank() ? start+bankSize : start+2*bankSize;
+	if (head+RECORD_HEADER_SIZE+size+RECORD_CRC_SIZE>end)
+		switchBank(type);
+	writeRecord(type, (const uint8_t*)data, 0, size);
+}
+
+void EepromJournal::switchBank(uint8_t skipType)
+{
+	eptr_t copy[JOURNAL_RECORD_TYPES];
+	memcpy(copy, newest, sizeof(copy));
+	head = headInFirstBank() ? start+bankSize : start;
+	for (uint8_t t=0; t<JOURNAL_RECORD_TYPES; t++) {
+		Record record;
+		if (t+1!=skipType && copy[t] && readRecord(copy[t], record))
+			writeRecord(record.type, NULL, copy[t]+RECORD_HEADER_SIZE, record.size);
+	}
+}
+
+void EepromJournal::writeRecord(uint8_t type, const uint8_t* data, eptr_t source, uint8_t size)
+{
+	sequence++;
+	uint8_t header[RECORD_HEADER_SIZE] = {
+		type, size, uint8_t(sequence), uint8_t(sequence>>8), uint8_t(sequence>>16), uint8_t(sequence>>24)
+	};
+	uint16_t crc = 0xFFFF;
+	eptr_t offset = head;
+	for (uint8_t i=0; i<RECORD_HEADER_SIZE; i++) {
+		crc = crc16Update(crc, header[i]);
+		eepromAccess.writeByte(offset++, header[i]);
+	}
+	for (uint8_t i=0; i<size; i++) {
+		uint8_t value = data ? data[i] : eepromAccess.readByte(source+i);
+		crc = crc16Update(crc, value);
+		eepromAccess.writeByte(offset++, value);
+	}
+	// the CRC goes last, so the record only becomes valid once it is complete
+	eepromAccess.writeByte(offset++, uint8_t(crc));
+	eepromAccess.writeByte(offset++, uint8_t(crc>>8));
+	newest[type-1] = head;
+	head = offset;
+}
+
+#endif
@@ -0,0 +1,86 @@
+/*
+ * Copyright 2013 BrewPi/Elco Jacobs.
+ * Copyright 2013 Matthew McGowan
+ *
+ * This file is part of BrewPi.
+ * 
+ * BrewPi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * BrewPi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with BrewPi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "Brewpi.h"
+#include "EepromAccess.h"
+
+/* Types of the records in the journal. */
+#define JOURNAL_RECORD_SETTINGS 1
+#define JOURNAL_RECORD_CONSTANTS 2
+#define JOURNAL_RECORD_TYPES 2
+
+/**
+ * Append-only store for the settings and constants, so they are not rewritten in place on every change.
+ *
+ * The journal area of the eeprom, given to init(), is split in two banks. Each record holds its type, the size of its data, a sequence
+ * number, the data and a CRC that is written last, so a record that was cut short by a power loss is ignored and the
+ * one before it is used. When a record doesn't fit in the current bank, the newest record of every other type is copied
+ * to the start of the other bank and the journal carries on there. The old bank stays intact until then, so the newest
+ * record of each type survives a power loss at any point.
+ */
+class EepromJournal
+{
+public:
+	/**
+	 * Uses the eeprom area at offset for the journal, and finds the newest record of each type and where the next
+	 * record goes. Call this again when the eeprom was changed other than through the journal.
+	 */
+	static void init(eptr_t offset, uint16_t size);
+
+	/**
+	 * Reads the data of the newest record of a type. Returns false if there is no such record, or it has another size.
+	 */
+	static bool fetch(uint8_t type, void* data, uint8_t size);
+
+	/**
+	 * Appends a record, which replaces the previous record of the same type. Nothing is written if the data is unchanged.
+	 */
+	static void store(uint8_t type, const void* data, uint8_t size);
+
+private:
+	struct Record {
+		uint8_t type;
+		uint8_t size;
+		uint32_t sequence;
+	};
+
+	/* The end of the bank that holds offset. */
+	static eptr_t bankEnd(eptr_t offset);
+	/* True when the head is in the first bank. A head at its end is still in it, as records only start there in the second. */
+	static bool headInFirstBank();
+	/* Reads the header of the record at offset. Returns false if there is no complete record with a valid CRC. */
+	static bool readRecord(eptr_t offset, Record& record);
+	/* Determines if the newest record of the type holds this data. */
+	static bool isNewest(uint8_t type, const uint8_t* data, uint8_t size);
+	/* Writes a record at the head. The data is taken from data, or from the eeprom at source when data is NULL. */
+	static void writeRecord(uint8_t type, const uint8_t* data, eptr_t source, uint8_t size);
+	/* Moves the head to the start of the other bank and copies the newest records of all types except skipType. */
+	static void switchBank(uint8_t skipType);
+
+	static eptr_t start;				// the journal area
+	static uint16_t bankSize;			// half of the area
+	static eptr_t newest[JOURNAL_RECORD_TYPES];	// offset of the newest record of each type, 0 if there is none
+	static eptr_t head;				// where the next record is written
+	static uint32_t sequence;			// sequence number of the newest record
+
+	friend class EepromJournalTest;
+};
@@ -24,18 +24,39 @@
 #include "EepromManager.h"
 #include "TempControl.h"
 #include "EepromFormat.h"
+#include "EepromJournal.h"
+#include "EepromRecords.h"
 #include "PiLink.h"
+#include "Ticks.h"
 
 EepromManager eepromManager;
 EepromAccess eepromAccess;
 
 #define pointerOffset(x) offsetof(EepromFormat, x)
 
+#define STORE_SETTINGS 1
+#define STORE_CONSTANTS 2
+#define STORE_DEFERRED 0x80		// an update is in progress
+
+#if BREWPI_EEPROM_TLV && !(BREWPI_DEVICE_CACHE && BREWPI_EEPROM_JOURNAL)
+#error "The device records need BREWPI_DEVICE_CACHE and BREWPI_EEPROM_JOURNAL"
+#endif
+
+uint8_t EepromManager::pendingStores = 0;
+ticks_millis_t EepromManager::lastStore;
+
 EepromManager::EepromManager()
 {
 	eepromSizeCheck();
 }
 
+#if BREWPI_EEPROM_JOURNAL
+static void initJournal()
+{
+	EepromJournal::init(pointerOffset(journal), sizeof(((EepromFormat*)0)->journal));
+}
+#endif
+
 
 bool EepromManager::hasSettings()
 {
@@ -45,13 +66,23 @@ bool EepromManager::hasSettings()
 
 void EepromManager::zapEeprom()
 {
+	pendingStores = 0;
 	for (uint16_t offset=0; offset<EepromFormat::MAX_EEPROM_SIZE; offset++)
 		eepromAccess.writeByte(offset, 0xFF);		
+#if BREWPI_EEPROM_JOURNAL
+	initJournal();
+#endif
+#if BREWPI_DEVICE_CACHE
+	loadDevices();
+#endif
+	eepromAccess.flush();
 }
 
 
 void EepromManager::initializeEeprom()
 {
+	pendingStores = 0;		// the defaults replace any changes that were not written yet
+
 	// clear all eeprom
 	for (uint16_t offset=0; offset<EepromFormat::MAX_EEPROM_SIZE; offset++)
 		eepromAccess.writeByte(offset, 0);	
@@ -62,22 +93,35 @@ void EepromManager::initializeEeprom()
 	tempControl.loadDefaultConstants();
 	tempControl.loadDefaultSettings();	
 	
-	// write the default constants 
-	for (uint8_t c=0; c<EepromFormat::MAX_CHAMBERS; c++) {
-		eptr_t pv = pointerOffset(chambers)+(c*sizeof(ChamberBlock)) ;
-		tempControl.storeConstants(pv+offsetof(ChamberBlock, chamberSettings.cc));
-		pv += offsetof(ChamberBlock, beer)+offsetof(BeerBlock, cs);
-		for (uint8_t b=0; b<ChamberBlock::MAX_BEERS; b++) {
-//			logDeveloper(PSTR("EepromManager - saving settings for beer %d at %d"), b, (uint16_t)pv);
-			tempControl.storeSettings(pv);	
-			pv += sizeof(BeerBlock);		// advance to next beer
-		}
+#if BREWPI_EEPROM_TLV
+	// the journal holds the defaults, and there are no devices yet
+	initJournal();
+	writeConstants();
+	writeSettings();
+	EepromRecords::storeDevices(NULL, 0);
+#else
+	// write the default constants, the journal is empty
+	eptr_t pv = pointerOffset(chambers);
+	tempControl.storeConstants(pv+offsetof(ChamberBlock, chamberSettings.cc));
+	pv += offsetof(ChamberBlock, beer)+offsetof(BeerBlock, cs);
+	for (uint8_t b=0; b<ChamberBlock::MAX_BEERS; b++) {
+//		logDeveloper(PSTR("EepromManager - saving settings for beer %d at %d"), b, (uint16_t)pv);
+		tempControl.storeSettings(pv);	
+		pv += sizeof(BeerBlock);		// advance to next beer
 	}
+#if BREWPI_EEPROM_JOURNAL
+	initJournal();
+#endif
+#endif
 
 	// set the version flag - so that storeDevice will work
 	eepromAccess.writeByte(0, EEPROM_FORMAT_VERSION);
+#if BREWPI_DEVICE_CACHE
+	loadDevices();
+#endif
 		
 	saveDefaultDevices();
+	eepromAccess.flush();
 	// set state to startup
 	tempControl.init();
 }
@@ -89,6 +133,16 @@ uint8_t EepromManager::saveDefaultDevices()
 
 bool EepromManager::applySettings()
 {	
+#if BREWPI_EEPROM_TLV
+	if (eepromAccess.readByte(pointerOffset(version))==4)
+		upgradeEeprom();
+#endif
+#if BREWPI_EEPROM_JOURNAL
+	initJournal();
+#endif
+#if BREWPI_DEVICE_CACHE
+	loadDevices();
+#endif
 	if (!hasSettings())
 		return false;
 
@@ -98,9 +152,31 @@ bool EepromManager::applySettings()
 	logDebug("Applying settings");
 
 	// load the one chamber and one beer for now
+#if BREWPI_EEPROM_TLV
+	if (EepromJournal::fetch(JOURNAL_RECORD_CONSTANTS, &tempControl.cc, sizeof(ControlConstants)))
+		tempControl.initFilters();
+	else
+		tempControl.loadDefaultConstants();
+	if (EepromJournal::fetch(JOURNAL_RECORD_SETTINGS, &tempControl.cs, sizeof(ControlSettings)))
+		tempControl.settingsLoaded();
+	else
+		tempControl.loadDefaultSettings();
+#else
 	eptr_t pv = pointerOffset(chambers);
+#if BREWPI_EEPROM_JOURNAL
+	// settings that were not stored since the journal was added are still in the chamber block
+	if (EepromJournal::fetch(JOURNAL_RECORD_CONSTANTS, &tempControl.cc, sizeof(ControlConstants)))
+		tempControl.initFilters();
+	else
+#endif
 	tempControl.loadConstants(pv+offsetof(ChamberBlock, chamberSettings.cc));	
+#if BREWPI_EEPROM_JOURNAL
+	if (EepromJournal::fetch(JOURNAL_RECORD_SETTINGS, &tempControl.cs, sizeof(ControlSettings)))
+		tempControl.settingsLoaded();
+	else
+#endif
 	tempControl.loadSettings(pv+offsetof(ChamberBlock, beer[0].cs));
+#endif
 	
 	logDebug("Applied settings");
 	
@@ -120,23 +196,292 @@ bool EepromManager::applySettings()
 
 void EepromManager::storeTempConstantsAndSettings()
 {
+	store(STORE_CONSTANTS|STORE_SETTINGS);
+}
+
+void EepromManager::storeTempSettings()
+{
+	store(STORE_SETTINGS);
+}
+
+void EepromManager::store(uint8_t blocks)
+{
+	pendingStores |= blocks;
+	lastStore = ::millis();
+#if BREWPI_EEPROM_FLUSH_DELAY==0
+	if (!(pendingStores & STORE_DEFERRED))
+		commit();
+#endif
+}
+
+void EepromManager::beginUpdate()
+{
+	pendingStores |= STORE_DEFERRED;
+}
+
+void EepromManager::endUpdate()
+{
+	pendingStores &= ~STORE_DEFERRED;
+#if BREWPI_EEPROM_FLUSH_DELAY==0
+	commit();
+#endif
+}
+
+/*
+ * The flush delay is timed with ::millis(), which is real time also in the simulator, where ticks stop while the
+ * simulation is paused.
+ */
+void EepromManager::update()
+{
+	if (pendingStores && !(pendingStores & STORE_DEFERRED) && ::millis()-lastStore>=BREWPI_EEPROM_FLUSH_DELAY)
+		commit();
+	else
+		eepromAccess.flush();	// e.g. device changes
+}
+
+void EepromManager::commit()
+{
+	uint8_t blocks = pendingStores;
+	pendingStores &= STORE_DEFERRED;
+	if (blocks & STORE_CONSTANTS)
+		writeConstants();
+	if (blocks & STORE_SETTINGS)
+		writeSettings();
+	eepromAccess.flush();
+}
+
+void EepromManager::writeConstants()
+{
+#if BREWPI_EEPROM_JOURNAL
+	EepromJournal::store(JOURNAL_RECORD_CONSTANTS, &tempControl.cc, sizeof(ControlConstants));
+#else
 	uint8_t chamber = 0;
 	eptr_t pv = pointerOffset(chambers);
 	pv += sizeof(ChamberBlock)*chamber;
 	tempControl.storeConstants(pv+offsetof(ChamberBlock, chamberSettings.cc));
-		
-	storeTempSettings();
+#endif
 }
 
-void EepromManager::storeTempSettings()
+void EepromManager::writeSettings()
 {
+#if BREWPI_EEPROM_JOURNAL
+	EepromJournal::store(JOURNAL_RECORD_SETTINGS, &tempControl.cs, sizeof(ControlSettings));
+	tempControl.settingsStored();
+#else
 	uint8_t chamber = 0;
 	eptr_t pv = pointerOffset(chambers);
 	pv += sizeof(ChamberBlock)*chamber;
 	// for now assume just one beer. 
 	tempControl.storeSettings(pv+offsetof(ChamberBlock, beer[0].cs));	
+#endif
+}
+
+#if BREWPI_DEVICE_CACHE
+
+/*
+ * A copy of the device table, so iterating over the devices doesn't read the eeprom each time.
+ * The index finds the slot of a hardware location without a scan. It is an open addressed hash table of slots, by
+ * hardware type, pin, onewire address and pio. Onewire devices without an address match any address on their pin,
+ * so they are indexed with the address left out. Only the first slot of each location is indexed, as a scan would
+ * find that one first.
+ */
+#define DEVICE_INDEX_SIZE (2*EepromFormat::MAX_DEVICES)		// a power of 2, with room for every slot
+
+static DeviceConfig devices[EepromFormat::MAX_DEVICES];
+static uint8_t deviceCount;		// MAX_DEVICES when the eeprom has settings, else 0
+static int8_t deviceIndex[DEVICE_INDEX_SIZE];	// slot at each position, INVALID_SLOT when empty
+
+static bool hasAddress(const DeviceConfig& config)
+{
+	return config.hw.address[0]!=0;
+}
+
+/* Compares hardware locations the way findHardwareDevice() does, except that onewire devices without an address
+ * are only equal to each other. */
+static bool sameLocation(const DeviceConfig& a, const DeviceConfig& b)
+{
+	if (a.deviceHardware!=b.deviceHardware)
+		return false;
+	switch (a.deviceHardware) {
+#if BREWPI_DS2413
+		case DEVICE_HARDWARE_ONEWIRE_2413:
+			if (a.hw.pio!=b.hw.pio)
+				return false;
+			// fall through
+#endif
+		case DEVICE_HARDWARE_ONEWIRE_TEMP:
+			if (hasAddress(a)!=hasAddress(b) || (hasAddress(a) && memcmp(a.hw.address, b.hw.address, 8)))
+				return false;
+			// fall through
+		case DEVICE_HARDWARE_PIN:
+			return a.hw.pinNr==b.hw.pinNr;
+		default:
+			return true;
+	}
+}
+
+static uint8_t locationHash(const DeviceConfig& config)
+{
+	uint8_t hash = config.deviceHardware;
+	switch (config.deviceHardware) {
+#if BREWPI_DS2413
+		case DEVICE_HARDWARE_ONEWIRE_2413:
+			hash = hash*31 + config.hw.pio;
+			// fall through
+#endif
+		case DEVICE_HARDWARE_ONEWIRE_TEMP:
+			if (hasAddress(config)) {
+				for (uint8_t i=0; i<8; i++)
+					hash = hash*31 + config.hw.address[i];
+			}
+			// fall through
+		case DEVICE_HARDWARE_PIN:
+			hash = hash*31 + config.hw.pinNr;
+		default:
+			break;
+	}
+	return hash;
+}
+
+void EepromManager::loadDevices()
+{
+	deviceCount = hasSettings() ? EepromFormat::MAX_DEVICES : 0;
+#if BREWPI_EEPROM_TLV
+	// incomplete records keep the devices before the damaged record
+	EepromRecords::loadDevices(devices, deviceCount);
+#else
+	eepromAccess.readBlock(devices, pointerOffset(devices), sizeof(devices));
+#endif
+	indexDevices();
+}
+
+#if BREWPI_EEPROM_TLV
+/*
+ * Converts format 4 to format 5. Everything is read before the layout is rewritten, and the version is cleared while
+ * it is, so a power loss leaves an uninitialized eeprom rather than a mix of both formats.
+ */
+void EepromManager::upgradeEeprom()
+{
+	EepromJournal::init(offsetof(EepromFormatV4, journal), sizeof(((EepromFormatV4*)0)->journal));
+	eptr_t pv = offsetof(EepromFormatV4, chambers);
+	if (!EepromJournal::fetch(JOURNAL_RECORD_CONSTANTS, &tempControl.cc, sizeof(ControlConstants)))
+		eepromAccess.readBlock(&tempControl.cc, pv+offsetof(ChamberBlock, chamberSettings.cc), sizeof(ControlConstants));
+	if (!EepromJournal::fetch(JOURNAL_RECORD_SETTINGS, &tempControl.cs, sizeof(ControlSettings)))
+		eepromAccess.readBlock(&tempControl.cs, pv+offsetof(ChamberBlock, beer[0].cs), sizeof(ControlSettings));
+	memset(devices, 0, sizeof(devices));
+	eepromAccess.readBlock(devices, offsetof(EepromFormatV4, devices), EepromFormatV4::MAX_DEVICES*sizeof(DeviceConfig));
+
+	for (uint16_t offset=0; offset<EepromFormat::MAX_EEPROM_SIZE; offset++)
+		eepromAccess.writeByte(offset, 0);
+	initJournal();
+	writeConstants();
+	writeSettings();
+	EepromRecords::storeDevices(devices, EepromFormatV4::MAX_DEVICES);
+	eepromAccess.writeByte(pointerOffset(version), EEPROM_FORMAT_VERSION);
+	eepromAccess.flush();
+	logInfoInt(INFO_EEPROM_UPGRADED, 4);
+}
+
+uint16_t EepromManager::deviceRoomLeft()
+{
+	return EepromRecords::capacity()-EepromRecords::devicesSize(devices, deviceCount);
+}
+
+bool EepromManager::storeDevices(const DeviceConfig* configs, const uint8_t* slots)
+{
+	bool ok = deviceCount>0;
+	if (ok) {
+		for (uint8_t slot=0; slot<deviceCount; slot++) {
+			if (slots[slot>>3] & (1<<(slot&7)))
+				memcpy(&devices[slot], &configs[slot], sizeof(DeviceConfig));
+		}
+		ok = EepromRecords::storeDevices(devices, deviceCount);
+		if (!ok)
+			EepromRecords::loadDevices(devices, deviceCount);	// the records are unchanged, read the table back
+		indexDevices();
+	}
+	return ok;
+}
+#endif
+
+void EepromManager::indexDevices()
+{
+	memset(deviceIndex, INVALID_SLOT, sizeof(deviceIndex));
+	for (uint8_t slot=0; slot<deviceCount; slot++) {
+		uint8_t pos = locationHash(devices[slot]);
+		for (;;) {
+			pos &= DEVICE_INDEX_SIZE-1;
+			int8_t indexed = deviceIndex[pos];
+			if (indexed==INVALID_SLOT)
+				deviceIndex[pos] = slot;
+			if (indexed==INVALID_SLOT || sameLocation(devices[indexed], devices[slot]))
+				break;
+			pos++;
+		}
+	}
+}
+
+int8_t EepromManager::findIndexedDevice(const DeviceConfig& hardware)
+{
+	uint8_t pos = locationHash(hardware);
+	for (;;) {
+		pos &= DEVICE_INDEX_SIZE-1;
+		int8_t slot = deviceIndex[pos];
+		if (slot==INVALID_SLOT || sameLocation(devices[slot], hardware))
+			return slot;
+		pos++;
+	}
+}
+
+int8_t EepromManager::findDevice(const DeviceConfig& hardware)
+{
+	int8_t slot = findIndexedDevice(hardware);
+	if (hasAddress(hardware) && (hardware.deviceHardware==DEVICE_HARDWARE_ONEWIRE_TEMP
+#if BREWPI_DS2413
+		|| hardware.deviceHardware==DEVICE_HARDWARE_ONEWIRE_2413
+#endif
+		)) {
+		// a device configured without an address also matches
+		DeviceConfig any = hardware;
+		any.hw.address[0] = 0;
+		int8_t anySlot = findIndexedDevice(any);
+		if (slot==INVALID_SLOT || (anySlot!=INVALID_SLOT && anySlot<slot))
+			slot = anySlot;
+	}
+	return slot;
 }
 
+bool EepromManager::fetchDevice(DeviceConfig& config, uint8_t deviceIndex)
+{
+	bool ok = deviceIndex<deviceCount;
+	if (ok)
+		memcpy(&config, &devices[deviceIndex], sizeof(DeviceConfig));
+	return ok;
+}	
+
+bool EepromManager::storeDevice(const DeviceConfig& config, uint8_t deviceIndex)
+{
+	bool ok = deviceIndex<deviceCount;
+	if (ok) {
+#if BREWPI_EEPROM_TLV
+		// all records are rewritten, as the record of the device can change size
+		DeviceConfig previous;
+		memcpy(&previous, &devices[deviceIndex], sizeof(DeviceConfig));
+		memcpy(&devices[deviceIndex], &config, sizeof(DeviceConfig));
+		ok = EepromRecords::storeDevices(devices, deviceCount);
+		if (!ok)
+			memcpy(&devices[deviceIndex], &previous, sizeof(DeviceConfig));
+#else
+		eepromAccess.writeBlock(pointerOffset(devices)+sizeof(DeviceConfig)*deviceIndex, &config, sizeof(DeviceConfig));	
+		memcpy(&devices[deviceIndex], &config, sizeof(DeviceConfig));
+#endif
+		indexDevices();
+	}
+	return ok;
+}
+
+#else
+
 bool EepromManager::fetchDevice(DeviceConfig& config, uint8_t deviceIndex)
 {
 	bool ok = (hasSettings() && deviceIndex<EepromFormat::MAX_DEVICES);
@@ -153,6 +498,8 @@ bool EepromManager::storeDevice(const DeviceConfig& config, uint8_t deviceIndex)
 	return ok;
 }
 
+#endif
+
 void fill(int8_t* p, uint8_t size) {
 	while (size-->0) *p++ = -1;
 }
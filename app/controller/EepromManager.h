@@ -23,6 +23,7 @@
 #include "Brewpi.h"
 
 #include "EepromAccess.h"
+#include "Ticks.h"
 
 
 void fill(int8_t* p, uint8_t size);
@@ -31,7 +32,6 @@ void clear(uint8_t* p, uint8_t size);
 class DeviceConfig;
 
 
-// todo - the Eeprom manager should avoid too frequent saves to the eeprom since it supports 100,000 writes. 
 class EepromManager {
 public:		
 		
@@ -62,6 +62,7 @@ public:
 
 	/**
 	 * Save the chamber constants and beer settings to eeprom for the currently active chamber.
+	 * The settings are written once they have not changed for BREWPI_EEPROM_FLUSH_DELAY milliseconds, see update().
 	 */
 	static void storeTempConstantsAndSettings();
 
@@ -70,10 +71,71 @@ public:
 	 */
 	static void storeTempSettings();
 
+	/**
+	 * Until endUpdate(), stores of the constants and settings are held back even when the flush delay has passed,
+	 * so the eeprom never holds a partly applied update.
+	 */
+	static void beginUpdate();
+	static void endUpdate();
+
+	/**
+	 * Writes the stored constants and settings when the flush delay has passed since the last store, and flushes the
+	 * writes that the eeprom emulation keeps in RAM. Called periodically from the main loop.
+	 */
+	static void update();
+
+	/**
+	 * Writes the stored constants and settings right away, e.g. before a reset.
+	 */
+	static void commit();
+
 	static bool fetchDevice(DeviceConfig& config, uint8_t deviceIndex);
 	static bool storeDevice(const DeviceConfig& config, uint8_t deviceIndex);
+
+#if BREWPI_DEVICE_CACHE
+	/**
+	 * Finds the first slot with a device at the same hardware location, see findHardwareDevice().
+	 * Returns INVALID_SLOT when there is none.
+	 */
+	static int8_t findDevice(const DeviceConfig& hardware);
+#endif
+
+#if BREWPI_EEPROM_TLV
+	/**
+	 * Bytes left for device records, see EepromRecords::deviceSize().
+	 */
+	static uint16_t deviceRoomLeft();
+
+	/**
+	 * Stores the devices in the slots that are set in a bit mask, with a single rewrite of the records.
+	 * /param configs	The definitions, indexed by slot.
+	 * /param slots	Bit per slot, set for the slots to store.
+	 * /return false when the devices don't fit, nothing is stored then.
+	 */
+	static bool storeDevices(const DeviceConfig* configs, const uint8_t* slots);
+#endif
 	
 	static uint8_t saveDefaultDevices();
+
+private:
+	static void store(uint8_t blocks);
+	static void writeConstants();
+	static void writeSettings();
+#if BREWPI_DEVICE_CACHE
+	/* Reads the device table from the eeprom into RAM, and indexes it by hardware location. */
+	static void loadDevices();
+	static void indexDevices();
+	static int8_t findIndexedDevice(const DeviceConfig& hardware);
+#endif
+#if BREWPI_EEPROM_TLV
+	/* Converts the settings and devices in an eeprom with format 4. */
+	static void upgradeEeprom();
+#endif
+
+	static uint8_t pendingStores;		// the blocks that were stored but not written yet, and whether an update is in progress
+	static ticks_millis_t lastStore;	// ::millis() of the last store
+
+	friend class DeviceCacheTest;
 };
 
 class EepromStream 
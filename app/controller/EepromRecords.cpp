@@ -0,0 +1,172 @@
+/*
+ * Copyright 2013 BrewPi/Elco Jacobs.
+ * Copyright 2013 Matthew McGowan 
+ *
+ * This file is part of BrewPi.
+ * 
+ * BrewPi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * BrewPi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with BrewPi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Brewpi.h"
+#include <stddef.h>
+
+#include "EepromRecords.h"
+#include "EepromFormat.h"
+#include "Crc16.h"
+
+#if BREWPI_EEPROM_TLV
+
+#define RECORDS_START offsetof(EepromFormat, records)
+#define RECORDS_SIZE sizeof(((EepromFormat*)0)->records)
+
+#define RECORD_HEADER_SIZE 2	// tag and length
+#define RECORD_CRC_SIZE 2
+#define END_RECORD_SIZE (RECORD_HEADER_SIZE+RECORD_CRC_SIZE)
+#define DEVICE_PIN_SIZE 6		// slot, chamber, beer, function, hardware and flags, pin
+#define DEVICE_ONEWIRE_SIZE 15	// followed by the address and the pio or calibration
+
+#define DEVICE_HARDWARE_MASK 0x3F	// the flags are in the top bits of the hardware byte
+#define DEVICE_FLAG_INVERT 0x40
+#define DEVICE_FLAG_DEACTIVATE 0x80
+
+static bool isUsed(const DeviceConfig& config)
+{
+	return config.deviceFunction!=DEVICE_NONE;
+}
+
+static void encodeDevice(const DeviceConfig& config, uint8_t slot, uint8_t* record)
+{
+	uint8_t* p = record+RECORD_HEADER_SIZE;
+	*p++ = slot;
+	*p++ = config.chamber;
+	*p++ = config.beer;
+	*p++ = config.deviceFunction;
+	*p++ = config.deviceHardware | (config.hw.invert ? DEVICE_FLAG_INVERT : 0) | (config.hw.deactivate ? DEVICE_FLAG_DEACTIVATE : 0);
+	*p++ = config.hw.pinNr;
+	if (isOneWire(config.deviceHardware)) {
+		memcpy(p, config.hw.address, 8);
+		p += 8;
+		*p++ = config.hw.calibration;		// shares its byte with the pio
+	}
+	record[0] = RECORD_TAG_DEVICE;
+	record[1] = p-record-RECORD_HEADER_SIZE;
+}
+
+static void decodeDevice(const uint8_t* value, uint8_t length, DeviceConfig& config)
+{
+	config.chamber = value[1];
+	config.beer = value[2];
+	config.deviceFunction = DeviceFunction(value[3]);
+	config.deviceHardware = DeviceHardware(value[4] & DEVICE_HARDWARE_MASK);
+	config.hw.invert = (value[4] & DEVICE_FLAG_INVERT)!=0;
+	config.hw.deactivate = (value[4] & DEVICE_FLAG_DEACTIVATE)!=0;
+	config.hw.pinNr = value[5];
+	if (length>=DEVICE_ONEWIRE_SIZE) {
+		memcpy(config.hw.address, value+6, 8);
+		config.hw.calibration = int8_t(value[14]);
+	}
+}
+
+uint8_t EepromRecords::deviceSize(const DeviceConfig& config)
+{
+	if (!isUsed(config))
+		return 0;
+	return RECORD_HEADER_SIZE + (isOneWire(config.deviceHardware) ? DEVICE_ONEWIRE_SIZE : DEVICE_PIN_SIZE) + RECORD_CRC_SIZE;
+}
+
+uint16_t EepromRecords::devicesSize(const DeviceConfig* devices, uint8_t count)
+{
+	uint16_t size = END_RECORD_SIZE;
+	for (uint8_t slot=0; slot<count; slot++)
+		size += deviceSize(devices[slot]);
+	return size;
+}
+
+uint16_t EepromRecords::capacity()
+{
+	return RECORDS_SIZE;
+}
+
+/*
+ * Adds the CRC after the tag, length and value of the record. The CRC runs on from the records before it.
+ * Returns the size of the record.
+ */
+static uint8_t sealRecord(uint8_t* record, uint16_t& crc)
+{
+	uint8_t size = RECORD_HEADER_SIZE+record[1];
+	for (uint8_t i=0; i<size; i++)
+		crc = crc16Update(crc, record[i]);
+	record[size++] = uint8_t(crc);
+	record[size++] = uint8_t(crc>>8);
+	return size;
+}
+
+bool EepromRecords::storeDevices(const DeviceConfig* devices, uint8_t count)
+{
+	if (devicesSize(devices, count)>capacity())
+		return false;
+
+	uint8_t record[RECORD_HEADER_SIZE+DEVICE_ONEWIRE_SIZE+RECORD_CRC_SIZE];
+	uint16_t crc = 0xFFFF;
+	eptr_t offset = RECORDS_START;
+	for (uint8_t slot=0; slot<count; slot++) {
+		if (!isUsed(devices[slot]))
+			continue;
+		encodeDevice(devices[slot], slot, record);
+		uint8_t size = sealRecord(record, crc);
+		eepromAccess.writeBlock(offset, record, size);
+		offset += size;
+	}
+	record[0] = RECORD_TAG_END;
+	record[1] = 0;
+	sealRecord(record, crc);
+	eepromAccess.writeBlock(offset, record, END_RECORD_SIZE);
+	return true;
+}
+
+bool EepromRecords::loadDevices(DeviceConfig* devices, uint8_t count)
+{
+	memset(devices, 0, count*sizeof(DeviceConfig));
+
+	uint8_t value[DEVICE_ONEWIRE_SIZE];
+	uint16_t crc = 0xFFFF;
+	eptr_t offset = RECORDS_START;
+	eptr_t end = RECORDS_START+RECORDS_SIZE;
+	while (offset+END_RECORD_SIZE<=end) {
+		uint8_t tag = eepromAccess.readByte(offset);
+		uint8_t length = eepromAccess.readByte(offset+1);
+		if (offset+RECORD_HEADER_SIZE+length+RECORD_CRC_SIZE>end)
+			break;
+		crc = crc16Update(crc16Update(crc, tag), length);
+		offset += RECORD_HEADER_SIZE;
+		for (uint8_t i=0; i<length; i++) {
+			uint8_t b = eepromAccess.readByte(offset++);
+			crc = crc16Update(crc, b);
+			if (i<sizeof(value))
+				value[i] = b;
+		}
+		uint16_t stored = eepromAccess.readByte(offset) | (eepromAccess.readByte(offset+1)<<8);
+		offset += RECORD_CRC_SIZE;
+		if (stored!=crc)
+			break;		// cut short, or left over from an earlier list
+		if (tag==RECORD_TAG_END)
+			return true;
+		if (tag==RECORD_TAG_DEVICE && length>=DEVICE_PIN_SIZE && value[0]<count)
+			decodeDevice(value, length, devices[value[0]]);
+	}
+	// the devices before the damaged record are kept
+	return false;
+}
+
+#endif
@@ -0,0 +1,71 @@
+/*
+ * Copyright 2013 BrewPi/Elco Jacobs.
+ * Copyright 2013 Matthew McGowan
+ *
+ * This file is part of BrewPi.
+ * 
+ * BrewPi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * BrewPi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with BrewPi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "Brewpi.h"
+#include "EepromAccess.h"
+
+class DeviceConfig;
+
+/* Record tags. Readers skip records with tags they don't know. */
+#define RECORD_TAG_DEVICE 1
+#define RECORD_TAG_END 0xFE		// the last record, has no value
+
+/**
+ * The configuration in eeprom format 5, as a list of tag-length-value records. Each record is a tag byte, a length
+ * byte, the value and a CRC. Only configured devices have a record, so slots can be added without reserving space
+ * for them. A device record holds the slot, chamber, beer, function, hardware with the flags, and pin, followed by
+ * the address and the pio or calibration for onewire devices.
+ *
+ * The records are rewritten from the device table when a device changes. Bytes that are unchanged are not written.
+ * The CRC of a record covers all records from the start of the list up to and including it, so when a power loss
+ * cuts a rewrite short, the records before the cut still load, and a record left over from the previous list
+ * doesn't. Only a list that reaches the end record is complete.
+ */
+class EepromRecords
+{
+public:
+	/**
+	 * Reads the devices into a table indexed by slot. Slots without a record are cleared.
+	 * Returns false when the records are incomplete. The table then holds the devices before the first damaged record.
+	 */
+	static bool loadDevices(DeviceConfig* devices, uint8_t count);
+
+	/**
+	 * Writes the records for the devices in the table. Returns false and writes nothing when they don't fit.
+	 */
+	static bool storeDevices(const DeviceConfig* devices, uint8_t count);
+
+	/**
+	 * Bytes a device takes in the records, 0 for an unused slot.
+	 */
+	static uint8_t deviceSize(const DeviceConfig& config);
+
+	/**
+	 * Bytes the records of the devices take, including the end record.
+	 */
+	static uint16_t devicesSize(const DeviceConfig* devices, uint8_t count);
+
+	/**
+	 * Bytes available for records.
+	 */
+	static uint16_t capacity();
+};
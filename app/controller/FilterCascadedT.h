@@ -0,0 +1,195 @@
+/*
+ * Copyright 2013 BrewPi/Elco Jacobs.
+ * Copyright 2013 Matthew McGowan.
+ *
+ * This file is part of BrewPi.
+ * 
+ * BrewPi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * BrewPi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with BrewPi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "Brewpi.h"
+#include "TemperatureFormats.h"
+#include "FilterFixed.h"
+
+/*
+ * Cascaded filters with the same response as CascadedFilter (see FilterFixed.h), but with the b value as a template argument.
+ * FixedFilter shifts by its runtime a and b values on every sample, which is slow on the AVR, where a shift by a
+ * variable amount is a loop of single bit shifts. With b known at compile time, the shifts are by constant amounts,
+ * and the sections are unrolled.
+ * The outputs are bit-exact with CascadedFilter. This is checked by the filter benchmarks in benchmark/.
+ */
+
+/*
+ * The largest b value that CascadedFilterDispatch has a compiled filter for, at most 6. Larger b values are rejected.
+ * Each b value adds a copy of the filter code, so this can be lowered to save flash.
+ */
+#ifndef CASCADED_FILTER_MAX_B
+#define CASCADED_FILTER_MAX_B 6
+#endif
+
+#if CASCADED_FILTER_MAX_B>6
+#error CASCADED_FILTER_MAX_B can be at most 6
+#endif
+
+/* The state of one second order section. */
+struct FilterSection {
+	temperature_precise xv[3];
+	temperature_precise yv[3];
+
+	void init(temperature val) {
+		temperature_precise precise = tempRegularToPrecise(val);
+		for (uint8_t i=0; i<3; i++) {
+			xv[i] = precise;
+			yv[i] = precise;
+		}
+	}
+};
+
+/* Adds a value to a section, with a = 2b+4. Same calculation as FixedFilter::addDoublePrecision. */
+template <uint8_t B>
+inline temperature_precise addToFilterSection(FilterSection& s, temperature_precise val) {
+	const uint8_t A = B*2+4;
+	s.xv[2] = s.xv[1];
+	s.xv[1] = s.xv[0];
+	s.xv[0] = val;
+
+	s.yv[2] = s.yv[1];
+	s.yv[1] = s.yv[0];
+
+	s.yv[0] = ((s.yv[1] - s.yv[2]) + s.yv[1])
+	- (s.yv[1]>>B) + (s.yv[2]>>B) +
+	+ (s.xv[0]>>A) + (s.xv[1]>>(A-1)) + (s.xv[2]>>A)
+	- (s.yv[2]>>(A-2));
+
+	return s.yv[0];
+}
+
+/* Feeds the value through the sections, the output of each section is the input of the next. Unrolled by the compiler. */
+template <uint8_t Sections, uint8_t B>
+struct FilterCascade {
+	static temperature_precise add(FilterSection* sections, temperature_precise val) {
+		return FilterCascade<Sections-1, B>::add(sections+1, addToFilterSection<B>(*sections, val));
+	}
+};
+
+template <uint8_t B>
+struct FilterCascade<0, B> {
+	static temperature_precise add(FilterSection* sections, temperature_precise val) {
+		return val;
+	}
+};
+
+/* Filter state and the functions that do not depend on b. */
+template <uint8_t Sections>
+class CascadedFilterBase {
+	public:
+	FilterSection sections[Sections];
+
+	void init(temperature val) {
+		for (uint8_t i=0; i<Sections; i++)
+			sections[i].init(val);
+	}
+
+	temperature readInput(void) {
+		return sections[0].xv[0]>>16; // return input of first section
+	}
+
+	temperature readOutput(void) {
+		return sections[Sections-1].yv[0]>>16; // return output of last section
+	}
+
+	temperature_precise readOutputDoublePrecision(void) {
+		return sections[Sections-1].yv[0];
+	}
+
+	temperature_precise readPrevOutputDoublePrecision(void) {
+		return sections[Sections-1].yv[1];
+	}
+
+	temperature detectPosPeak(void) {
+		const temperature_precise* yv = sections[Sections-1].yv;
+		return (yv[0] < yv[1] && yv[1] >= yv[2]) ? tempPreciseToRegular(yv[1]) : INVALID_TEMP;
+	}
+
+	temperature detectNegPeak(void) {
+		const temperature_precise* yv = sections[Sections-1].yv;
+		return (yv[0] > yv[1] && yv[1] <= yv[2]) ? tempPreciseToRegular(yv[1]) : INVALID_TEMP;
+	}
+};
+
+/* A cascaded filter with a b value fixed at compile time. */
+template <uint8_t Sections, uint8_t B>
+class CascadedFilterT : public CascadedFilterBase<Sections> {
+	public:
+	temperature_precise addDoublePrecision(temperature_precise val) {
+		return FilterCascade<Sections, B>::add(this->sections, val);
+	}
+
+	temperature add(temperature val) {
+		return tempPreciseToRegular(addDoublePrecision(tempRegularToPrecise(val)));
+	}
+};
+
+/*
+ * A cascaded filter with a b value that is set at runtime, such as the filter settings stored in eeprom.
+ * setCoefficients() selects the compiled filter for the b value, so each sample costs one indirect call.
+ * A drop-in replacement for CascadedFilter, except that b values above CASCADED_FILTER_MAX_B are not accepted.
+ */
+template <uint8_t Sections>
+class CascadedFilterDispatch : public CascadedFilterBase<Sections> {
+	typedef temperature_precise (*AddFn)(FilterSection* sections, temperature_precise val);
+	AddFn addFn;
+
+	public:
+	CascadedFilterDispatch() {
+		setCoefficients(2); // default to a b value of 2
+	}
+
+	/* Returns false and keeps the current b value when there is no compiled filter for bValue. */
+	bool setCoefficients(uint8_t bValue) {
+		switch (bValue) {
+#if CASCADED_FILTER_MAX_B>0
+			case 0: addFn = &FilterCascade<Sections, 0>::add; break;
+#endif
+#if CASCADED_FILTER_MAX_B>1
+			case 1: addFn = &FilterCascade<Sections, 1>::add; break;
+#endif
+#if CASCADED_FILTER_MAX_B>2
+			case 2: addFn = &FilterCascade<Sections, 2>::add; break;
+#endif
+#if CASCADED_FILTER_MAX_B>3
+			case 3: addFn = &FilterCascade<Sections, 3>::add; break;
+#endif
+#if CASCADED_FILTER_MAX_B>4
+			case 4: addFn = &FilterCascade<Sections, 4>::add; break;
+#endif
+#if CASCADED_FILTER_MAX_B>5
+			case 5: addFn = &FilterCascade<Sections, 5>::add; break;
+#endif
+			case CASCADED_FILTER_MAX_B: addFn = &FilterCascade<Sections, CASCADED_FILTER_MAX_B>::add; break;
+			default: return false;
+		}
+		return true;
+	}
+
+	temperature_precise addDoublePrecision(temperature_precise val) {
+		return addFn(this->sections, val);
+	}
+
+	temperature add(temperature val) {
+		return tempPreciseToRegular(addDoublePrecision(tempRegularToPrecise(val)));
+	}
+};
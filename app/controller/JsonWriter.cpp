@@ -0,0 +1,114 @@
+/*
+ * Copyright 2013 BrewPi/Elco Jacobs.
+ * Copyright 2013 Matthew McGowan.
+ *
+ * This file is part of BrewPi.
+ * 
+ * BrewPi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * BrewPi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with BrewPi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Brewpi.h"
+#include "JsonWriter.h"
+
+static const uint32_t powersOf10[] PROGMEM = {
+	1000000000ul, 100000000ul, 10000000ul, 1000000ul, 100000ul, 10000ul, 1000ul, 100ul, 10ul, 1ul
+};
+
+#define MAX_DIGITS uint8_t(sizeof(powersOf10)/sizeof(powersOf10[0]))
+
+uint8_t JsonWriter::formatDigits(char* s, uint32_t value, uint8_t minDigits)
+{
+	uint8_t length = 0;
+	for (uint8_t i=0; i<MAX_DIGITS; i++) {
+		uint32_t power;
+		memcpy_P(&power, &powersOf10[i], sizeof(power));
+		char digit = '0';
+		while (value>=power) {
+			value -= power;
+			digit++;
+		}
+		// leading zeroes are skipped, unless they are needed for the minimum number of digits
+		if (length || digit!='0' || MAX_DIGITS-i<=minDigits)
+			s[length++] = digit;
+	}
+	return length;
+}
+
+void JsonWriter::writeKey(Print& p, const char* name, bool first)
+{
+	p.write(first ? '{' : ',');
+	p.write('"');
+	writeP(p, name);
+	p.write('"');
+	p.write(':');
+}
+
+void JsonWriter::writeP(Print& p, const char* s)
+{
+	char c;
+	while ((c = pgm_read_byte(s++)))
+		p.write(c);
+}
+
+void JsonWriter::writeString(Print& p, const char* s)
+{
+	if (s==NULL) {
+		writeP(p, PSTR("null"));
+		return;
+	}
+	p.write('"');
+	p.print(s);
+	p.write('"');
+}
+
+void JsonWriter::writeChar(Print& p, char c)
+{
+	p.write('"');
+	p.write(c);
+	p.write('"');
+}
+
+void JsonWriter::writeUnsigned(Print& p, uint32_t value)
+{
+	char digits[MAX_DIGITS];
+	p.write((const uint8_t*)digits, formatDigits(digits, value));
+}
+
+void JsonWriter::writeSigned(Print& p, int32_t value)
+{
+	uint32_t magnitude = value;
+	if (value<0) {
+		p.write('-');
+		magnitude = 0-magnitude;
+	}
+	writeUnsigned(p, magnitude);
+}
+
+void JsonWriter::writeFixedPoint(Print& p, long_temperature value, uint8_t numDecimals)
+{
+	char s[16];
+	p.print(fixedPointToString(s, value, numDecimals, sizeof(s)));
+}
+
+void JsonWriter::writeTemp(Print& p, long_temperature value, uint8_t numDecimals)
+{
+	char s[16];
+	p.print(tempToString(s, value, numDecimals, sizeof(s)));
+}
+
+void JsonWriter::writeTempDiff(Print& p, long_temperature value, uint8_t numDecimals)
+{
+	char s[16];
+	p.print(tempDiffToString(s, value, numDecimals, sizeof(s)));
+}
@@ -0,0 +1,56 @@
+/*
+ * Copyright 2013 BrewPi/Elco Jacobs.
+ * Copyright 2013 Matthew McGowan.
+ *
+ * This file is part of BrewPi.
+ * 
+ * BrewPi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * BrewPi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with BrewPi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "Brewpi.h"
+#include "TemperatureFormats.h"
+
+/*
+ * Writes JSON values straight to a Print, without going through printf and a format buffer.
+ * Numbers are converted to digits by subtracting powers of 10, so there is no division, which the AVR does in software.
+ */
+class JsonWriter {
+public:
+	/* Writes ,"name": or {"name": for the first pair of an object. The name must be in PROGMEM. */
+	static void writeKey(Print& p, const char* name, bool first);
+
+	/* Writes a string from PROGMEM. */
+	static void writeP(Print& p, const char* s);
+	/* Writes a string in quotes, or null. */
+	static void writeString(Print& p, const char* s);
+	static void writeChar(Print& p, char c);
+
+	static void writeUnsigned(Print& p, uint32_t value);
+	static void writeSigned(Print& p, int32_t value);
+
+	/*
+	 * Writes a value with TEMP_FIXED_POINT_BITS fraction bits with 1 to 3 decimals, in the format of fixedPointToString.
+	 */
+	static void writeFixedPoint(Print& p, long_temperature value, uint8_t numDecimals);
+	static void writeTemp(Print& p, long_temperature value, uint8_t numDecimals);
+	static void writeTempDiff(Print& p, long_temperature value, uint8_t numDecimals);
+
+	/*
+	 * Writes the decimal digits of value to s, with at least minDigits digits (padded with zeroes).
+	 * Returns the number of digits. s is not terminated.
+	 */
+	static uint8_t formatDigits(char* s, uint32_t value, uint8_t minDigits=1);
+};
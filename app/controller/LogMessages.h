@@ -28,8 +28,9 @@
 	It will give a warning when the two strings do not match.
 */
 
-/* bump this version number when changing this file and copy the new version to the brewpi-script repository. */
-#define BREWPI_LOG_MESSAGES_VERSION 1
+/* bump this version number when changing this file and copy the new version to the brewpi-script repository.
+ * The script knows messages by their position, so add new messages at the end of the enum. */
+#define BREWPI_LOG_MESSAGES_VERSION 6
 
 #define MSG(errorID, errorString, ...) errorID
 
@@ -51,6 +52,17 @@ enum errorMessages{
 
 // PiLink.cpp
 	MSG(ERROR_EXPECTED_BRACKET, "Expected { got %c", character),
+	MSG(ERROR_COMMAND_TOO_LONG, "JSON of command %c is too long and was discarded", command),
+	MSG(ERROR_INCOMPLETE_COMMAND, "JSON of command %c was not completed and was discarded", command),
+
+// DeviceManager.cpp
+	MSG(ERROR_INVALID_DEVICE_SLOT, "Device slot %d is missing, out of range or listed twice", slot),
+	MSG(ERROR_DUPLICATE_DEVICE_FUNCTION, "Device function %d is also assigned to device %d", config.deviceFunction, otherSlot),
+	MSG(ERROR_DUPLICATE_DEVICE_HARDWARE, "Device %d uses the same hardware as device %d", slot, otherSlot),
+	MSG(ERROR_NO_ROOM_FOR_DEVICE, "No room in the eeprom to store device %d", slot),
+
+// TempSensor.cpp
+	MSG(ERROR_INVALID_FILTER_COEFFICIENT, "Filter b value %d is not supported", b),
 	
 }; // END enum errorMessages
 
@@ -95,5 +107,8 @@ enum infoMessages{
 	MSG(INFO_POSITIVE_PEAK, "Positive peak detected: %s, estimated: %s. Previous heat estimator: %s, New heat estimator: %s.", temperature, temperature, estimator, estimator),
 	MSG(INFO_NEGATIVE_PEAK, "Negative peak detected: %s, estimated: %s. Previous cool estimator: %s, New cool estimator: %s.", temperature, temperature, estimator, estimator),
 	MSG(INFO_POSITIVE_DRIFT, "No peak detected. Drifting up after heating, current temp: %s, estimated peak: %s. Previous heat estimator: %s, New heat estimator: %s..", temperature, temperature, estimator, estimator),
-	MSG(INFO_NEGATIVE_DRIFT, "No peak detected. Drifting down after cooling, current temp: %s, estimated peak: %s. Previous cool estimator: %s, New cool estimator: %s..", temperature, temperature, estimator, estimator)	
+	MSG(INFO_NEGATIVE_DRIFT, "No peak detected. Drifting down after cooling, current temp: %s, estimated peak: %s. Previous cool estimator: %s, New cool estimator: %s..", temperature, temperature, estimator, estimator),
+
+// EepromManager.cpp
+	MSG(INFO_EEPROM_UPGRADED, "EEPROM upgraded from format %d", version)
 }; // END enum infoMessages
@@ -23,35 +23,58 @@
 #include "PiLink.h"
 #include "TemperatureFormats.h"
 #include "JsonKeys.h"
-
-static const char PROGMEM LOG_STRING_FORMAT[] = "\"%s\"";
+#include "PiLinkFrames.h"
+#include "JsonWriter.h"
 
 void Logger::logMessageVaArg(char type, LOG_ID_TYPE errorID, const char * varTypes, ...){
 	va_list args;
+#if BREWPI_PILINK_FRAMES
+	if (piLink.isFramed()) {
+		PiLinkFrames::begin('D');
+		PiLinkFrames::write(type);
+		PiLinkFrames::write(errorID);
+		PiLinkFrames::writeString(varTypes);
+		va_start (args, varTypes);
+		for (const char* t = varTypes; *t; t++) {
+			if (*t=='s')
+				PiLinkFrames::writeString(va_arg(args, char*));
+			else	// integers, temperatures and fixed point values
+				PiLinkFrames::write16(va_arg(args, int));
+		}
+		va_end (args);
+		PiLinkFrames::end();
+		return;
+	}
+#endif
 	piLink.printResponse('D');
 	piLink.sendJsonPair(JSONKEY_logType, type);
 	piLink.sendJsonPair(JSONKEY_logID, errorID);
-	piLink.print_P(PSTR(",\"V\":["));
+	piLink.printJsonName(PSTR("V"));
+	Print& p = piLink.stream();
+	p.print('[');
 	va_start (args, varTypes);
 	uint8_t index = 0;
-	char buf[9];
 	while(varTypes[index]){
 		switch(varTypes[index]){	
 			case 'd': // integer, signed or unsigned
-				piLink.print_P(STR_FMT_D, va_arg(args, int));
+				JsonWriter::writeSigned(p, va_arg(args, int));
 				break;
 			case 's': // string
-				piLink.print_P(LOG_STRING_FORMAT, va_arg(args, char*));
+				JsonWriter::writeString(p, va_arg(args, char*));
 				break;
 			case 't': // temperature in fixed_7_9 format
-				piLink.print_P(LOG_STRING_FORMAT, tempToString(buf, va_arg(args,int), 1, 12));
+				p.print('"');
+				JsonWriter::writeTemp(p, temperature(va_arg(args,int)), 1);
+				p.print('"');
 			break;
 			case 'f': // fixed point value
-				piLink.print_P(LOG_STRING_FORMAT, fixedPointToString(buf, (temperature) va_arg(args,int), 3, 12));
+				p.print('"');
+				JsonWriter::writeFixedPoint(p, temperature(va_arg(args,int)), 3);
+				p.print('"');
 			break;			
 		}
 		if(varTypes[++index]){
-			piLink.print(',');
+			p.print(',');
 		}
 	}
 	va_end (args);
@@ -0,0 +1,59 @@
+/*
+ * Copyright 2013 BrewPi/Elco Jacobs.
+ * Copyright 2013 Matthew McGowan.
+ *
+ * This file is part of BrewPi.
+ * 
+ * BrewPi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * BrewPi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with BrewPi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Brewpi.h"
+#include "LoopTiming.h"
+
+#if BREWPI_LOOP_TIMING
+
+PhaseTiming LoopTiming::phases[NUM_LOOP_PHASES];
+
+void LoopTiming::reset()
+{
+	memset(phases, 0, sizeof(phases));
+}
+
+void LoopTiming::record(LoopPhase phase, uint32_t duration)
+{
+	PhaseTiming& t = phases[phase];
+	if (!t.count || duration<t.min)
+		t.min = duration;
+	if (duration>t.max)
+		t.max = duration;
+	
+	if (t.total+duration<t.total || t.count==0xFFFFFFFFul) {
+		// keep the mean when the total would overflow
+		t.total >>= 1;
+		t.count >>= 1;
+	}
+	t.total += duration;
+	t.count++;
+
+	uint8_t bucket = 0;
+	duration >>= LOOP_TIMING_FIRST_BUCKET_BITS;
+	while (duration && bucket<LOOP_TIMING_BUCKETS-1) {
+		duration >>= 2;
+		bucket++;
+	}
+	if (t.histogram[bucket]<0xFFFF)
+		t.histogram[bucket]++;
+}
+
+#endif
@@ -0,0 +1,74 @@
+/*
+ * Copyright 2013 BrewPi/Elco Jacobs.
+ * Copyright 2013 Matthew McGowan.
+ *
+ * This file is part of BrewPi.
+ * 
+ * BrewPi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * BrewPi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with BrewPi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "Brewpi.h"
+
+/**
+ * The phases of the main loop that are timed.
+ */
+enum LoopPhase {
+	PHASE_UPDATE_TEMPERATURES,
+	PHASE_DETECT_PEAKS,
+	PHASE_UPDATE_PID,
+	PHASE_UPDATE_STATE,
+	PHASE_UPDATE_OUTPUTS,
+	PHASE_UI,
+	PHASE_DISPLAY,
+	PHASE_RECEIVE,
+	PHASE_TRANSMIT,
+	PHASE_EEPROM,
+	NUM_LOOP_PHASES
+};
+
+/*
+ * Histogram buckets are a factor 4 apart: <16us, <64us, <256us, <1ms, <4ms, <16ms, <64ms and >=64ms.
+ */
+#define LOOP_TIMING_BUCKETS 8
+#define LOOP_TIMING_FIRST_BUCKET_BITS 4
+
+struct PhaseTiming {
+	uint32_t min;		// microseconds
+	uint32_t max;
+	uint32_t total;		// sum of all durations, used for the mean
+	uint32_t count;
+	uint16_t histogram[LOOP_TIMING_BUCKETS];	// saturating counts
+	
+	uint32_t mean() { return count ? total/count : 0; }
+};
+
+/**
+ * Collects the duration of each loop phase in microseconds.
+ */
+class LoopTiming {
+public:
+	static void reset();
+	static void record(LoopPhase phase, uint32_t duration);
+	
+	static PhaseTiming phases[NUM_LOOP_PHASES];
+};
+
+#if BREWPI_LOOP_TIMING
+/* Runs the statement and records how long it took as the given phase. */
+#define TIME_PHASE(phase, statement) { uint32_t phaseStart = micros(); statement; LoopTiming::record(phase, micros()-phaseStart); }
+#else
+#define TIME_PHASE(phase, statement) { statement; }
+#endif
@@ -34,6 +34,10 @@
 #include "EepromFormat.h"
 #include "SettingsManager.h"
 #include "Display.h"
+#include "LoopTiming.h"
+#include "PiLinkFrames.h"
+#include "PiLinkTxBuffer.h"
+#include "JsonWriter.h"
 
 #if BREWPI_SIMULATE
 #include "Simulator.h"
@@ -59,12 +63,13 @@
 	};
 
 	static MockSerial mockSerial;
-	#define piStream mockSerial
+	#define piSerial mockSerial
 #elif !defined(WIRING)
         StdIO stdIO;
-        #define piStream stdIO
+        #define piSerial stdIO
+        #define SERIAL_READY(x) 1
 #else
-	#define piStream Serial
+	#define piSerial Serial
 #ifdef SPARK
     #define SERIAL_READY(x) 1
 #else
@@ -72,11 +77,87 @@
 #endif        
 #endif
 
+#if BREWPI_PILINK_TX_BUFFER
+static PiLinkTxBuffer piLinkTxBuffer;
+#define piTx piLinkTxBuffer
+#else
+#define piTx piSerial
+#endif
+
+#if BREWPI_PILINK_FRAMES || BREWPI_PILINK_TX_BUFFER
+/*
+ * The stream used by piLink and the code that prints responses. In text mode output goes to the transmit buffer,
+ * in framed mode it is collected in text frames.
+ */
+class PiLinkStream : public Stream
+{
+	public:
+	void begin(unsigned long baud) { piSerial.begin(baud); }
+	int available() { return piSerial.available(); }
+	int read() { return piSerial.read(); }
+	int peek() { return piSerial.peek(); }
+	void flush() { piSerial.flush(); }
+	size_t write(uint8_t c) {
+#if BREWPI_PILINK_FRAMES
+		if (PiLink::isFramed())
+			PiLinkFrames::writeText(c);
+		else
+#endif
+			piTx.write(c);
+		return 1;
+	}
+	using Print::write;
+	operator bool() { return bool(piSerial); }
+};
+
+static PiLinkStream piLinkStream;
+#define piStream piLinkStream
+#else
+#define piStream piSerial
+#endif
+
+#if BREWPI_PILINK_FRAMES
+bool PiLink::framed;
+#endif
 bool PiLink::firstPair;
+char PiLink::commandBuffer[PILINK_COMMAND_SIZE];
+uint16_t PiLink::commandLength;
+char PiLink::pendingCommand;
+uint8_t PiLink::receiveState;
+uint16_t PiLink::receiveTime;
+bool PiLink::jsonReceived;
+uint16_t PiLink::jsonPairsEnd;
+bool PiLink::jsonInValue;
+bool PiLink::jsonPartApplied;
+uint16_t PiLink::nextRequestId;
+uint16_t PiLink::requestId;
+char PiLink::deviceResponse;
+bool PiLink::deviceResponseList;
 char PiLink::printfBuff[PRINTF_BUFFER_SIZE];
                 
 void PiLink::init(void){
 	piStream.begin(57600);	
+#if BREWPI_PILINK_TX_BUFFER
+	piLinkTxBuffer.init(piSerial);
+#endif
+#if BREWPI_PILINK_FRAMES
+	PiLinkFrames::init(piTx);
+#endif
+}
+
+void PiLink::transmit(void){
+#if BREWPI_PILINK_TX_BUFFER && PILINK_PORT_AVAILABLE_FOR_WRITE
+	int room = piSerial.availableForWrite();
+	piLinkTxBuffer.transmit(room>0 ? uint16_t(room) : 0);
+#elif BREWPI_PILINK_TX_BUFFER
+	piLinkTxBuffer.transmit();
+#endif
+}
+
+void PiLink::flush(void){
+#if BREWPI_PILINK_TX_BUFFER
+	piLinkTxBuffer.flush();
+#endif
 }
 
 extern void handleReset();
@@ -114,150 +195,394 @@ void printNibble(uint8_t n)
 	piStream.print((char)(n>=10 ? n-10+'A' : n+'0'));
 }
 
+#if BREWPI_PILINK_FRAMES
+static void handleVersionRequest(const char* key, const char* val, void* pv)
+{
+	if (key[0]=='f')
+		*(uint8_t*)pv = atol(val);
+}
+#endif
+
+/*
+ * Commands that can be followed by a JSON object. The object is collected as it arrives over any number of calls
+ * to receive(), and the command runs once the closing brace is in.
+ */
+static const char jsonCommands[] PROGMEM = "yjUdhPn";
+
+/*
+ * Commands that can also be followed by a JSON array of objects, see runArrayCommand(). Each object in the array is
+ * handled as soon as it is in, so only one object needs to fit in the command buffer.
+ */
+static const char jsonArrayCommands[] PROGMEM = "U";
+
+#define RECEIVE_COMMAND 0	// waiting for a command
+#define RECEIVE_OPEN 1		// a JSON command was received, waiting for the opening brace
+#define RECEIVE_JSON 2		// collecting the JSON object
+#define RECEIVE_ARRAY 3		// in a JSON array, waiting for the next object or the closing bracket
+#define RECEIVE_ELEMENT 4	// collecting an object in a JSON array
+#define RECEIVE_ID 5		// reading the digits of a request id
+
+/*
+ * A command can be preceded by a request id, as #id (1-65535). The replies to the command then carry the id, as
+ * in T#12:{...}, and the command is acknowledged when it completes, see endRequest(). The host can send up to
+ * PILINK_MAX_IN_FLIGHT commands, of PILINK_RECEIVE_WINDOW bytes together, without waiting for them to be acknowledged.
+ */
+
 void PiLink::receive(void){
+	if (receiveState!=RECEIVE_COMMAND) {
+		uint16_t idle = uint16_t(::millis())-receiveTime;
+		if (receiveState==RECEIVE_OPEN && idle>=PILINK_JSON_START_TIMEOUT && !piStream.available()) {
+			// the command is not followed by JSON
+			commandBuffer[0] = 0;
+			runCommand(pendingCommand);
+		}
+		else if (receiveState>=RECEIVE_JSON && receiveState!=RECEIVE_ID && idle>=PILINK_JSON_TIMEOUT) {
+			// the host gave up on the command, what follows is a new command
+			requestId = nextRequestId;
+			logErrorInt(ERROR_INCOMPLETE_COMMAND, pendingCommand);
+			receiveState = RECEIVE_COMMAND;
+			endRequest();
+		}
+	}
+
 	while (piStream.available() > 0) {
-		char inByte = piStream.read();              
-		switch(inByte){
-		case ' ':
-		case '\n':
-		case '\r':
-			break;
+		receiveTime = ::millis();
+		receiveChar(piStream.read());
+	}
+}
+
+/*
+ * Steps the receive state machine with the next character from the serial port.
+ */
+void PiLink::receiveChar(char inByte){
+	if (receiveState==RECEIVE_JSON || receiveState==RECEIVE_ELEMENT) {
+		if (inByte=='}') {
+			bool element = receiveState==RECEIVE_ELEMENT;
+			if (commandLength<PILINK_COMMAND_SIZE) {
+				commandBuffer[commandLength] = 0;
+				if (element) {
+					receiveState = RECEIVE_ARRAY;
+					runArrayCommand(pendingCommand, '{');
+				}
+				else
+					runCommand(pendingCommand);
+			}
+			else if (element) {
+				receiveState = RECEIVE_ARRAY;
+				runArrayCommand(pendingCommand, '!');
+			}
+			else {
+				requestId = nextRequestId;
+				logErrorInt(ERROR_COMMAND_TOO_LONG, pendingCommand);
+				receiveState = RECEIVE_COMMAND;
+				endRequest();
+			}
+		}
+		else if (inByte!=' ' && inByte!='"') {	// quotes and spaces are dropped, so they take no space
+			if (commandLength==PILINK_COMMAND_SIZE-1 && receiveState==RECEIVE_JSON && pendingCommand=='j' && jsonPairsEnd)
+				applyJsonPart();
+			if (commandLength<PILINK_COMMAND_SIZE-1) {
+				commandBuffer[commandLength++] = inByte;
+				if (inByte==':' || inByte==',') {
+					jsonInValue = !jsonInValue;
+					if (!jsonInValue)
+						jsonPairsEnd = commandLength;
+				}
+			}
+			else
+				commandLength = PILINK_COMMAND_SIZE;	// too long, the rest is discarded up to the closing brace
+		}
+		return;
+	}
+	if (receiveState==RECEIVE_ARRAY) {
+		if (inByte=='{') {
+			receiveState = RECEIVE_ELEMENT;
+			commandLength = 0;
+		}
+		else if (inByte==']') {
+			receiveState = RECEIVE_COMMAND;
+			runArrayCommand(pendingCommand, ']');
+		}
+		return;	// separators and spaces between the objects
+	}
+	if (receiveState==RECEIVE_ID) {
+		if (inByte>='0' && inByte<='9') {
+			nextRequestId = nextRequestId*10+(inByte-'0');
+			return;
+		}
+		receiveState = RECEIVE_COMMAND;		// the character after the id is the command
+	}
+	if (receiveState==RECEIVE_OPEN) {
+		if (inByte=='{') {
+			receiveState = RECEIVE_JSON;
+			commandLength = 0;
+			jsonPairsEnd = 0;
+			jsonInValue = false;
+			jsonPartApplied = false;
+			return;
+		}
+		if (inByte=='[' && strchr_P(jsonArrayCommands, pendingCommand)) {
+			receiveState = RECEIVE_ARRAY;
+			runArrayCommand(pendingCommand, '[');
+			return;
+		}
+		// the command is not followed by JSON, the character is the next command
+		commandBuffer[0] = inByte;
+		commandBuffer[1] = 0;
+		runCommand(pendingCommand);
+	}
+	if (inByte=='#') {
+		nextRequestId = 0;
+		receiveState = RECEIVE_ID;
+		return;
+	}
+	if (inByte && strchr_P(jsonCommands, inByte)) {
+		pendingCommand = inByte;
+		receiveState = RECEIVE_OPEN;
+		return;
+	}
+	runCommand(inByte);
+}
 
+/*
+ * Runs a command that is followed by a JSON array. It is called with '[' at the start of the array, with '{' for
+ * each object in it (the object is in commandBuffer), with '!' for an object that was too long and with ']' at the end.
+ */
+void PiLink::runArrayCommand(char command, char event){
+	jsonReceived = event=='{';
+	requestId = nextRequestId;
+	switch (command) {
+#if BREWPI_DEVICE_BATCH
+	case 'U': // update a batch of devices
+		switch (event) {
+			case '[': deviceManager.beginDeviceBatch(); break;
+			case '{': deviceManager.addDeviceBatchEntry(); break;
+			case '!': deviceManager.rejectDeviceBatch(); break;
+			default: deviceManager.applyDeviceBatch(piStream);
+		}
+		break;
+#endif
+	default:
+		if (event==']')
+			logWarningInt(WARNING_INVALID_COMMAND, command);
+	}
+	if (event==']')
+		endRequest();
+	else
+		requestId = 0;		// the id is used again for the next event
+}
+
+/*
+ * Runs a command. For commands that take JSON, the object is in commandBuffer when receiveState is RECEIVE_JSON.
+ * Otherwise commandBuffer holds the character that followed the command.
+ */
+void PiLink::runCommand(char inByte){
+	jsonReceived = receiveState==RECEIVE_JSON;
+	receiveState = RECEIVE_COMMAND;
+	if (inByte==' ' || inByte=='\n' || inByte=='\r')
+		return;		// a request id applies to the next command
+	requestId = nextRequestId;
+	switch(inByte){
 #if BREWPI_SIMULATE==1
-		case 'y':
-			parseJson(HandleSimulatorConfig);
-			break;
-		case 'Y':
-			printSimulatorSettings();
-			break;		
+	case 'y':
+		parseJson(HandleSimulatorConfig);
+		break;
+	case 'Y':
+		printSimulatorSettings();
+		break;		
 #endif						
-		case 'A': // alarm on
-			soundAlarm(true);
-			break;
-		case 'a': // alarm off
-			soundAlarm(false);
-			break;
-			
-		case 't': // temperatures requested
-			printTemperatures();      
-			break;		
-		case 'C': // Set default constants
-			tempControl.loadDefaultConstants();
-			display.printStationaryText(); // reprint stationary text to update to right degree unit
-			sendControlConstants(); // update script with new settings
-			logInfo(INFO_DEFAULT_CONSTANTS_LOADED);
-			break;
-		case 'S': // Set default settings
-			tempControl.loadDefaultSettings();
-			sendControlSettings(); // update script with new settings
-			logInfo(INFO_DEFAULT_SETTINGS_LOADED);
-			break;
-		case 's': // Control settings requested
-			sendControlSettings();
-			break;
-		case 'c': // Control constants requested
-			sendControlConstants();
-			break;
-		case 'v': // Control variables requested
-			sendControlVariables();
-			break;
-		case 'n':
-			// v version
-			// s shield type
-			// y: simulator			
-			// b: board
-			print_P(PSTR("N:{\"v\":\"%S\",\"n\":%d,\"c\":\"%S\",\"s\":%d,\"y\":%d,\"b\":\"%c\",\"l\":\"%d\"}"), 
-					PSTR(VERSION_STRING), 
-					BUILD_NUMBER,
-					PSTR(BUILD_NAME),
-#ifdef BREWPI_STATIC_CONFIG                
-					BREWPI_STATIC_CONFIG, 
+	case 'A': // alarm on
+		soundAlarm(true);
+		break;
+	case 'a': // alarm off
+		soundAlarm(false);
+		break;
+		
+	case 't': // temperatures requested
+		printTemperatures();      
+		break;		
+	case 'C': // Set default constants
+		tempControl.loadDefaultConstants();
+		display.printStationaryText(); // reprint stationary text to update to right degree unit
+		sendControlConstants(); // update script with new settings
+		logInfo(INFO_DEFAULT_CONSTANTS_LOADED);
+		break;
+	case 'S': // Set default settings
+		tempControl.loadDefaultSettings();
+		sendControlSettings(); // update script with new settings
+		logInfo(INFO_DEFAULT_SETTINGS_LOADED);
+		break;
+	case 's': // Control settings requested
+		sendControlSettings();
+		break;
+	case 'c': // Control constants requested
+		sendControlConstants();
+		break;
+	case 'v': // Control variables requested
+		sendControlVariables();
+		break;
+#if BREWPI_TELEMETRY
+	case 'P': // subscribe to values that are pushed every control period
+		subscribeTelemetry();
+		break;
+#endif
+	case 'n':
+#if BREWPI_PILINK_FRAMES
+		{
+			// n{"f":2} selects framed mode, n selects text mode. The reply is always text.
+			uint8_t frameVersion = 0;
+			if (jsonReceived)
+				parseJson(&handleVersionRequest, &frameVersion);
+			setFramed(false);
+			printVersion();
+			setFramed(frameVersion==PILINK_FRAME_VERSION);
+		}
 #else
-                    0,
-#endif                
-					BREWPI_SIMULATE, 
-					BREWPI_BOARD,
-					BREWPI_LOG_MESSAGES_VERSION);
-			printNewLine();
-			break;
-		case 'l': // Display content requested
-			printResponse('L');						
-			piStream.print('[');
-			char stringBuffer[21];
-			for(uint8_t i=0;i<4;i++){
-				display.getLine(i, stringBuffer);
-				print_P(PSTR("\"%s\""), stringBuffer);
-				char close = (i<3) ? ',':']';
-				piStream.print(close);
-			}							
-			printNewLine();						
-			break;
-		case 'j': // Receive settings as json
-			receiveJson();
-			break;
+		printVersion();
+#endif
+		break;
+	case 'l': // Display content requested
+		printResponse('L');						
+		piStream.print('[');
+		char stringBuffer[21];
+		for(uint8_t i=0;i<4;i++){
+			display.getLine(i, stringBuffer);
+			JsonWriter::writeString(piStream, stringBuffer);
+			char close = (i<3) ? ',':']';
+			piStream.print(close);
+		}							
+		printNewLine();						
+		break;
+	case 'j': // Receive settings as json
+		receiveJson();
+		break;
+
+#if BREWPI_LOOP_TIMING
+	case 'm': // loop timing statistics requested
+		sendLoopTiming();
+		break;
+	case 'M': // reset loop timing statistics
+		LoopTiming::reset();
+#if BREWPI_PILINK_TX_BUFFER
+		piLinkTxBuffer.resetStatistics();
+#endif
+		break;
+#endif
+#if BREWPI_PILINK_TX_BUFFER
+	case 'b': // transmit buffer statistics requested
+		sendTxStatistics();
+		break;
+#endif
 
 #if BREWPI_EEPROM_HELPER_COMMANDS
-		case 'e': // dump contents of eeprom						
-			openListResponse('E');
-			for (uint16_t i=0; i<1024;) {
-				if (i>0) {
-					piLink.printNewLine();
-					piLink.print(',');
-				}
-				piLink.print('\"');
-				for (uint8_t j=0; j<64; j++) {
-					uint8_t d = eepromAccess.readByte(i++);
-					printNibble(d>>4);
-					printNibble(d);
-				}				
-				piLink.print('\"');
+	case 'e': // dump contents of eeprom						
+		openListResponse('E');
+		for (uint16_t i=0; i<1024;) {
+			if (i>0) {
+				piLink.printNewLine();
+				piLink.print(',');
 			}
-			closeListResponse();
-			break;
+			piLink.print('\"');
+			for (uint8_t j=0; j<64; j++) {
+				uint8_t d = eepromAccess.readByte(i++);
+				printNibble(d>>4);
+				printNibble(d);
+			}				
+			piLink.print('\"');
+		}
+		closeListResponse();
+		break;
 #endif
-			
-		case 'E': // initialize eeprom
-			eepromManager.initializeEeprom();
-			logInfo(INFO_EEPROM_INITIALIZED);
-			settingsManager.loadSettings();
-			break;
-
-		case 'd': // list devices in eeprom order
-			openListResponse('d');
-			deviceManager.listDevices(piStream);
-			closeListResponse();
-			break;
-
-		case 'U': // update device		
-			//printResponse('U'); // moved into function below, because installing devices can cause printing in between
-			deviceManager.parseDeviceDefinition(piStream);
-			//piLink.printNewLine();
-			break;
-			
-		case 'h': // hardware query
-			openListResponse('h');
-			deviceManager.enumerateHardware(piStream);
-			closeListResponse();
-			break;
+		
+	case 'W': // write changed settings to the eeprom now
+		eepromManager.commit();
+		break;
+
+	case 'E': // initialize eeprom
+		eepromManager.initializeEeprom();
+		logInfo(INFO_EEPROM_INITIALIZED);
+		settingsManager.loadSettings();
+		break;
+
+	case 'd': // list devices in eeprom order
+		openDeviceResponse('d', true);
+		deviceManager.listDevices(piStream);
+		closeDeviceResponse();
+		break;
+
+	case 'U': // update device		
+		//printResponse('U'); // moved into function below, because installing devices can cause printing in between
+		deviceManager.parseDeviceDefinition(piStream);
+		//piLink.printNewLine();
+		break;
+		
+	case 'h': // hardware query
+		openDeviceResponse('h', true);
+		deviceManager.enumerateHardware(piStream);
+		closeDeviceResponse();
+		break;
 
 #if (BREWPI_DEBUG > 0)			
-		case 'Z': // zap eeprom
-			eepromManager.zapEeprom();
-			logInfo(INFO_EEPROM_ZAPPED);
-			break;
+	case 'Z': // zap eeprom
+		eepromManager.zapEeprom();
+		logInfo(INFO_EEPROM_ZAPPED);
+		break;
 #endif
 
-		case 'R': // reset 
+	case 'R': // reset 
+                        eepromManager.commit();
+                        flush();
                         handleReset();
                         break;
-		default:
-			logWarningInt(WARNING_INVALID_COMMAND, inByte);
-		}
+	default:
+		logWarningInt(WARNING_INVALID_COMMAND, inByte);
 	}
+	endRequest();
 }
 
 
 
+void PiLink::printVersion(){
+	// v version
+	// s shield type
+	// y: simulator			
+	// b: board
+	// f: binary frame protocol version, 0 if not supported
+	// w: number of commands the host may send before the first is acknowledged
+	// r: number of bytes of unacknowledged commands the host may send
+	printResponse('N');
+	print_P(PSTR("{\"v\":\"" PRINTF_PROGMEM_STRING "\",\"n\":%d,\"c\":\"" PRINTF_PROGMEM_STRING "\",\"s\":%d,\"y\":%d,\"b\":\"%c\",\"l\":\"%d\",\"f\":%d,\"w\":%d,\"r\":%d}"), 
+			PSTR(VERSION_STRING), 
+			BUILD_NUMBER,
+			PSTR(BUILD_NAME),
+#ifdef BREWPI_STATIC_CONFIG                
+			BREWPI_STATIC_CONFIG, 
+#else
+			0,
+#endif                
+			BREWPI_SIMULATE, 
+			BREWPI_BOARD,
+			BREWPI_LOG_MESSAGES_VERSION,
+			BREWPI_PILINK_FRAMES ? PILINK_FRAME_VERSION : 0,
+			PILINK_MAX_IN_FLIGHT,
+			PILINK_RECEIVE_WINDOW);
+	printNewLine();
+}
+
+#if BREWPI_PILINK_FRAMES
+void PiLink::setFramed(bool enable){
+	PiLinkFrames::flushText();
+	framed = enable;
+}
+#endif
+
+// Returns true if the value differs from the previous one, and stores it as the previous value
+typedef char* PChar;
+inline bool changed(uint8_t &a, uint8_t b) { uint8_t c = a; a=b; return b!=c; }
+inline bool changed(temperature &a, temperature b) { temperature c = a; a=b; return b!=c; }
+inline bool changed(double &a, double b) { double c = a; a=b; return b!=c; }
+inline bool changed(PChar &a, PChar b) { PChar c = a; a=b; return b!=c; }
+
 #define COMPACT_SERIAL BREWPI_SIMULATE
 #if COMPACT_SERIAL
 	#define JSON_BEER_TEMP  "bt"
@@ -275,11 +600,7 @@ void PiLink::receive(void){
 	uint8_t state = 0xFF;
 	char* beerAnn; char* fridgeAnn;
 	
-	typedef char* PChar;
-	inline bool changed(uint8_t &a, uint8_t b) { uint8_t c = a; a=b; return b!=c; }
-	inline bool changed(temperature &a, temperature b) { temperature c = a; a=b; return b!=c; }
-	inline bool changed(double &a, double b) { double c = a; a=b; return b!=c; }
-	inline bool changed(PChar &a, PChar b) { PChar c = a; a=b; return b!=c; }
+	#define reportChanged(a,b) changed(a,b)
 #else
 	#define JSON_BEER_TEMP  "BeerTemp"
 	#define JSON_BEER_SET	"BeerSet"
@@ -291,62 +612,86 @@ void PiLink::receive(void){
 	#define JSON_TIME		"Time"
 	#define JSON_ROOM_TEMP  "RoomTemp"
 	
-	#define changed(a,b)  1
+	#define reportChanged(a,b)  1
 #endif
 
 void PiLink::printTemperaturesJSON(char * beerAnnotation, char * fridgeAnnotation){
+#if BREWPI_PILINK_FRAMES
+	if (framed) {
+		sendTemperaturesFrame(beerAnnotation, fridgeAnnotation);
+		return;
+	}
+#endif
 	printResponse('T');	
 
 	temperature t;
 	t = tempControl.getBeerTemp();
-	if (changed(beerTemp, t))
+	if (reportChanged(beerTemp, t))
 		sendJsonTemp(PSTR(JSON_BEER_TEMP), t);
 	
 	t = tempControl.getBeerSetting();
-	if (changed(beerSet,t))
+	if (reportChanged(beerSet,t))
 		sendJsonTemp(PSTR(JSON_BEER_SET), t);
 		
-	if (changed(beerAnn, beerAnnotation))
+	if (reportChanged(beerAnn, beerAnnotation))
 		sendJsonAnnotation(PSTR(JSON_BEER_ANN), beerAnnotation);
 
 	t = tempControl.getFridgeTemp();
-	if (changed(fridgeTemp, t))
+	if (reportChanged(fridgeTemp, t))
 		sendJsonTemp(PSTR(JSON_FRIDGE_TEMP), t);
 
 	t = tempControl.getFridgeSetting();
-	if (changed(fridgeSet, t))
+	if (reportChanged(fridgeSet, t))
 		sendJsonTemp(PSTR(JSON_FRIDGE_SET), t);
 	
-	if (changed(fridgeAnn, fridgeAnnotation))
+	if (reportChanged(fridgeAnn, fridgeAnnotation))
 		sendJsonAnnotation(PSTR(JSON_FRIDGE_ANN), fridgeAnnotation);
 		
 	t = tempControl.getRoomTemp();
-	if (tempControl.ambientSensor->isConnected() && changed(roomTemp, t))
+	if (tempControl.ambientSensor->isConnected() && reportChanged(roomTemp, t))
 		sendJsonTemp(PSTR(JSON_ROOM_TEMP), tempControl.getRoomTemp());
 		
-	if (changed(state, tempControl.getState()))
+	if (reportChanged(state, tempControl.getState()))
 		sendJsonPair(PSTR(JSON_STATE), tempControl.getState());		
 
 #if BREWPI_SIMULATE	
 	printJsonName(PSTR(JSON_TIME));
-	print_P(PSTR("%lu"), ticks.millis()/1000);
+	JsonWriter::writeUnsigned(piStream, ticks.millis()/1000);
 #endif		
 	sendJsonClose();	
 }
 
+#if BREWPI_PILINK_FRAMES
+void PiLink::sendTemperaturesFrame(const char* beerAnnotation, const char* fridgeAnnotation)
+{
+	PiLinkFrames::begin('T');
+	PiLinkFrames::write16(tempControl.getBeerTemp());
+	PiLinkFrames::write16(tempControl.getBeerSetting());
+	PiLinkFrames::write16(tempControl.getFridgeTemp());
+	PiLinkFrames::write16(tempControl.getFridgeSetting());
+	PiLinkFrames::write16(tempControl.ambientSensor->isConnected() ? tempControl.getRoomTemp() : temperature(INVALID_TEMP));
+	PiLinkFrames::write(tempControl.getState());
+	PiLinkFrames::write32(ticks.millis()/1000);
+	PiLinkFrames::writeString(beerAnnotation);
+	PiLinkFrames::writeString(fridgeAnnotation);
+	PiLinkFrames::end();
+}
+#endif
+
 void PiLink::sendJsonAnnotation(const char* name, const char* annotation)
 {
 	printJsonName(name);
-	const char* fmtAnn = annotation ? PSTR("\"%s\"") : PSTR("null");
-	print_P(fmtAnn, annotation);
+	JsonWriter::writeString(piStream, annotation);
 }
 
 void PiLink::sendJsonTemp(const char* name, temperature temp)
 {
-	char tempString[9];
-	tempToString(tempString, temp, 2, 9);
 	printJsonName(name);
-	piStream.print(tempString);
+	JsonWriter::writeTemp(piStream, temp, 2);
+}
+
+Print& PiLink::stream(void){
+	return piStream;
 }
 
 void PiLink::printTemperatures(void){
@@ -376,10 +721,37 @@ void PiLink::printFridgeAnnotation(const char * annotation, ...){
  	  
 void PiLink::printResponse(char type) {
 	piStream.print(type);
+	if (requestId) {
+		piStream.print('#');
+		JsonWriter::writeUnsigned(piStream, requestId);
+	}
 	piStream.print(':');
 	firstPair = true;
 }
 
+/*
+ * Acknowledges the command the host gave a request id, with K#id:{} or a 'K' frame holding the id (uint16), so
+ * the host knows all replies to it have been sent.
+ */
+void PiLink::endRequest() {
+	if (requestId) {
+#if BREWPI_PILINK_FRAMES
+		if (framed) {
+			PiLinkFrames::begin('K');
+			PiLinkFrames::write16(requestId);
+			PiLinkFrames::end();
+		}
+		else
+#endif
+		{
+			printResponse('K');
+			piStream.print('{');
+			sendJsonClose();
+		}
+	}
+	requestId = nextRequestId = 0;
+}
+
 void PiLink::openListResponse(char type) {
 	printResponse(type);
 	piStream.print('[');
@@ -390,6 +762,35 @@ void PiLink::closeListResponse() {
 	printNewLine();
 }
 
+void PiLink::openDeviceResponse(char type, bool list) {
+	deviceResponse = type;
+	deviceResponseList = list;
+#if BREWPI_PILINK_FRAMES
+	if (framed)
+		return;
+#endif
+	if (list)
+		openListResponse(type);
+	else
+		printResponse(type);
+}
+
+void PiLink::closeDeviceResponse() {
+#if BREWPI_PILINK_FRAMES
+	if (framed) {
+		if (deviceResponseList) {	// an empty frame ends the list
+			PiLinkFrames::begin(deviceResponse);
+			PiLinkFrames::end();
+		}
+		return;
+	}
+#endif
+	if (deviceResponseList)
+		closeListResponse();
+	else
+		printNewLine();
+}
+
 
 void PiLink::debugMessage(const char * message, ...){
 	va_list args;
@@ -411,19 +812,6 @@ void PiLink::sendJsonClose() {
 	printNewLine();
 }
 
-// Send settings as JSON string
-void PiLink::sendControlSettings(void){
-	char tempString[12];
-	printResponse('S');
-	ControlSettings& cs = tempControl.cs;
-	sendJsonPair(JSONKEY_mode, cs.mode);
-	sendJsonPair(JSONKEY_beerSetting, tempToString(tempString, cs.beerSetting, 2, 12));
-	sendJsonPair(JSONKEY_fridgeSetting, tempToString(tempString, cs.fridgeSetting, 2, 12));
-	sendJsonPair(JSONKEY_heatEstimator, fixedPointToString(tempString, cs.heatEstimator, 3, 12));
-	sendJsonPair(JSONKEY_coolEstimator, fixedPointToString(tempString, cs.coolEstimator, 3, 12));	
-	sendJsonClose();
-}
-
 // where the offset is relative to. This saves having to store a full 16-bit pointer.
 // becasue the structs are static, we can only compute an offset relative to the struct (cc,cs,cv etc..)
 // rather than offset from tempControl. 
@@ -442,18 +830,22 @@ void PiLink::jsonOutputUint16(const char* key, uint8_t offset) {
  * The temperature is assumed to be an internal fixed point value.
  */
 void PiLink::jsonOutputTempToString(const char* key,  uint8_t offset) {
-	char buf[12];
-	piLink.sendJsonPair(key, tempToString(buf, *((temperature*)(jsonOutputBase+offset)), 1, 12));
+	printJsonName(key);
+	JsonWriter::writeTemp(piStream, *((temperature*)(jsonOutputBase+offset)), 1);
 }
 
 void PiLink::jsonOutputFixedPointToString(const char* key, uint8_t offset) {
-	char buf[12];
-	piLink.sendJsonPair(key, fixedPointToString(buf, *((temperature*)(jsonOutputBase+offset)), 3, 12));
+	printJsonName(key);
+	JsonWriter::writeFixedPoint(piStream, *((temperature*)(jsonOutputBase+offset)), 3);
 }
 
 void PiLink::jsonOutputTempDiffToString(const char* key, uint8_t offset) {
-	char buf[12];
-	piLink.sendJsonPair(key, tempDiffToString(buf, *((temperature*)(jsonOutputBase+offset)), 3, 12));
+	printJsonName(key);
+	JsonWriter::writeTempDiff(piStream, *((temperature*)(jsonOutputBase+offset)), 3);
+}
+
+void PiLink::jsonOutputTempSetting(const char* key, uint8_t offset) {
+	sendJsonTemp(key, *((temperature*)(jsonOutputBase+offset)));
 }
 
 void PiLink::jsonOutputChar(const char* key, uint8_t offset) {	
@@ -469,6 +861,7 @@ enum JsonOutputIndex {
 	JOCC_TEMP_DIFF=3,
 	JOCC_CHAR=4,
 	JOCC_UINT16=5,
+	JOCC_TEMP_SETTING=6,
 };
 
 const PiLink::JsonOutputHandler PiLink::JsonOutputHandlers[] = {
@@ -478,6 +871,7 @@ const PiLink::JsonOutputHandler PiLink::JsonOutputHandlers[] = {
 	PiLink::jsonOutputTempDiffToString,
 	PiLink::jsonOutputChar,
 	PiLink::jsonOutputUint16,
+	PiLink::jsonOutputTempSetting,
 };
 
 #define JSON_OUTPUT_CC_MAP(name, fn) { JSONKEY_ ## name,  offsetof(ControlConstants, name), fn }
@@ -516,20 +910,70 @@ const PiLink::JsonOutput PiLink::jsonOutputCCMap[] PROGMEM = {
 	
 };
 
-void PiLink::sendJsonValues(char responseType, const JsonOutput* /*PROGMEM*/ jsonOutputMap, uint8_t mapCount) {
+bool PiLink::jsonValueChanged(const JsonOutput& output, const uint8_t* previous) {
+	uint8_t size = (output.handlerOffset==JOCC_UINT8 || output.handlerOffset==JOCC_CHAR) ? 1 : 2;
+	return memcmp(jsonOutputBase+output.offset, previous+output.offset, size)!=0;
+}
+
+/*
+ * Sends the values in the map, read relative to jsonOutputBase. When previous is given, only the values that differ
+ * from the same offset in previous are sent, and nothing is sent when none differ. Frames always hold all values.
+ */
+void PiLink::sendJsonValues(char responseType, const JsonOutput* /*PROGMEM*/ jsonOutputMap, uint8_t mapCount, const uint8_t* previous) {
+	JsonOutput output;
+	if (previous) {
+		uint8_t i = 0;
+		for (; i<mapCount; i++) {
+			memcpy_P(&output, &jsonOutputMap[i], sizeof(output));
+			if (jsonValueChanged(output, previous))
+				break;
+		}
+		if (i==mapCount)
+			return;
+	}
+#if BREWPI_PILINK_FRAMES
+	if (framed) {
+		PiLinkFrames::begin(responseType);
+		while (mapCount-->0) {
+			memcpy_P(&output, jsonOutputMap++, sizeof(output));
+			uint8_t* value = jsonOutputBase+output.offset;
+			if (output.handlerOffset==JOCC_UINT8 || output.handlerOffset==JOCC_CHAR)
+				PiLinkFrames::write(*value);
+			else	// temperatures, fixed point values and uint16
+				PiLinkFrames::write16(*(uint16_t*)value);
+		}
+		PiLinkFrames::end();
+		return;
+	}
+#endif
 	printResponse(responseType);
 	while (mapCount-->0) {
-		JsonOutput output;
 		memcpy_P(&output, jsonOutputMap++, sizeof(output));
+		if (previous && !jsonValueChanged(output, previous))
+			continue;
 		JsonOutputHandlers[output.handlerOffset](output.key,output.offset);
 	}
 	sendJsonClose();
 }
 
+const PiLink::JsonOutput PiLink::jsonOutputCSMap[] PROGMEM = {
+	JSON_OUTPUT_CS_MAP(mode, JOCC_CHAR),
+	JSON_OUTPUT_CS_MAP(beerSetting, JOCC_TEMP_SETTING),
+	JSON_OUTPUT_CS_MAP(fridgeSetting, JOCC_TEMP_SETTING),
+	JSON_OUTPUT_CS_MAP(heatEstimator, JOCC_FIXED_POINT),
+	JSON_OUTPUT_CS_MAP(coolEstimator, JOCC_FIXED_POINT)
+};
+
+// Send settings as JSON string
+void PiLink::sendControlSettings(const ControlSettings* previous){
+	jsonOutputBase = (uint8_t*)&tempControl.cs;
+	sendJsonValues('S', jsonOutputCSMap, sizeof(jsonOutputCSMap)/sizeof(jsonOutputCSMap[0]), (const uint8_t*)previous);
+}
+
 // Send control constants as JSON string. Might contain spaces between minus sign and number. Python will have to strip these
-void PiLink::sendControlConstants(void){
+void PiLink::sendControlConstants(const ControlConstants* previous){
 	jsonOutputBase = (uint8_t*)&tempControl.cc;
-	sendJsonValues('C', jsonOutputCCMap, sizeof(jsonOutputCCMap)/sizeof(jsonOutputCCMap[0]));	
+	sendJsonValues('C', jsonOutputCCMap, sizeof(jsonOutputCCMap)/sizeof(jsonOutputCCMap[0]), (const uint8_t*)previous);
 }
 
 const PiLink::JsonOutput PiLink::jsonOutputCVMap[] PROGMEM = {
@@ -552,13 +996,259 @@ void PiLink::sendControlVariables(void){
 	sendJsonValues('V', jsonOutputCVMap, sizeof(jsonOutputCVMap)/sizeof(jsonOutputCVMap[0]));
 }
 
+#if BREWPI_TELEMETRY
+static const char TELEMETRY_BEER_TEMP[] PROGMEM = JSON_BEER_TEMP;
+static const char TELEMETRY_FRIDGE_TEMP[] PROGMEM = JSON_FRIDGE_TEMP;
+static const char TELEMETRY_ROOM_TEMP[] PROGMEM = JSON_ROOM_TEMP;
+static const char TELEMETRY_STATE[] PROGMEM = JSON_STATE;
+
+enum TelemetrySource {
+	TELEMETRY_SENSORS,	// offset is one of the TelemetrySensor values
+	TELEMETRY_CS,		// offset into tempControl.cs
+	TELEMETRY_CV		// offset into tempControl.cv
+};
+
+enum TelemetrySensor { TELEMETRY_BEER, TELEMETRY_FRIDGE, TELEMETRY_ROOM, TELEMETRY_STATE_VALUE };
+
+struct TelemetryField {
+	const char* key;
+	uint8_t source;
+	uint8_t offset;
+	uint8_t handlerOffset;
+};
+
+#define TELEMETRY_SENSOR(key, sensor, fn) { key, TELEMETRY_SENSORS, sensor, fn }
+#define TELEMETRY_CS(name, fn) { JSONKEY_ ## name, TELEMETRY_CS, offsetof(ControlSettings, name), fn }
+#define TELEMETRY_CV(name, fn) { JSONKEY_ ## name, TELEMETRY_CV, offsetof(ControlVariables, name), fn }
+
+/* The fields the host can subscribe to. In framed mode, fields are identified by their index in this table. */
+static const TelemetryField telemetryFields[] PROGMEM = {
+	TELEMETRY_SENSOR(TELEMETRY_BEER_TEMP, TELEMETRY_BEER, JOCC_TEMP_FORMAT),
+	TELEMETRY_SENSOR(TELEMETRY_FRIDGE_TEMP, TELEMETRY_FRIDGE, JOCC_TEMP_FORMAT),
+	TELEMETRY_SENSOR(TELEMETRY_ROOM_TEMP, TELEMETRY_ROOM, JOCC_TEMP_FORMAT),
+	TELEMETRY_SENSOR(TELEMETRY_STATE, TELEMETRY_STATE_VALUE, JOCC_UINT8),
+
+	TELEMETRY_CS(mode, JOCC_CHAR),
+	TELEMETRY_CS(beerSetting, JOCC_TEMP_FORMAT),
+	TELEMETRY_CS(fridgeSetting, JOCC_TEMP_FORMAT),
+	TELEMETRY_CS(heatEstimator, JOCC_FIXED_POINT),
+	TELEMETRY_CS(coolEstimator, JOCC_FIXED_POINT),
+
+	TELEMETRY_CV(beerDiff, JOCC_TEMP_DIFF),
+	TELEMETRY_CV(diffIntegral, JOCC_TEMP_DIFF),
+	TELEMETRY_CV(beerSlope, JOCC_TEMP_DIFF),
+	TELEMETRY_CV(p, JOCC_FIXED_POINT),
+	TELEMETRY_CV(i, JOCC_FIXED_POINT),
+	TELEMETRY_CV(d, JOCC_FIXED_POINT),
+	TELEMETRY_CV(estimatedPeak, JOCC_TEMP_FORMAT),
+	TELEMETRY_CV(negPeakEstimate, JOCC_TEMP_FORMAT),
+	TELEMETRY_CV(posPeakEstimate, JOCC_TEMP_FORMAT),
+	TELEMETRY_CV(negPeak, JOCC_TEMP_FORMAT),
+	TELEMETRY_CV(posPeak, JOCC_TEMP_FORMAT)
+};
+
+#define TELEMETRY_FIELD_COUNT (sizeof(telemetryFields)/sizeof(telemetryFields[0]))
+#define TELEMETRY_OFF 0			// field is not subscribed
+#define TELEMETRY_ON_CHANGE 0xFF	// field is sent when it changes
+#define TELEMETRY_MAX_INTERVAL 254
+
+// per field: TELEMETRY_OFF, TELEMETRY_ON_CHANGE or the interval in control periods
+static uint8_t telemetryInterval[TELEMETRY_FIELD_COUNT];
+static uint8_t telemetryElapsed[TELEMETRY_FIELD_COUNT];
+static temperature telemetryLast[TELEMETRY_FIELD_COUNT];
+static uint32_t telemetryDue;		// bit per field, sent on the next push regardless of changes
+
+static temperature readTelemetryField(const TelemetryField& field)
+{
+	uint8_t* base;
+	switch (field.source) {
+		case TELEMETRY_SENSORS:
+			switch (field.offset) {
+				case TELEMETRY_BEER: return tempControl.getBeerTemp();
+				case TELEMETRY_FRIDGE: return tempControl.getFridgeTemp();
+				case TELEMETRY_ROOM: return tempControl.ambientSensor->isConnected() ? tempControl.getRoomTemp() : temperature(INVALID_TEMP);
+				default: return tempControl.getState();
+			}
+		case TELEMETRY_CS:
+			base = (uint8_t*)&tempControl.cs;
+			break;
+		default:
+			base = (uint8_t*)&tempControl.cv;
+	}
+	base += field.offset;
+	if (field.handlerOffset==JOCC_UINT8 || field.handlerOffset==JOCC_CHAR)
+		return *base;
+	return *(temperature*)base;
+}
+
+static void handleTelemetryField(const char* key, const char* val, void* pv)
+{
+	for (uint8_t i=0; i<TELEMETRY_FIELD_COUNT; i++) {
+		TelemetryField field;
+		memcpy_P(&field, &telemetryFields[i], sizeof(field));
+		if (strcmp_P(key, field.key) == 0) {
+			long interval = atol(val);
+			telemetryInterval[i] = interval<0 ? TELEMETRY_OFF : interval==0 ? TELEMETRY_ON_CHANGE
+				: interval>TELEMETRY_MAX_INTERVAL ? TELEMETRY_MAX_INTERVAL : uint8_t(interval);
+			return;
+		}
+	}
+	logWarning(WARNING_COULD_NOT_PROCESS_SETTING);
+}
+
+/*
+ * Replaces the subscriptions with the fields in the request, e.g. P{"BeerTemp":0,"State":0,"beerDiff":60}.
+ * The value is the number of control periods (seconds) between updates, or 0 to send the field only when it changes.
+ * The current values of all subscribed fields are sent as the reply. P{} ends all subscriptions.
+ */
+void PiLink::subscribeTelemetry()
+{
+	memset(telemetryInterval, TELEMETRY_OFF, sizeof(telemetryInterval));
+	parseJson(&handleTelemetryField);
+	telemetryDue = 0;
+	for (uint8_t i=0; i<TELEMETRY_FIELD_COUNT; i++) {
+		telemetryElapsed[i] = 0;
+		if (telemetryInterval[i]!=TELEMETRY_OFF)
+			telemetryDue |= uint32_t(1)<<i;
+	}
+	sendTelemetry();
+}
+
+void PiLink::pushTelemetry()
+{
+	for (uint8_t i=0; i<TELEMETRY_FIELD_COUNT; i++) {
+		uint8_t interval = telemetryInterval[i];
+		if (interval!=TELEMETRY_OFF && interval!=TELEMETRY_ON_CHANGE && ++telemetryElapsed[i]>=interval) {
+			telemetryElapsed[i] = 0;
+			telemetryDue |= uint32_t(1)<<i;
+		}
+	}
+	sendTelemetry();
+}
+
+/*
+ * Sends the due fields and the on-change fields that changed since they were last sent, as a 'P' response.
+ * Nothing is sent when there are no such fields. In framed mode, each field is sent as its index (uint8) and value (int16).
+ */
+void PiLink::sendTelemetry()
+{
+	bool any = false;
+	for (uint8_t i=0; i<TELEMETRY_FIELD_COUNT; i++) {
+		if (telemetryInterval[i]==TELEMETRY_OFF)
+			continue;
+		TelemetryField field;
+		memcpy_P(&field, &telemetryFields[i], sizeof(field));
+		temperature value = readTelemetryField(field);
+		bool valueChanged = changed(telemetryLast[i], value);
+		if (!(telemetryDue & (uint32_t(1)<<i)) && !(telemetryInterval[i]==TELEMETRY_ON_CHANGE && valueChanged))
+			continue;
+#if BREWPI_PILINK_FRAMES
+		if (framed) {
+			if (!any)
+				PiLinkFrames::begin('P');
+			PiLinkFrames::write(i);
+			PiLinkFrames::write16(value);
+			any = true;
+			continue;
+		}
+#endif
+		if (!any)
+			printResponse('P');
+		if (field.source==TELEMETRY_SENSORS && field.handlerOffset==JOCC_TEMP_FORMAT)
+			sendJsonTemp(field.key, value);		// same precision as 't'
+		else {
+			jsonOutputBase = (uint8_t*)&value;
+			JsonOutputHandlers[field.handlerOffset](field.key, 0);
+		}
+		any = true;
+	}
+	telemetryDue = 0;
+	if (!any)
+		return;
+#if BREWPI_PILINK_FRAMES
+	if (framed) {
+		PiLinkFrames::end();
+		return;
+	}
+#endif
+	sendJsonClose();
+}
+#endif
+
+#if BREWPI_LOOP_TIMING
+static const char loopPhaseTemperatures[] PROGMEM = "temps";
+static const char loopPhasePeaks[] PROGMEM = "peaks";
+static const char loopPhasePid[] PROGMEM = "pid";
+static const char loopPhaseState[] PROGMEM = "state";
+static const char loopPhaseOutputs[] PROGMEM = "outputs";
+static const char loopPhaseUi[] PROGMEM = "ui";
+static const char loopPhaseDisplay[] PROGMEM = "display";
+static const char loopPhaseReceive[] PROGMEM = "receive";
+static const char loopPhaseTransmit[] PROGMEM = "transmit";
+static const char loopPhaseEeprom[] PROGMEM = "eeprom";
+
+// in the same order as the LoopPhase enum
+static const char* const loopPhaseNames[NUM_LOOP_PHASES] PROGMEM = {
+	loopPhaseTemperatures, loopPhasePeaks, loopPhasePid, loopPhaseState,
+	loopPhaseOutputs, loopPhaseUi, loopPhaseDisplay, loopPhaseReceive, loopPhaseTransmit, loopPhaseEeprom
+};
+
+/**
+ * Sends the timing statistics of each loop phase as a list of objects. All times are in microseconds.
+ * The histogram counts durations in buckets a factor 4 apart, starting with <16us.
+ */
+void PiLink::sendLoopTiming(void){
+	openListResponse('M');
+	for (uint8_t i=0; i<NUM_LOOP_PHASES; i++) {
+		PhaseTiming& t = LoopTiming::phases[i];
+		const char* name;
+		memcpy_P(&name, &loopPhaseNames[i], sizeof(name));
+		if (i)
+			piStream.print(',');
+		firstPair = true;
+		printJsonName(PSTR("n"));
+		piStream.print('"');
+		JsonWriter::writeP(piStream, name);
+		piStream.print('"');
+		sendJsonPair(PSTR("min"), t.min);
+		sendJsonPair(PSTR("max"), t.max);
+		sendJsonPair(PSTR("avg"), t.mean());
+		sendJsonPair(PSTR("cnt"), t.count);
+		printJsonName(PSTR("h"));
+		for (uint8_t b=0; b<LOOP_TIMING_BUCKETS; b++) {
+			piStream.print(b ? ',' : '[');
+			JsonWriter::writeUnsigned(piStream, t.histogram[b]);
+		}
+		piStream.print(']');
+		piStream.print('}');
+	}
+	closeListResponse();
+}
+#endif
+
+#if BREWPI_PILINK_TX_BUFFER
+/**
+ * Sends the size of the transmit buffer, the bytes waiting to be sent, the most that were ever waiting and the number of
+ * bytes that were written to the port directly because the buffer was full.
+ */
+void PiLink::sendTxStatistics(void){
+	// the statistics are read first, so the response itself is not part of them
+	uint16_t pending = piLinkTxBuffer.pending();
+	uint16_t peak = piLinkTxBuffer.peakPending();
+	uint32_t spilled = piLinkTxBuffer.spilledBytes();
+	printResponse('B');
+	sendJsonPair(PSTR("size"), uint16_t(PILINK_TX_BUFFER_SIZE));
+	sendJsonPair(PSTR("pending"), pending);
+	sendJsonPair(PSTR("peak"), peak);
+	sendJsonPair(PSTR("spilled"), spilled);
+	sendJsonClose();
+}
+#endif
+
 void PiLink::printJsonName(const char * name)
 {
-	printJsonSeparator();
-	piStream.print('"');
-	print_P(name);
-	piStream.print('"');
-	piStream.print(':');
+	JsonWriter::writeKey(piStream, name, firstPair);
+	firstPair = false;
 }
 
 inline void PiLink::printJsonSeparator() {
@@ -573,89 +1263,127 @@ void PiLink::sendJsonPair(const char * name, const char * val){
 
 void PiLink::sendJsonPair(const char * name, char val){
 	printJsonName(name);
-	piStream.print('"');
-	piStream.print(val);
-	piStream.print('"');
+	JsonWriter::writeChar(piStream, val);
 }
 
 void PiLink::sendJsonPair(const char * name, uint16_t val){
 	printJsonName(name);	
-	print_P(PSTR("%u"), val);
+	JsonWriter::writeUnsigned(piStream, val);
+}
+
+void PiLink::sendJsonPair(const char * name, uint32_t val){
+	printJsonName(name);	
+	JsonWriter::writeUnsigned(piStream, val);
 }
 
 void PiLink::sendJsonPair(const char * name, uint8_t val) {
 	sendJsonPair(name, (uint16_t)val);
 }
 
-int readNext()
+/*
+ * Calls fn with each key and value of the JSON object received with the command. Quotes and spaces have already been
+ * removed. Keys and values are separated by ':' or ',', nested objects and arrays are not supported.
+ * Returns false when the command has no JSON object.
+ */
+bool PiLink::parseJson(ParseJsonCallback fn, void* data) 
 {
-	uint8_t retries = 0;
-	while (piStream.available()==0) {
-		wait.microseconds(100);
-		retries++;
-		if(retries >= 10){
-			return -1;
-		}
+	if (!jsonReceived) {
+		logErrorInt(ERROR_EXPECTED_BRACKET, commandBuffer[0]);
+		return false;
 	}
-	return piStream.read();		
+	jsonReceived = false;		// the object can be parsed only once, other than with parseJsonAgain()
+	parseJsonAgain(fn, data);
+	return true;
 }
-/**
- * Parses a token from the piStream.
- * \return true if a token was parsed
+
+/*
+ * The tokens are terminated in place, so commandBuffer holds them as zero terminated strings after the first parse.
+ * Another parse then finds the same keys and values.
  */
-bool parseJsonToken(char* val) {
-	uint8_t index = 0;
-	val[0] = 0;
-	bool result = true;
-	for(;;) // get value
-	{
-		int character = readNext();
-		if (index==29 || character == '}' || character==-1) {
-			result = false;
-			break;
+void PiLink::parseJsonAgain(ParseJsonCallback fn, void* data)
+{
+	char* const last = commandBuffer+commandLength;
+	char* key = NULL;
+	char* token = commandBuffer;
+	for (;;) {
+		char* end = token+strcspn(token, ",:");
+		*end = 0;
+		if (key==NULL)
+			key = token;
+		else {
+			if (*key && *token)
+				fn(key, token, data);
+			key = NULL;
 		}
-		if(character == ',' || character==':')  // end of value
-			break;		
-		if(character == ' ' || character == '"'){
-			; // skip spaces and apostrophes
-		}		
-		else
-			val[index++] = character;
+		if (end>=last)
+			break;
+		token = end+1;
 	}
-	val[index]=0; // null terminate string
-	return result;	
 }
 
-void PiLink::parseJson(ParseJsonCallback fn, void* data) 
-{
-	char key[30];
-	char val[30];
-	*key = 0;
-	*val = 0;
-	bool next = true;
-	// read first open brace	
-	int c = readNext();		
-	if (c!='{')
-	{
-		logErrorInt(ERROR_EXPECTED_BRACKET, c);
-		return;
+void PiLink::validateJsonPair(const char* key, const char* val, void* pv){
+	JsonParserConvert converter;
+	if (!findJsonParserConverter(key, converter)) {
+		logInfoStringString(INFO_RECEIVED_SETTING, key, val);
+		logWarning(WARNING_COULD_NOT_PROCESS_SETTING);
+		*(bool*)pv = false;
 	}
-	do {
-		next = parseJsonToken(key) && parseJsonToken(val);
-		if (val[0] && key[0])
-			fn(key, val, data);
-	} while (next);
 }
 
+/*
+ * Applies the settings in the JSON object as one update. When one of the keys is unknown, none of them are applied.
+ * The eeprom is written once all settings are applied, and the reply only holds the settings and constants that changed.
+ * An object that doesn't fit in the command buffer is applied in parts, see applyJsonPart(), and the reply then holds
+ * all settings and constants.
+ */
 void PiLink::receiveJson(void){
+	bool valid = true;
+	if (!parseJson(&validateJsonPair, &valid))
+		return;
+	if (jsonPartApplied) {
+		if (valid)
+			applyJsonSettings();
+		sendControlSettings();
+		sendControlConstants();
+		return;
+	}
+	if (!valid)
+		return;
 
-	parseJson(&processJsonPair, NULL);	
-				
-#if !BREWPI_SIMULATE	// this is quite an overhead and not needed for the simulator
-	sendControlSettings();	// update script with new settings
-	sendControlConstants();
-#endif
-	return;
+	ControlSettings previousSettings = tempControl.cs;
+	ControlConstants previousConstants = tempControl.cc;
+	applyJsonSettings();
+
+	sendControlSettings(&previousSettings);
+	sendControlConstants(&previousConstants);
+}
+
+void PiLink::applyJsonSettings(void){
+	eepromManager.beginUpdate();
+	parseJsonAgain(&processJsonPair, NULL);
+	eepromManager.endUpdate();
+}
+
+/*
+ * Called when the settings object of a 'j' command fills the command buffer. The complete key/value pairs received
+ * so far are applied as one update, as receiveJson() does, and the pair that is still coming in is moved to the start
+ * of the buffer. This way a full set of settings and constants can be sent on the AVR, where the buffer only
+ * holds part of it.
+ */
+void PiLink::applyJsonPart(void){
+	uint16_t received = commandLength;
+	commandLength = jsonPairsEnd-1;		// without the separator after the last pair
+	commandBuffer[commandLength] = 0;
+	requestId = nextRequestId;
+	bool valid = true;
+	parseJsonAgain(&validateJsonPair, &valid);
+	if (valid)
+		applyJsonSettings();
+	requestId = 0;
+	commandLength = received-jsonPairsEnd;
+	memmove(commandBuffer, commandBuffer+jsonPairsEnd, commandLength);
+	jsonPairsEnd = 0;
+	jsonPartApplied = true;
 }
 
 
@@ -664,7 +1392,7 @@ static const char STR_TEMPERATURE_PROFILE[] PROGMEM = "by temperature profile";
 static const char STR_MODE[] PROGMEM = "Mode";
 static const char STR_BEER_TEMP[] PROGMEM = "Beer temp";
 static const char STR_FRIDGE_TEMP[] PROGMEM = "Fridge temp";
-static const char STR_FMT_SET_TO[] PROGMEM = "%S set to %s %S";
+static const char STR_FMT_SET_TO[] PROGMEM = PRINTF_PROGMEM_STRING " set to %s " PRINTF_PROGMEM_STRING;
 
 void PiLink::setMode(const char* val) {
 	char mode = val[0];
@@ -728,18 +1456,21 @@ void applyFilterSetting(const char* val, void* target) {
         	uint8_t offset = uint8_t((unsigned int) target);		// target is really just an integer
         #endif
         
-	FilterType filterType = FilterType(offset&3);
+	FilterType filterType = FilterType(offset%3);
 	TempSensorTarget sensorTarget = TempSensorTarget(offset/3);
 	
 	uint8_t value = atol(val);
-	uint8_t* const location = filterSettings[offset];
-	*location = value;
 	TempSensor* sensor = sensorTarget ? tempControl.beerSensor : tempControl.fridgeSensor;
+	bool valid = false;
 	switch (filterType) {
-		case FAST: sensor->setFastFilterCoefficients(value); break;
-		case SLOW: sensor->setSlowFilterCoefficients(value); break;
-		case SLOPE: sensor->setSlopeFilterCoefficients(value); break;
+		case FAST: valid = sensor->setFastFilterCoefficients(value); break;
+		case SLOW: valid = sensor->setSlowFilterCoefficients(value); break;
+		case SLOPE: valid = sensor->setSlopeFilterCoefficients(value); break;
 	}
+	if (!valid)
+		return;	// the sensor logged the rejected value, the setting is left as it was
+	uint8_t* const location = filterSettings[offset];
+	*location = value;
 	eepromManager.storeTempConstantsAndSettings();
 }
 
@@ -767,59 +1498,70 @@ void setBool(const char* value, uint8_t* target) {
 
 #define JSON_CONVERT(jsonKey, target, fn) { jsonKey, target, (JsonParserHandlerFn)&fn }
 
+/*
+ * Sorted by key in strcmp() order (upper case before lower case), so a key is found with a binary search.
+ * Keep the order when adding a setting, the PiLinkTest unit test checks it.
+ */
 const PiLink::JsonParserConvert PiLink::jsonParserConverters[] PROGMEM = {
-	JSON_CONVERT(JSONKEY_mode, NULL, setMode),
+	JSON_CONVERT(JSONKEY_Kd, &tempControl.cc.Kd, setStringToFixedPoint),
+	JSON_CONVERT(JSONKEY_Ki, &tempControl.cc.Ki, setStringToFixedPoint),
+	JSON_CONVERT(JSONKEY_Kp, &tempControl.cc.Kp, setStringToFixedPoint),
+	JSON_CONVERT(JSONKEY_beerFastFilter, MAKE_FILTER_SETTING_TARGET(FAST, BEER), applyFilterSetting),
 	JSON_CONVERT(JSONKEY_beerSetting, NULL, setBeerSetting),
+	JSON_CONVERT(JSONKEY_beerSlopeFilter, MAKE_FILTER_SETTING_TARGET(SLOPE, BEER), applyFilterSetting),
+	JSON_CONVERT(JSONKEY_beerSlowFilter, MAKE_FILTER_SETTING_TARGET(SLOW, BEER), applyFilterSetting),
+	JSON_CONVERT(JSONKEY_coolEstimator, &tempControl.cs.coolEstimator, setStringToFixedPoint),
+	JSON_CONVERT(JSONKEY_coolingTargetUpper, &tempControl.cc.coolingTargetUpper, setStringToTempDiff),
+	JSON_CONVERT(JSONKEY_coolingTargetLower, &tempControl.cc.coolingTargetLower, setStringToTempDiff),
+	JSON_CONVERT(JSONKEY_fridgeFastFilter, MAKE_FILTER_SETTING_TARGET(FAST, FRIDGE), applyFilterSetting),
 	JSON_CONVERT(JSONKEY_fridgeSetting, NULL, setFridgeSetting),
-	
+	JSON_CONVERT(JSONKEY_fridgeSlopeFilter, MAKE_FILTER_SETTING_TARGET(SLOPE, FRIDGE), applyFilterSetting),
+	JSON_CONVERT(JSONKEY_fridgeSlowFilter, MAKE_FILTER_SETTING_TARGET(SLOW, FRIDGE), applyFilterSetting),
 	JSON_CONVERT(JSONKEY_heatEstimator, &tempControl.cs.heatEstimator, setStringToFixedPoint),
-	JSON_CONVERT(JSONKEY_coolEstimator, &tempControl.cs.coolEstimator, setStringToFixedPoint),
-	
-	JSON_CONVERT(JSONKEY_tempFormat, NULL, setTempFormat),
-	
-	JSON_CONVERT(JSONKEY_tempSettingMin, &tempControl.cc.tempSettingMin, setStringToTemp),
-	JSON_CONVERT(JSONKEY_tempSettingMax, &tempControl.cc.tempSettingMax, setStringToTemp),
-	JSON_CONVERT(JSONKEY_pidMax, &tempControl.cc.pidMax, setStringToTempDiff),
-
-	JSON_CONVERT(JSONKEY_Kp, &tempControl.cc.Kp, setStringToFixedPoint),
-	JSON_CONVERT(JSONKEY_Ki, &tempControl.cc.Ki, setStringToFixedPoint),
-	JSON_CONVERT(JSONKEY_Kd, &tempControl.cc.Kd, setStringToFixedPoint),
-
+	JSON_CONVERT(JSONKEY_heatingTargetUpper, &tempControl.cc.heatingTargetUpper, setStringToTempDiff),
+	JSON_CONVERT(JSONKEY_heatingTargetLower, &tempControl.cc.heatingTargetLower, setStringToTempDiff),
+	JSON_CONVERT(JSONKEY_rotaryHalfSteps, &tempControl.cc.rotaryHalfSteps, setBool),
 	JSON_CONVERT(JSONKEY_iMaxError, &tempControl.cc.iMaxError, setStringToTempDiff),
 	JSON_CONVERT(JSONKEY_idleRangeHigh, &tempControl.cc.idleRangeHigh, setStringToTempDiff),
 	JSON_CONVERT(JSONKEY_idleRangeLow, &tempControl.cc.idleRangeLow, setStringToTempDiff),
-	JSON_CONVERT(JSONKEY_heatingTargetUpper, &tempControl.cc.heatingTargetUpper, setStringToTempDiff),
-	JSON_CONVERT(JSONKEY_heatingTargetLower, &tempControl.cc.heatingTargetLower, setStringToTempDiff),
-	JSON_CONVERT(JSONKEY_coolingTargetUpper, &tempControl.cc.coolingTargetUpper, setStringToTempDiff),
-	JSON_CONVERT(JSONKEY_coolingTargetLower, &tempControl.cc.coolingTargetLower, setStringToTempDiff),
-	JSON_CONVERT(JSONKEY_maxHeatTimeForEstimate, &tempControl.cc.maxHeatTimeForEstimate, setUint16),
-	JSON_CONVERT(JSONKEY_maxCoolTimeForEstimate, &tempControl.cc.maxCoolTimeForEstimate, setUint16),
 	JSON_CONVERT(JSONKEY_lightAsHeater, &tempControl.cc.lightAsHeater, setBool),
-	JSON_CONVERT(JSONKEY_rotaryHalfSteps, &tempControl.cc.rotaryHalfSteps, setBool),
-	
-	JSON_CONVERT(JSONKEY_fridgeFastFilter, MAKE_FILTER_SETTING_TARGET(FAST, FRIDGE), applyFilterSetting),
-	JSON_CONVERT(JSONKEY_fridgeSlowFilter, MAKE_FILTER_SETTING_TARGET(SLOW, FRIDGE), applyFilterSetting),
-	JSON_CONVERT(JSONKEY_fridgeSlopeFilter, MAKE_FILTER_SETTING_TARGET(SLOPE, FRIDGE), applyFilterSetting),
-	JSON_CONVERT(JSONKEY_beerFastFilter, MAKE_FILTER_SETTING_TARGET(FAST, BEER), applyFilterSetting),
-	JSON_CONVERT(JSONKEY_beerSlowFilter, MAKE_FILTER_SETTING_TARGET(SLOW, BEER), applyFilterSetting),
-	JSON_CONVERT(JSONKEY_beerSlopeFilter, MAKE_FILTER_SETTING_TARGET(SLOPE, BEER), applyFilterSetting)
-	
+	JSON_CONVERT(JSONKEY_maxCoolTimeForEstimate, &tempControl.cc.maxCoolTimeForEstimate, setUint16),
+	JSON_CONVERT(JSONKEY_maxHeatTimeForEstimate, &tempControl.cc.maxHeatTimeForEstimate, setUint16),
+	JSON_CONVERT(JSONKEY_mode, NULL, setMode),
+	JSON_CONVERT(JSONKEY_pidMax, &tempControl.cc.pidMax, setStringToTempDiff),
+	JSON_CONVERT(JSONKEY_tempFormat, NULL, setTempFormat),
+	JSON_CONVERT(JSONKEY_tempSettingMax, &tempControl.cc.tempSettingMax, setStringToTemp),
+	JSON_CONVERT(JSONKEY_tempSettingMin, &tempControl.cc.tempSettingMin, setStringToTemp)
 };
 
+const uint8_t PiLink::jsonParserConverterCount = sizeof(jsonParserConverters)/sizeof(jsonParserConverters[0]);
+
+bool PiLink::findJsonParserConverter(const char* key, JsonParserConvert& converter)
+{
+	uint8_t low = 0;
+	uint8_t high = jsonParserConverterCount;
+	while (low<high) {
+		uint8_t mid = (low+high)>>1;
+		memcpy_P(&converter, &jsonParserConverters[mid], sizeof(converter));
+		int cmp = strcmp_P(key, converter.key);
+		if (cmp==0)
+			return true;
+		if (cmp<0)
+			high = mid;
+		else
+			low = mid+1;
+	}
+	return false;
+}
+
 void PiLink::processJsonPair(const char * key, const char * val, void* pv){
 	logInfoStringString(INFO_RECEIVED_SETTING, key, val);
 	
-	for (uint8_t i=0; i<sizeof(jsonParserConverters)/sizeof(jsonParserConverters[0]); i++) {
-		JsonParserConvert converter;
-		memcpy_P(&converter, &jsonParserConverters[i], sizeof(converter));		
-		//logDeveloper("Handling converter %d %s %S %d %d"), i, key, converter.key, converter.fn, converter.target);
-		if (strcmp_P(key,converter.key) == 0) {
-			//logDeveloper("Handling json key %s"), key);
-			converter.fn(val, converter.target);
-			return;
-		}
-	}					
-	logWarning(WARNING_COULD_NOT_PROCESS_SETTING);
+	JsonParserConvert converter;
+	if (findJsonParserConverter(key, converter))
+		converter.fn(val, converter.target);
+	else
+		logWarning(WARNING_COULD_NOT_PROCESS_SETTING);
 }
 
 void PiLink::soundAlarm(bool active)
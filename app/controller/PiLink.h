@@ -27,7 +27,48 @@
 
 #define PRINTF_BUFFER_SIZE 128
 
+/**
+ * Maximum length of the JSON object of a command, without quotes and spaces. Longer commands are discarded, except
+ * for settings ('j'), which are applied in parts when they don't fit.
+ */
+#ifndef PILINK_COMMAND_SIZE
+#define PILINK_COMMAND_SIZE 512
+#endif
+
+/* Milliseconds a command that can take JSON waits for the opening brace, before it runs without JSON. */
+#ifndef PILINK_JSON_START_TIMEOUT
+#define PILINK_JSON_START_TIMEOUT 10
+#endif
+
+/*
+ * Milliseconds without input after which a partly received JSON object is discarded. This is well above the
+ * 1 second the simulator waits between reading the serial input.
+ */
+#ifndef PILINK_JSON_TIMEOUT
+#define PILINK_JSON_TIMEOUT 2500
+#endif
+
+/*
+ * Number of commands the host may send without waiting for them to be acknowledged, advertised in the version as "w".
+ * Commands vary in length, so this alone doesn't keep the serial receive buffer from overflowing: the host also keeps
+ * the unacknowledged bytes within PILINK_RECEIVE_WINDOW.
+ */
+#ifndef PILINK_MAX_IN_FLIGHT
+#define PILINK_MAX_IN_FLIGHT 8
+#endif
+
+/*
+ * Number of bytes of unacknowledged commands the host may send, advertised in the version as "r". These wait in the
+ * serial receive buffer while the controller is busy, so this is its size. The default is the USB receive buffer of
+ * the Spark.
+ */
+#ifndef PILINK_RECEIVE_WINDOW
+#define PILINK_RECEIVE_WINDOW 256
+#endif
+
 class DeviceConfig;
+struct ControlSettings;
+struct ControlConstants;
 
 
 class PiLink{
@@ -36,6 +77,10 @@ class PiLink{
 	// There can only be one PiLink object, so functions are static
 	static void init(void);
 	static void receive(void);
+	/* Sends the next part of the buffered output. Call this on every pass of the main loop. */
+	static void transmit(void);
+	/* Sends all buffered output, e.g. before a reset. */
+	static void flush(void);
 	
 	static void printFridgeAnnotation(const char * annotation, ...);	
 	static void printBeerAnnotation(const char * annotation, ...);
@@ -43,19 +88,43 @@ class PiLink{
 	static void debugMessage(const char * message, ...);
 
 	static void printTemperatures(void);
+
+	/* The stream responses are written to. */
+	static Print& stream(void);
+
+#if BREWPI_TELEMETRY
+	/* Sends the subscribed values that are due or changed. Called once per control period. */
+	static void pushTelemetry(void);
+#endif
 	
 	typedef void (*ParseJsonCallback)(const char* key, const char* val, void* data);
 
-	static void parseJson(ParseJsonCallback fn, void* data=NULL);
+	static bool parseJson(ParseJsonCallback fn, void* data=NULL);
+
+#if BREWPI_PILINK_FRAMES
+	static bool isFramed() { return framed; }
+#else
+	static bool isFramed() { return false; }
+#endif
 	
 	private:
 	
-	static void sendControlSettings(void);
+	/* With previous, only the values that differ from it are sent. */
+	static void sendControlSettings(const ControlSettings* previous=NULL);
 	static void receiveControlConstants(void);
-	static void sendControlConstants(void);
+	static void sendControlConstants(const ControlConstants* previous=NULL);
 	static void sendControlVariables(void);
+	static void sendLoopTiming(void);
+	static void sendTxStatistics(void);
+#if BREWPI_TELEMETRY
+	static void subscribeTelemetry(void);
+	static void sendTelemetry(void);
+#endif
 	
 	static void receiveJson(void); // receive settings as JSON key:value pairs
+	static void applyJsonSettings(void);
+	static void applyJsonPart(void);
+	static void parseJsonAgain(ParseJsonCallback fn, void* data);
 	
 	static void print(char *fmt, ...); // use when format string is stored in RAM
 	static void print(char c)       // inline for arduino
@@ -78,10 +147,12 @@ class PiLink{
 	static void sendJsonPair(const char * name, const char * val); // send one JSON pair with a string value as name:val,
 	static void sendJsonPair(const char * name, char val); // send one JSON pair with a char value as name:val,
 	static void sendJsonPair(const char * name, uint16_t val); // send one JSON pair with a uint16_t value as name:val,
+	static void sendJsonPair(const char * name, uint32_t val); // send one JSON pair with a uint32_t value as name:val,
 	static void sendJsonPair(const char * name, uint8_t val); // send one JSON pair with a uint8_t value as name:val,
 	static void sendJsonAnnotation(const char* name, const char* annotation);
 	static void sendJsonTemp(const char* name, temperature temp);
 	
+	static void validateJsonPair(const char * key, const char * val, void* pv); // check that the key is known
 	static void processJsonPair(const char * key, const char * val, void* pv); // process one pair
 	
 	/* Prints the name part of a json name/value pair. The name must exist in PROGMEM */
@@ -92,13 +163,30 @@ class PiLink{
 	static void openListResponse(char type);
 	static void closeListResponse();
 
+	/* A response with one device, or a list of devices. In framed mode, each device is sent in a frame of the response type. */
+	static void openDeviceResponse(char type, bool list);
+	static void closeDeviceResponse();
+	static char deviceResponseType() { return deviceResponse; }
+
+	static void printVersion();
+
+#if BREWPI_PILINK_FRAMES
+	static void setFramed(bool enable);
+	static void sendTemperaturesFrame(const char* beerAnnotation, const char* fridgeAnnotation);
+
+	static bool framed;
+#endif
+	static char deviceResponse;
+	static bool deviceResponseList;
+
 	struct JsonOutput {
 		const char* key;			// JSON key
 		uint8_t offset;			// offset into TempControl class
 		uint8_t handlerOffset;		// handler index
 	};
 	typedef void (*JsonOutputHandler)(const char* key, uint8_t offset);
-	static void sendJsonValues(char responseType, const JsonOutput* /*PROGMEM*/ jsonOutputMap, uint8_t mapCount);
+	static void sendJsonValues(char responseType, const JsonOutput* /*PROGMEM*/ jsonOutputMap, uint8_t mapCount, const uint8_t* previous=NULL);
+	static bool jsonValueChanged(const JsonOutput& output, const uint8_t* previous);
 
 
 	// handler functions for JSON output
@@ -108,8 +196,10 @@ class PiLink{
 	static void jsonOutputTempDiffToString(const char* key, uint8_t offset);
 	static void jsonOutputChar(const char* key, uint8_t offset);
 	static void jsonOutputUint16(const char* key, uint8_t offset);
+	static void jsonOutputTempSetting(const char* key, uint8_t offset);
 	static const JsonOutputHandler JsonOutputHandlers[];		
 	static const JsonOutput jsonOutputCCMap[];
+	static const JsonOutput jsonOutputCSMap[];
 	static const JsonOutput jsonOutputCVMap[];
 
 	// Json parsing
@@ -127,7 +217,10 @@ class PiLink{
 		JsonParserHandlerFn fn;
 	};
 
-	static const JsonParserConvert jsonParserConverters[];	
+	static const JsonParserConvert jsonParserConverters[];	// sorted by key
+	static const uint8_t jsonParserConverterCount;
+	/* Finds the converter for a setting key. Returns false if the key is unknown. */
+	static bool findJsonParserConverter(const char* key, JsonParserConvert& converter);
 		
 #if BREWPI_SIMULATE	
 	static void updateInputs();
@@ -138,8 +231,24 @@ class PiLink{
 	static void printDouble(double val);
 #endif	
 
+	static void receiveChar(char inByte);
+	static void runCommand(char command);
+	static void runArrayCommand(char command, char event);
+	static void endRequest();
+
 	private:
 	static bool firstPair;
+	static char commandBuffer[PILINK_COMMAND_SIZE];	// the JSON object of the command being received
+	static uint16_t commandLength;
+	static char pendingCommand;
+	static uint8_t receiveState;
+	static uint16_t receiveTime;	// low bits of millis() when the last character was received
+	static bool jsonReceived;		// commandBuffer holds the JSON object of the running command
+	static uint16_t jsonPairsEnd;	// length of the complete key/value pairs in commandBuffer, 0 if there are none
+	static bool jsonInValue;		// a key was received and its value is coming in
+	static bool jsonPartApplied;	// the start of the settings object was applied before the rest of it came in
+	static uint16_t nextRequestId;	// request id for the command being received, 0 when it has none
+	static uint16_t requestId;		// request id the replies carry, 0 outside of a command with an id
 	friend class DeviceManager;
 	friend class PiLinkTest;
 	friend class Logger;
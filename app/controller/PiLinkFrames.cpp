@@ -0,0 +1,122 @@
+/*
+ * Copyright 2013 BrewPi/Elco Jacobs.
+ * Copyright 2013 Matthew McGowan.
+ *
+ * This file is part of BrewPi.
+ * 
+ * BrewPi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * BrewPi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with BrewPi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Brewpi.h"
+#include "PiLinkFrames.h"
+#include "Crc16.h"
+
+#if BREWPI_PILINK_FRAMES
+
+uint8_t PiLinkFrames::buffer[PILINK_FRAME_SIZE+2];
+uint8_t PiLinkFrames::length;
+bool PiLinkFrames::text;
+Print* PiLinkFrames::output;
+
+uint16_t PiLinkFrames::crc16(uint16_t crc, uint8_t data)
+{
+	return crc16Update(crc, data);
+}
+
+void PiLinkFrames::begin(char type)
+{
+	if (text)
+		flushText();
+	buffer[0] = type;
+	length = 1;
+}
+
+void PiLinkFrames::write(uint8_t b)
+{
+	if (length<PILINK_FRAME_SIZE)
+		buffer[length++] = b;
+}
+
+void PiLinkFrames::write16(uint16_t v)
+{
+	write(uint8_t(v));
+	write(uint8_t(v>>8));
+}
+
+void PiLinkFrames::write32(uint32_t v)
+{
+	write16(uint16_t(v));
+	write16(uint16_t(v>>16));
+}
+
+void PiLinkFrames::writeString(const char* s)
+{
+	if (length>=PILINK_FRAME_SIZE)
+		return;
+	uint8_t len = s ? strlen(s) : 0;
+	uint8_t space = PILINK_FRAME_SIZE-1-length;
+	if (len>space)
+		len = space;
+	write(len);
+	while (len-->0)
+		write(*s++);
+}
+
+void PiLinkFrames::end()
+{
+	uint16_t crc = 0xFFFF;
+	for (uint8_t i=0; i<length; i++)
+		crc = crc16(crc, buffer[i]);
+	buffer[length] = uint8_t(crc);
+	buffer[length+1] = uint8_t(crc>>8);
+	send(length+2);
+	length = 0;
+	text = false;
+}
+
+void PiLinkFrames::writeText(uint8_t c)
+{
+	if (!text) {
+		begin(PILINK_FRAME_TEXT);
+		text = true;
+	}
+	buffer[length++] = c;
+	if (c=='\n' || length==PILINK_FRAME_SIZE)
+		end();
+}
+
+void PiLinkFrames::flushText()
+{
+	if (text)
+		end();
+}
+
+/*
+ * COBS encodes the buffer. Each run of non-zero bytes is preceded by its length+1, which replaces the zero that
+ * follows the run. The end of the buffer counts as a zero. Frames are shorter than 254 bytes, so a run never has to be split.
+ */
+void PiLinkFrames::send(uint8_t count)
+{
+	uint8_t start = 0;
+	for (uint8_t i=0; i<=count; i++) {
+		if (i==count || buffer[i]==0) {
+			output->write(uint8_t(i-start+1));
+			output->write(buffer+start, i-start);
+			start = i+1;
+		}
+	}
+	output->write(uint8_t(0));
+}
+
+#endif
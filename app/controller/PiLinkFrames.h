@@ -0,0 +1,103 @@
+/*
+ * Copyright 2013 BrewPi/Elco Jacobs.
+ * Copyright 2013 Matthew McGowan.
+ *
+ * This file is part of BrewPi.
+ * 
+ * BrewPi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * BrewPi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with BrewPi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "Brewpi.h"
+
+/*
+ * Binary framing for piLink, selected by the host with n{"f":PILINK_FRAME_VERSION}. Sending 'n' without arguments selects text mode again.
+ * Commands to the controller are text in both modes.
+ *
+ * In framed mode all output is sent as frames. A frame is a type byte and a payload, followed by the CRC-16/CCITT
+ * (polynomial 0x1021, initial value 0xFFFF) of the type and payload, low byte first. The frame is COBS encoded,
+ * so it contains no zero bytes, and is terminated by a zero byte.
+ *
+ * Frames of type PILINK_FRAME_TEXT carry the text output that has no binary form, such as the 'L' and 'E' responses
+ * and annotations. The payloads of successive text frames form the same text stream as in text mode, including line ends.
+ * The other frame types carry the binary form of a response, with the response character as the type.
+ * All values are little endian. Temperatures are the internal fixed point values: int16, 1/512 degree Celsius,
+ * offset by C_OFFSET (-48C). Temperature differences and fixed point values are int16 in 1/512 units.
+ * Strings are a length byte followed by the characters. INVALID_TEMP (-32768) is sent for a missing temperature.
+ *
+ *   'T' beerTemp, beerSet, fridgeTemp, fridgeSet, roomTemp (int16), state (uint8), time (uint32 seconds),
+ *       beer annotation, fridge annotation (strings, empty when there is no annotation)
+ *   'S' mode (char), beerSet, fridgeSet (temperatures), heatEst, coolEst (fixed point)
+ *   'C' the control constants in the order of the 'c' response. tempFormat, the filters, lah and hs are uint8,
+ *       maxHeatTimeForEst and maxCoolTimeForEst are uint16, the others int16.
+ *   'V' the control variables in the order of the 'v' response, all int16
+ *   'D' log message: type (char 'E', 'W' or 'I'), id (uint8), argument types (string of 'd', 's', 't', 'f'),
+ *       then each argument: 'd' int16, 's' string, 't' temperature, 'f' fixed point.
+ *   'd', 'h', 'U' one device: slot, device type, chamber, beer, function, hardware, pin, invert, deactivated (uint8),
+ *       address (8 bytes), calibration or pio (int8), value (string, empty when not requested),
+ *       milliseconds since the value was read (uint16, 0xFFFF when not known).
+ *       The 'd' and 'h' lists, and the 'U' list of a device batch, are ended by a frame of the same type without payload.
+ *   'P' subscribed values: for each value, the index of the field in the telemetry table in PiLink.cpp (uint8)
+ *       and the value (int16; mode and state are in the low byte).
+ *   'K' acknowledges a command that was sent with a request id: the id (uint16).
+ *
+ * Strings that don't fit in the frame are truncated.
+ */
+
+#define PILINK_FRAME_VERSION 2
+
+/* Type of frames with text output */
+#define PILINK_FRAME_TEXT 0x01
+
+/**
+ * Maximum size of the type and payload of a frame. Longer text output is split over several frames.
+ */
+#ifndef PILINK_FRAME_SIZE
+#define PILINK_FRAME_SIZE 160
+#endif
+
+#if PILINK_FRAME_SIZE>250
+#error PILINK_FRAME_SIZE must be below 251, so a COBS block never has to be split.
+#endif
+
+class PiLinkFrames {
+public:
+	/* Sets the port frames are written to. */
+	static void init(Print& port) { output = &port; }
+
+	/* Starts a frame of the given type. Pending text is sent first. */
+	static void begin(char type);
+	static void write(uint8_t b);
+	static void write16(uint16_t v);
+	static void write32(uint32_t v);
+	static void writeString(const char* s);
+	/* Appends the CRC and sends the frame. */
+	static void end();
+
+	/* Adds a character to the current text frame, which is sent at the end of each line or when it is full. */
+	static void writeText(uint8_t c);
+	/* Sends the text written so far. */
+	static void flushText();
+
+	static uint16_t crc16(uint16_t crc, uint8_t data);
+
+private:
+	static void send(uint8_t length);
+
+	static uint8_t buffer[PILINK_FRAME_SIZE+2];	// room for the CRC
+	static uint8_t length;
+	static bool text;
+	static Print* output;
+};
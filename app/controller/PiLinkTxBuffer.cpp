@@ -0,0 +1,75 @@
+/*
+ * Copyright 2013 BrewPi/Elco Jacobs.
+ * Copyright 2013 Matthew McGowan.
+ *
+ * This file is part of BrewPi.
+ * 
+ * BrewPi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * BrewPi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with BrewPi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Brewpi.h"
+#include "PiLinkTxBuffer.h"
+
+#if BREWPI_PILINK_TX_BUFFER
+
+size_t PiLinkTxBuffer::write(uint8_t c)
+{
+	if (count==PILINK_TX_BUFFER_SIZE) {
+		send(1);
+		spilled++;
+	}
+	uint16_t tail = head+count;
+	if (tail>=PILINK_TX_BUFFER_SIZE)
+		tail -= PILINK_TX_BUFFER_SIZE;
+	buffer[tail] = c;
+	if (++count>peak)
+		peak = count;
+	return 1;
+}
+
+void PiLinkTxBuffer::transmit()
+{
+	if (count>PILINK_TX_HIGH_WATERMARK)
+		send(count-PILINK_TX_LOW_WATERMARK);
+	else
+		send(count<PILINK_TX_CHUNK ? count : PILINK_TX_CHUNK);
+}
+
+void PiLinkTxBuffer::transmit(uint16_t room)
+{
+	send(count<room ? count : room);
+}
+
+void PiLinkTxBuffer::flush()
+{
+	send(count);
+}
+
+void PiLinkTxBuffer::send(uint16_t length)
+{
+	while (length) {
+		// the part up to the end of the buffer, then the part that wrapped around
+		uint16_t part = PILINK_TX_BUFFER_SIZE-head;
+		if (part>length)
+			part = length;
+		output->write(buffer+head, part);
+		head += part;
+		if (head==PILINK_TX_BUFFER_SIZE)
+			head = 0;
+		count -= part;
+		length -= part;
+	}
+}
+
+#endif
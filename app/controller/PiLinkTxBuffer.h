@@ -0,0 +1,94 @@
+/*
+ * Copyright 2013 BrewPi/Elco Jacobs.
+ * Copyright 2013 Matthew McGowan.
+ *
+ * This file is part of BrewPi.
+ * 
+ * BrewPi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * BrewPi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with BrewPi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "Brewpi.h"
+
+/**
+ * Size of the piLink transmit buffer in bytes.
+ */
+#ifndef PILINK_TX_BUFFER_SIZE
+#define PILINK_TX_BUFFER_SIZE 1024
+#endif
+
+/**
+ * Bytes sent to the serial port on each pass of the scheduler, when the port can't tell how much room it has
+ * (see PILINK_PORT_AVAILABLE_FOR_WRITE). The default is the size of the UART buffer of the Arduino core, which is
+ * about what the port can take without blocking.
+ */
+#ifndef PILINK_TX_CHUNK
+#define PILINK_TX_CHUNK 64
+#endif
+
+/*
+ * When the buffer fills past the high watermark, transmit() without a room argument sends until it is down to the
+ * low watermark, even if that blocks on the port.
+ */
+#define PILINK_TX_HIGH_WATERMARK (PILINK_TX_BUFFER_SIZE/4*3)
+#define PILINK_TX_LOW_WATERMARK (PILINK_TX_BUFFER_SIZE/4)
+
+/*
+ * Buffers the piLink output, so a long response such as a device list or an eeprom dump is collected in RAM and sent
+ * to the serial port a chunk at a time from the scheduler, instead of holding up the control task until the port has sent it.
+ * When the buffer is full, the oldest bytes are written to the port directly, which blocks as unbuffered output did.
+ * These bytes are counted as spilled.
+ */
+class PiLinkTxBuffer : public Print {
+public:
+	PiLinkTxBuffer() : head(0), count(0), peak(0), spilled(0), output(NULL) {}
+
+	/* Sets the port the buffered output is sent to. */
+	void init(Print& port) { output = &port; }
+
+	size_t write(uint8_t c);
+	using Print::write;
+
+	/*
+	 * Sends the next chunk of output to the port. Call this on every pass of the scheduler.
+	 * This is the fallback for ports that can't report their room: it sends PILINK_TX_CHUNK bytes, or drains the
+	 * buffer to the low watermark when it is past the high watermark, and the port may block on either.
+	 */
+	void transmit();
+	/*
+	 * Sends at most room bytes, the free space in the transmit buffer of the port, so sending never blocks.
+	 * Output that doesn't fit stays buffered until a later pass.
+	 */
+	void transmit(uint16_t room);
+	/* Sends all buffered output. */
+	void flush();
+
+	uint16_t pending() { return count; }
+	/* The highest number of bytes that were waiting to be sent. */
+	uint16_t peakPending() { return peak; }
+	/* The number of bytes that were written to the port directly, because the buffer was full. */
+	uint32_t spilledBytes() { return spilled; }
+	void resetStatistics() { peak = count; spilled = 0; }
+
+private:
+	void send(uint16_t length);
+
+	uint8_t buffer[PILINK_TX_BUFFER_SIZE];
+	uint16_t head;		// index of the oldest byte
+	uint16_t count;		// number of bytes waiting
+	uint16_t peak;
+	uint32_t spilled;
+	Print* output;
+};
@@ -0,0 +1,59 @@
+/*
+ * Copyright 2013 BrewPi/Elco Jacobs.
+ * Copyright 2013 Matthew McGowan.
+ *
+ * This file is part of BrewPi.
+ * 
+ * BrewPi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * BrewPi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with BrewPi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Brewpi.h"
+#include "Scheduler.h"
+
+void Scheduler::init(ScheduledTask* tasks, uint8_t count, ticks_millis_t now)
+{
+	for (uint8_t i=0; i<count; i++) {
+		tasks[i].due = now;
+		tasks[i].overruns = 0;
+	}
+}
+
+void Scheduler::run(ScheduledTask* tasks, uint8_t count, ticks_millis_t now)
+{
+	ScheduledTask* next = NULL;
+	for (uint8_t i=0; i<count; i++) {
+		ScheduledTask& t = tasks[i];
+		if (!t.period) {
+			t.run();
+			continue;
+		}
+		if (int32_t(t.due-now)>int32_t(t.period))
+			t.due = now;			// the clock was set back, don't wait for it to catch up
+		if (next==NULL && int32_t(now-t.due)>=0)
+			next = &t;				// first due task in the table has the highest priority
+	}
+	if (next==NULL)
+		return;
+
+	ticks_millis_t late = now-next->due;
+	if (late>next->deadline && next->overruns<255)
+		next->overruns++;
+
+	next->run();
+
+	// advance by whole periods so the task keeps a fixed timestep. If it is still due, it runs again on the next pass.
+	next->due += next->period;
+	if (late >= ticks_millis_t(next->period)*(next->maxCatchUp+1))
+		next->due = now+next->period;	// too far behind, drop the missed periods
+}
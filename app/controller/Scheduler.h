@@ -0,0 +1,60 @@
+/*
+ * Copyright 2013 BrewPi/Elco Jacobs.
+ * Copyright 2013 Matthew McGowan.
+ *
+ * This file is part of BrewPi.
+ * 
+ * BrewPi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * BrewPi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with BrewPi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "Brewpi.h"
+#include "Ticks.h"
+
+typedef void (*TaskFunction)(void);
+
+/**
+ * A task run periodically by the Scheduler. Tasks are declared in a table, the order in the table is the priority.
+ */
+struct ScheduledTask {
+	TaskFunction run;
+	uint16_t period;		// milliseconds between runs. 0 runs the task on every pass through the scheduler.
+	uint16_t deadline;		// milliseconds a run may start late before it is counted as an overrun.
+	uint8_t maxCatchUp;		// missed periods that are made up for by running again, keeping a fixed timestep. 
+							// When the task falls further behind, the missed periods are dropped.
+	ticks_millis_t due;		// time of the next run
+	uint8_t overruns;		// number of late starts, saturates at 255
+};
+
+/**
+ * Cooperative scheduler. Tasks are plain functions that run to completion; there is no preemption.
+ * Each pass runs all tasks with period 0 (such as serial receive) and at most one periodic task, so the latency of
+ * the every-pass tasks is bounded by the longest single periodic task, rather than by the sum of all of them.
+ */
+class Scheduler {
+public:
+	/**
+	 * Makes all periodic tasks due at the given time.
+	 */
+	static void init(ScheduledTask* tasks, uint8_t count, ticks_millis_t now);
+
+	/**
+	 * Runs one pass of the scheduler.
+	 */
+	static void run(ScheduledTask* tasks, uint8_t count, ticks_millis_t now);
+};
+
+#define SCHEDULED_TASK(fn, period, deadline, maxCatchUp) { fn, period, deadline, maxCatchUp, 0, 0 }
+#define SCHEDULED_TASK_COUNT(tasks) uint8_t(sizeof(tasks)/sizeof(tasks[0]))
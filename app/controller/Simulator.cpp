@@ -23,6 +23,9 @@
 
 #include "Display.h"
 #include "PiLink.h"
+#include "Scheduler.h"
+#include "LoopTiming.h"
+#include "SimulatorRecorder.h"
 
 #if BREWPI_SIMULATE
 
@@ -30,6 +33,7 @@ Simulator simulator;
 
 static temperature funFactor = 0;	// paused
 static unsigned long lastUpdate = 0;
+static bool headless = false;
 uint8_t printTempInterval = 5;
 
 void setRunFactor(temperature factor)
@@ -63,29 +67,31 @@ void updateSimulationTicks()
 #endif
 }
 
-void simulateLoop(void)
+static void simulateControlTask(void)
 {
-	static unsigned long lastUpdate = 0;
-	
-	// only needed if we want the arduino to be self running. Useful for manual testing, but not so much with an
-	// external driver.
-	updateSimulationTicks();
-	
-	if(ticks.millis() - lastUpdate >= (1000)) { //update settings every second
-		lastUpdate = ticks.millis();
-		
-		tempControl.updateTemperatures();
-		tempControl.detectPeaks();
-		tempControl.updatePID();
-		tempControl.updateState();
-		tempControl.updateOutputs();
+	TIME_PHASE(PHASE_UPDATE_TEMPERATURES, tempControl.updateTemperatures());
+	TIME_PHASE(PHASE_DETECT_PEAKS, tempControl.detectPeaks());
+	TIME_PHASE(PHASE_UPDATE_PID, tempControl.updatePID());
+	TIME_PHASE(PHASE_UPDATE_STATE, tempControl.updateState());
+	TIME_PHASE(PHASE_UPDATE_OUTPUTS, tempControl.updateOutputs());
+
+	static byte updateCount = 0;
+	bool report = printTempInterval && (++updateCount%printTempInterval)==0;
+	if (report)
+		updateCount = 0;
 
+	if (headless) {
+		// no serial output and no display, the state is only recorded
+		if (report)
+			SimulatorRecorder::record();
+	}
+	else {
 		#if !BREWPI_EMULATE			// simulation on actual hardware
-		static byte updateCount = 0;
-		if (printTempInterval && (++updateCount%printTempInterval)==0) {
+		if (report)
 			piLink.printTemperatures();
-			updateCount = 0;
-		}
+		#if BREWPI_TELEMETRY
+		piLink.pushTelemetry();
+		#endif
 		static unsigned long lastDisplayUpdate = 0;  // update the display every second
 		if ((::millis()-lastDisplayUpdate)>=1000 && (lastDisplayUpdate+=1000))
 		#endif
@@ -96,16 +102,58 @@ void simulateLoop(void)
 			display.printMode();
 			display.updateBacklight();
 		}
-		
-		simulator.step();
 	}
+	
+	simulator.step();
+}
+
+static void simulateEepromTask(void)
+{
+	TIME_PHASE(PHASE_EEPROM, eepromManager.update());
+}
+
+/*
+ * Simulated time advances in whole seconds, so the control task never has to catch up on more than one period.
+ * The display and serial keep running on real time.
+ */
+static ScheduledTask simulatorTasks[] = {
+	SCHEDULED_TASK(simulateControlTask, BREWPI_CONTROL_PERIOD, 0, 1)
+};
+
+/*
+ * The eeprom is written on real time, so changes are saved also while the simulation is paused.
+ */
+static ScheduledTask realTimeTasks[] = {
+	SCHEDULED_TASK(simulateEepromTask, 1000, 0, 0)
+};
+
+void simulateLoop(void)
+{
+	// only needed if we want the arduino to be self running. Useful for manual testing, but not so much with an
+	// external driver.
+	updateSimulationTicks();
+	
+	Scheduler::run(simulatorTasks, SCHEDULED_TASK_COUNT(simulatorTasks), ticks.millis());
+	Scheduler::run(realTimeTasks, SCHEDULED_TASK_COUNT(realTimeTasks), ::millis());
+
 	#if !BREWPI_EMULATE
 	static unsigned long lastCheckSerial = 0;
 	if ((::millis()-lastCheckSerial)>=1000 && (lastCheckSerial=::millis()>0))	// only listen if 1s passed since last time
 	#endif
 	//listen for incoming serial connections while waiting to update
-	piLink.receive();
+	TIME_PHASE(PHASE_RECEIVE, piLink.receive());
+	TIME_PHASE(PHASE_TRANSMIT, piLink.transmit());
+}
 
+void simulateHeadless(uint32_t seconds)
+{
+	headless = true;
+	while (seconds--) {
+		ticks.incMillis(1000);
+		Scheduler::run(simulatorTasks, SCHEDULED_TASK_COUNT(simulatorTasks), ticks.millis());
+	}
+	SimulatorRecorder::flush();
+	headless = false;
 }
 
 #include "TempSensorExternal.h"
@@ -124,6 +172,7 @@ const char SimulatorPrintInterval[] PROGMEM = "i";
 const char SimulatorNoise[] PROGMEM = "n";
 const char SimulatorCoeffBeer[] PROGMEM = "kb";
 const char SimulatorCoeffRoom[] PROGMEM = "ke";
+const char SimulatorCoeffDoor[] PROGMEM = "kd";
 const char SimulatorRoomTempMin[] PROGMEM = "rmi";
 const char SimulatorRoomTempMax[] PROGMEM = "rmx";
 const char SimulatorBeerDensity[] PROGMEM = "sg";
@@ -146,14 +195,6 @@ void setTicks(ExternalTicks& externalTicks, const char* val, int multiplier=1000
 }
 
 
-/* How often the temperature is output, in simulated seconds.
- * 0 is never.
- * 1 is once per second.
- * 5 is once every 5 seconds etc..
- */
-extern uint8_t printTempInterval;
-
-
 void HandleSimulatorConfig(const char* key, const char* val, void* pv)
 {
 	// this set the system timer, but not the simulator counter
@@ -194,6 +235,9 @@ void HandleSimulatorConfig(const char* key, const char* val, void* pv)
 	else if (strcmp_P(key, SimulatorCoeffBeer)==0) {
 		simulator.setBeerCoefficient(atof(val));
 	}
+	else if (strcmp_P(key, SimulatorCoeffDoor)==0) {
+		simulator.setDoorCoefficient(atof(val));
+	}
 	else if (strcmp_P(key, SimulatorBeerConnected)==0) {
 		simulator.setConnected(tempControl.beerSensor, strcmp(val, "0")!=0);
 	}
@@ -251,6 +295,7 @@ void PiLink::printSimulatorSettings()
 	sendJsonPair(SimulatorCoolPower, (uint16_t)simulator.getCoolPower());
 	sendJsonPair(SimulatorCoeffRoom, simulator.getRoomCoefficient());
  	sendJsonPair(SimulatorCoeffBeer, simulator.getBeerCoefficient());
+	sendJsonPair(SimulatorCoeffDoor, simulator.getDoorCoefficient());
 	sendJsonPair(SimulatorDoorState, simulator.doorState() ? "1" : "0");
 	sendJsonPair(SimulatorDoorState, printTempInterval);
   	sendJsonPair(SimulatorNoise, simulator.getSensorNoise());
@@ -94,13 +94,20 @@ public:
 			setBeerVolume(beerVolume);
 			setFridgeVolume(fridgeVolume);
 			time = 0;
+			doorCoefficient = 20;
 			fermentPowerMax = 5;    // todo - rather max power, parameter should be ferment time, and compute power from moles of sugar
 			heating = false;
 			cooling = false;
 			doorOpen = false;
                         enabled = true;
+			control = &tempControl;
 		}
 
+	/**
+	 * Sets the controller whose sensors and actuators are simulated. By default this is the application's tempControl.
+	 */
+	void setTempControl(TempControl* control) { this->control = control; }
+
 	struct TempPair
 	{
 		double t1;
@@ -111,9 +118,9 @@ public:
             if (enabled)
             {
             
-		heating = tempControl.stateIsHeating();
-		cooling = tempControl.stateIsCooling();
-		doorOpen = PSensor(tempControl.door)->sense();
+		heating = control->stateIsHeating();
+		cooling = control->stateIsCooling();
+		doorOpen = PSensor(control->door)->sense();
 		// with no serial and no calculation here we get 1500-2000x speedup
 		// with this code enabled, around 1300x speedup
 		// with serial, drops to 300x speedup
@@ -172,6 +179,8 @@ public:
 	double getBeerCoefficient() { return Kb; }
 	void setRoomCoefficient(double e) { Ke = e; };
 	void setBeerCoefficient(double e) { Kb = e; };
+	double getDoorCoefficient() { return doorCoefficient; }
+	void setDoorCoefficient(double e) { doorCoefficient = e; }
 		
 	void setFermentMaxPowerOutput(double max) { this->fermentPowerMax = max; }
 	double getFermentMaxPowerOutput() { return fermentPowerMax; }
@@ -247,9 +256,9 @@ private:
 	void updateSensors()
 	{
 		// add noise to the simulated temperature
-		setTemp(tempControl.beerSensor, beerTemp+noise());
-		setTemp(tempControl.fridgeSensor, fridgeTemp+noise());
-		setBasicTemp(*(ExternalTempSensor*)tempControl.ambientSensor, currentRoomTemp);		
+		setTemp(control->beerSensor, beerTemp+noise());
+		setTemp(control->fridgeSensor, fridgeTemp+noise());
+		setBasicTemp(*(ExternalTempSensor*)control->ambientSensor, currentRoomTemp);		
 	}
 
 	void setBasicTemp(ExternalTempSensor& sensor, double temp)
@@ -328,8 +337,9 @@ private:
 		return quantize(temp, quantizeTempOutput);
 	}		
 
+	/* Heat exchanged with the room while the door is open. */
 	double doorLosses(){
-		return 0.0;
+		return doorOpen ? (roomTemp()-fridgeTemp)*doorCoefficient/fridgeHeatCapacity : 0.0;
 	}		
 		
 	void updateBeerCapacity()
@@ -338,6 +348,7 @@ private:
 	}		
 
 	bool enabled;
+	TempControl* control;
 	unsigned long time;               // time since start of simulation in seconds
 	int fridgeVolume;     // liters
 	double beerDensity;    // SG
@@ -351,6 +362,7 @@ private:
 	double quantizeTempOutput;
 	double Ke;              // W / K - thermal conductivity compartment <> environment
 	double Kb;   // just a guess               // W / K  - thermal conductivity compartment <> beer
+	double doorCoefficient;	// W / K - air exchange compartment <> environment while the door is open
 	double sensorNoise;          // how many quantization units of noise is generated
 	
 	/**
@@ -417,6 +429,13 @@ extern Simulator simulator;
  */
 void setRunFactor(temperature factor);
 
+/* How often the temperature is output, in simulated seconds.
+ * 0 is never.
+ * 1 is once per second.
+ * 5 is once every 5 seconds etc..
+ */
+extern uint8_t printTempInterval;
+
 /**
  * Callback for handling the simulator JSON config.
  */
@@ -424,4 +443,11 @@ void HandleSimulatorConfig(const char* key, const char* val, void* pv);
 
 void simulateLoop();
 
+/**
+ * Runs the simulation for the given number of simulated seconds as fast as the CPU allows, without pacing to real time.
+ * Serial input, the display and the JSON temperature output are skipped. Instead, every printTempInterval seconds the
+ * state is added to the SimulatorRecorder stream, if one has been started.
+ */
+void simulateHeadless(uint32_t seconds);
+
 
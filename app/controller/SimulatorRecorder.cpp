@@ -0,0 +1,105 @@
+/*
+ * Copyright 2013 BrewPi/Elco Jacobs.
+ * Copyright 2013 Matthew McGowan.
+ *
+ * This file is part of BrewPi.
+ * 
+ * BrewPi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * BrewPi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with BrewPi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Brewpi.h"
+#include "SimulatorRecorder.h"
+
+#if BREWPI_SIMULATE
+
+#include "TempControl.h"
+#include "Ticks.h"
+
+SimulatorRecordSink SimulatorRecorder::sink = NULL;
+uint16_t SimulatorRecorder::length = 0;
+uint8_t SimulatorRecorder::buffer[SIMULATOR_RECORD_BATCH*SIMULATOR_RECORD_SIZE];
+
+void SimulatorRecorder::begin(SimulatorRecordSink newSink, uint16_t interval)
+{
+	end();
+	sink = newSink;
+	if (sink==NULL)
+		return;
+
+	buffer[0] = 'B';
+	buffer[1] = 'P';
+	buffer[2] = 'S';
+	buffer[3] = 'R';
+	buffer[4] = SIMULATOR_RECORD_VERSION;
+	buffer[5] = SIMULATOR_RECORD_SIZE;
+	length = 6;
+	putUint16(interval);
+	flush();
+}
+
+void SimulatorRecorder::end()
+{
+	flush();
+	sink = NULL;
+}
+
+void SimulatorRecorder::record()
+{
+	if (sink==NULL)
+		return;
+
+	uint8_t flags = 0;
+	if (tempControl.stateIsHeating())
+		flags |= SIMULATOR_RECORD_HEATING;
+	if (tempControl.stateIsCooling())
+		flags |= SIMULATOR_RECORD_COOLING;
+	if (tempControl.isDoorOpen())
+		flags |= SIMULATOR_RECORD_DOOR_OPEN;
+
+	// ticks.seconds() is 16 bits, which wraps after 18 hours
+	putUint32(ticks.millis()/1000);
+	putUint16(tempControl.getBeerTemp());
+	putUint16(tempControl.getBeerSetting());
+	putUint16(tempControl.getFridgeTemp());
+	putUint16(tempControl.getFridgeSetting());
+	putUint16(tempControl.ambientSensor->read());
+	buffer[length++] = tempControl.getState();
+	buffer[length++] = tempControl.getMode();
+	buffer[length++] = flags;
+	buffer[length++] = 0;
+
+	if (length>sizeof(buffer)-SIMULATOR_RECORD_SIZE)
+		flush();
+}
+
+void SimulatorRecorder::flush()
+{
+	if (sink!=NULL && length)
+		sink(buffer, length);
+	length = 0;
+}
+
+void SimulatorRecorder::putUint16(uint16_t value)
+{
+	buffer[length++] = uint8_t(value);
+	buffer[length++] = uint8_t(value>>8);
+}
+
+void SimulatorRecorder::putUint32(uint32_t value)
+{
+	putUint16(uint16_t(value));
+	putUint16(uint16_t(value>>16));
+}
+
+#endif
@@ -0,0 +1,96 @@
+/*
+ * Copyright 2013 BrewPi/Elco Jacobs.
+ * Copyright 2013 Matthew McGowan.
+ *
+ * This file is part of BrewPi.
+ * 
+ * BrewPi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * BrewPi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with BrewPi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "Brewpi.h"
+
+/*
+ * The simulator recorder writes snapshots of the controller state as fixed size binary records, rather than as JSON.
+ * All values are little endian. The stream starts with an 8 byte header:
+ *   'B' 'P' 'S' 'R'		magic
+ *   uint8_t version		SIMULATOR_RECORD_VERSION
+ *   uint8_t recordSize		SIMULATOR_RECORD_SIZE
+ *   uint16_t interval		simulated seconds between records, 0 when records are not periodic
+ * followed by records of SIMULATOR_RECORD_SIZE bytes:
+ *   uint32_t time			controller time in seconds
+ *   int16_t beerTemp		temperatures in the internal fixed point format, INVALID_TEMP when disconnected
+ *   int16_t beerSetting
+ *   int16_t fridgeTemp
+ *   int16_t fridgeSetting
+ *   int16_t roomTemp
+ *   uint8_t state			TempControl state
+ *   char mode
+ *   uint8_t flags			SIMULATOR_RECORD_HEATING | SIMULATOR_RECORD_COOLING | SIMULATOR_RECORD_DOOR_OPEN
+ *   uint8_t reserved
+ */
+#define SIMULATOR_RECORD_VERSION 1
+#define SIMULATOR_RECORD_HEADER_SIZE 8
+#define SIMULATOR_RECORD_SIZE 18
+
+#define SIMULATOR_RECORD_HEATING 0x01
+#define SIMULATOR_RECORD_COOLING 0x02
+#define SIMULATOR_RECORD_DOOR_OPEN 0x04
+
+/* The number of records collected before they are passed to the sink. */
+#ifndef SIMULATOR_RECORD_BATCH
+#define SIMULATOR_RECORD_BATCH 64
+#endif
+
+/**
+ * Receives a batch of encoded bytes. Called with the header on begin() and with whole records after that.
+ */
+typedef void (*SimulatorRecordSink)(const uint8_t* data, uint16_t length);
+
+/**
+ * Collects controller state snapshots into batches of binary records.
+ */
+class SimulatorRecorder {
+public:
+	/**
+	 * Starts a new record stream. The header is written to the sink straight away.
+	 */
+	static void begin(SimulatorRecordSink sink, uint16_t interval);
+
+	/**
+	 * Stops recording. Buffered records are flushed first.
+	 */
+	static void end();
+
+	/**
+	 * Adds a snapshot of the current controller state. The batch is passed to the sink when full.
+	 */
+	static void record();
+
+	/**
+	 * Passes all buffered records to the sink.
+	 */
+	static void flush();
+
+	static bool isRecording() { return sink!=NULL; }
+
+private:
+	static void putUint16(uint16_t value);
+	static void putUint32(uint32_t value);
+
+	static SimulatorRecordSink sink;
+	static uint16_t length;
+	static uint8_t buffer[SIMULATOR_RECORD_BATCH*SIMULATOR_RECORD_SIZE];
+};
@@ -33,12 +33,12 @@
 
 TempControl tempControl;
 
-#if TEMP_CONTROL_STATIC
-
 extern ValueSensor<bool> defaultSensor;
 extern ValueActuator defaultActuator;
 extern DisconnectedTempSensor defaultTempSensor;
 
+#if TEMP_CONTROL_STATIC
+
 // These sensors are switched out to implement multi-chamber.
 TempSensor* TempControl::beerSensor;
 TempSensor* TempControl::fridgeSensor;
@@ -50,7 +50,7 @@ Actuator* TempControl::cooler = &defaultActuator;
 Actuator* TempControl::light = &defaultActuator;
 Actuator* TempControl::fan = &defaultActuator;
 
-ValueActuator cameraLightState;		
+ValueActuator TempControl::cameraLightState;
 AutoOffActuator TempControl::cameraLight(600, &cameraLightState);	// timeout 10 min
 Sensor<bool>* TempControl::door = &defaultSensor;
 	
@@ -64,6 +64,7 @@ uint8_t TempControl::state;
 bool TempControl::doPosPeakDetect;
 bool TempControl::doNegPeakDetect;
 bool TempControl::doorOpen;
+uint8_t TempControl::integralUpdateCounter;
 	
 	// keep track of beer setting stored in EEPROM
 temperature TempControl::storedBeerSetting;
@@ -73,6 +74,29 @@ uint16_t TempControl::lastIdleTime;
 uint16_t TempControl::lastHeatTime;
 uint16_t TempControl::lastCoolTime;
 uint16_t TempControl::waitTime;
+
+#else
+
+TempControl::TempControl() : cameraLight(600, &cameraLightState), cc(), cs(), cv()	// camera light timeout 10 min
+{
+	beerSensor = NULL;
+	fridgeSensor = NULL;
+	ambientSensor = &defaultTempSensor;
+	heater = &defaultActuator;
+	cooler = &defaultActuator;
+	light = &defaultActuator;
+	fan = &defaultActuator;
+	door = &defaultSensor;
+	storedBeerSetting = 0;
+	lastIdleTime = lastHeatTime = lastCoolTime = waitTime = 0;
+	state = IDLE;
+	doPosPeakDetect = doNegPeakDetect = doorOpen = false;
+	integralUpdateCounter = 0;
+}
+
+bool TempControl::isApplicationInstance(void){
+	return this==&tempControl;
+}
 #endif
 
 void TempControl::init(void){
@@ -127,8 +151,7 @@ void TempControl::updateTemperatures(void){
 }
 
 void TempControl::updatePID(void){
-	static unsigned char integralUpdateCounter = 0;
-	if(tempControl.modeIsBeer()){
+	if(modeIsBeer()){
 		if(cs.beerSetting == INVALID_TEMP){
 			// beer setting is not updated yet
 			// set fridge to unknown too
@@ -213,7 +236,8 @@ void TempControl::updateState(void){
 		
 	if(newDoorOpen!=doorOpen) {
 		doorOpen = newDoorOpen;
-		piLink.printFridgeAnnotation(PSTR("Fridge door %S"), doorOpen ? PSTR("opened") : PSTR("closed"));
+		if(isApplicationInstance())
+			piLink.printFridgeAnnotation(PSTR("Fridge door " PRINTF_PROGMEM_STRING), doorOpen ? PSTR("opened") : PSTR("closed"));
 	}
 
 	if(cs.mode == MODE_OFF){
@@ -223,7 +247,7 @@ void TempControl::updateState(void){
 	// stay idle when one of the required sensors is disconnected, or the fridge setting is INVALID_TEMP
 	if( cs.fridgeSetting == INVALID_TEMP || 
 		!fridgeSensor->isConnected() || 
-		(!beerSensor->isConnected() && tempControl.modeIsBeer())){
+		(!beerSensor->isConnected() && modeIsBeer())){
 		state = IDLE;
 		stayIdle = true;
 	}
@@ -249,18 +273,18 @@ void TempControl::updateState(void){
 			}
 			resetWaitTime();
 			if(fridgeFast > (cs.fridgeSetting+cc.idleRangeHigh) ){  // fridge temperature is too high			
-				tempControl.updateWaitTime(MIN_SWITCH_TIME, sinceHeating);			
+				updateWaitTime(MIN_SWITCH_TIME, sinceHeating);			
 				if(cs.mode==MODE_FRIDGE_CONSTANT){
-					tempControl.updateWaitTime(MIN_COOL_OFF_TIME_FRIDGE_CONSTANT, sinceCooling);
+					updateWaitTime(MIN_COOL_OFF_TIME_FRIDGE_CONSTANT, sinceCooling);
 				}
 				else{
 					if(beerFast < (cs.beerSetting + 16) ){ // If beer is already under target, stay/go to idle. 1/2 sensor bit idle zone
 						state = IDLE; // beer is already colder than setting, stay in or go to idle
 						break;
 					}
-					tempControl.updateWaitTime(MIN_COOL_OFF_TIME, sinceCooling);
+					updateWaitTime(MIN_COOL_OFF_TIME, sinceCooling);
 				}
-				if(tempControl.cooler != &defaultActuator){
+				if(cooler != &defaultActuator){
 					if(getWaitTime() > 0){
 						state = WAITING_TO_COOL;
 					}
@@ -270,15 +294,15 @@ void TempControl::updateState(void){
 				}
 			}
 			else if(fridgeFast < (cs.fridgeSetting+cc.idleRangeLow)){  // fridge temperature is too low
-				tempControl.updateWaitTime(MIN_SWITCH_TIME, sinceCooling);
-				tempControl.updateWaitTime(MIN_HEAT_OFF_TIME, sinceHeating);
+				updateWaitTime(MIN_SWITCH_TIME, sinceCooling);
+				updateWaitTime(MIN_HEAT_OFF_TIME, sinceHeating);
 				if(cs.mode!=MODE_FRIDGE_CONSTANT){
 					if(beerFast > (cs.beerSetting - 16)){ // If beer is already over target, stay/go to idle. 1/2 sensor bit idle zone
 						state = IDLE;  // beer is already warmer than setting, stay in or go to idle
 						break;
 					}
 				}
-				if(tempControl.heater != &defaultActuator || (cc.lightAsHeater && (tempControl.light != &defaultActuator))){
+				if(heater != &defaultActuator || (cc.lightAsHeater && (light != &defaultActuator))){
 					if(getWaitTime() > 0){
 						state = WAITING_TO_HEAT;
 					}
@@ -460,7 +484,7 @@ void TempControl::detectPeaks(void){
 			doNegPeakDetect=false;
 		}
 	}
-	if(detected){
+	if(detected && isApplicationInstance()){
 		// send out log message for type of peak detected
 		logInfoTempTempFixedFixed(detected, peak, estimate, oldEstimator, newEstimator);
 	}
@@ -473,14 +497,14 @@ void TempControl::increaseEstimator(temperature * estimator, temperature error){
 	if(*estimator < 25){
 		*estimator = intToTempDiff(5)/100; // make estimator at least 0.05
 	}
-	eepromManager.storeTempSettings();
+	storeTempSettings();
 }
 
 // Decrease estimator at least 16.7% (1/1.2), max 33.3% (1/1.5)
 void TempControl::decreaseEstimator(temperature * estimator, temperature error){
 	temperature factor = 426 - constrainTemp(abs(error)>>5, 0, 85); // 0.833 - 3.1% of error, limit between 0.667 and 0.833
 	*estimator = multiplyFactorTemperatureDiff(factor, *estimator);
-	eepromManager.storeTempSettings();
+	storeTempSettings();
 }
 
 uint16_t TempControl::timeSinceCooling(void){
@@ -520,18 +544,26 @@ void TempControl::loadConstants(eptr_t offset){
 // The update functions only write to EEPROM if the value has changed
 void TempControl::storeSettings(eptr_t offset){
 	eepromAccess.writeBlock(offset, (void *) &cs, sizeof(ControlSettings));
+	settingsStored();
+}
+
+void TempControl::settingsStored(void){
 	storedBeerSetting = cs.beerSetting;		
 }
 
 void TempControl::loadSettings(eptr_t offset){
 	eepromAccess.readBlock((void *) &cs, offset, sizeof(ControlSettings));	
+	settingsLoaded();
+}
+
+void TempControl::settingsLoaded(void){
 	logDebug("loaded settings");
 	storedBeerSetting = cs.beerSetting;
 	setMode(cs.mode, true);		// force the mode update
 }
 
 void TempControl::loadDefaultConstants(void){
-	memcpy_P((void*) &tempControl.cc, (void*) &tempControl.ccDefaults, sizeof(ControlConstants));
+	memcpy_P((void*) &cc, (void*) &ccDefaults, sizeof(ControlConstants));
 	initFilters();
 }
 
@@ -558,7 +590,7 @@ void TempControl::setMode(char newMode, bool force){
 			cs.beerSetting = INVALID_TEMP;
 			cs.fridgeSetting = INVALID_TEMP;
 		}
-		eepromManager.storeTempSettings();
+		storeTempSettings();
 	}
 }
 
@@ -601,7 +633,7 @@ void TempControl::setBeerTemp(temperature newTemp){
 		// Do not store settings every time in profile mode, because EEPROM has limited number of write cycles.
 		// A temperature ramp would cause a lot of writes
 		// If Raspberry Pi is connected, it will update the settings anyway. This is just a safety feature.
-		eepromManager.storeTempSettings();
+		storeTempSettings();
 	}		
 }
 
@@ -610,7 +642,13 @@ void TempControl::setFridgeTemp(temperature newTemp){
 	reset(); // reset peak detection and PID
 	updatePID();
 	updateState();	
-	eepromManager.storeTempSettings();
+	storeTempSettings();
+}
+
+void TempControl::storeTempSettings(void){
+	if(isApplicationInstance()){
+		eepromManager.storeTempSettings();
+	}
 }
 
 bool TempControl::stateIsCooling(void){
@@ -141,10 +141,19 @@ enum states{
  * memory references. While the design goes against the grain of typical OO practices, the reduction in code size make it worth it.
  */
 
+/*
+ * With TEMP_CONTROL_STATIC set to 0, each TempControl object has its own state. This is used by host tools
+ * that run many controllers side by side. Only the application's tempControl object reports to piLink and
+ * stores its settings in eeprom.
+ */
 class TempControl{
 	public:
 	
+#if TEMP_CONTROL_STATIC
 	TempControl(){};
+#else
+	TempControl();
+#endif
 	~TempControl(){};
 	
 	TEMP_CONTROL_METHOD void init(void);
@@ -158,6 +167,9 @@ class TempControl{
 	
 	TEMP_CONTROL_METHOD void loadSettings(eptr_t offset);
 	TEMP_CONTROL_METHOD void storeSettings(eptr_t offset);
+	// for settings that are loaded into or stored from cs by the caller
+	TEMP_CONTROL_METHOD void settingsLoaded(void);
+	TEMP_CONTROL_METHOD void settingsStored(void);
 	TEMP_CONTROL_METHOD void loadDefaultSettings(void);
 	
 	TEMP_CONTROL_METHOD void loadConstants(eptr_t offset);
@@ -228,6 +240,13 @@ class TempControl{
 	TEMP_CONTROL_METHOD void decreaseEstimator(temperature * estimator, temperature error);
 	
 	TEMP_CONTROL_METHOD void updateEstimatedPeak(uint16_t estimate, temperature estimator, uint16_t sinceIdle);
+	
+	TEMP_CONTROL_METHOD void storeTempSettings(void);
+#if TEMP_CONTROL_STATIC
+	TEMP_CONTROL_METHOD bool isApplicationInstance(void) { return true; }
+#else
+	bool isApplicationInstance(void);
+#endif
 	public:
 	TEMP_CONTROL_FIELD TempSensor* beerSensor;
 	TEMP_CONTROL_FIELD TempSensor* fridgeSensor;
@@ -236,6 +255,7 @@ class TempControl{
 	TEMP_CONTROL_FIELD Actuator* cooler; 
 	TEMP_CONTROL_FIELD Actuator* light;
 	TEMP_CONTROL_FIELD Actuator* fan;
+	TEMP_CONTROL_FIELD ValueActuator cameraLightState;
 	TEMP_CONTROL_FIELD AutoOffActuator cameraLight;
 	TEMP_CONTROL_FIELD Sensor<bool>* door;
 	
@@ -263,6 +283,7 @@ class TempControl{
 	TEMP_CONTROL_FIELD bool doPosPeakDetect;
 	TEMP_CONTROL_FIELD bool doNegPeakDetect;
 	TEMP_CONTROL_FIELD bool doorOpen;
+	TEMP_CONTROL_FIELD uint8_t integralUpdateCounter;
 	
 	friend class TempControlState;
 };
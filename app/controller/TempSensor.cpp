@@ -92,16 +92,35 @@ temperature TempSensor::detectNegPeak(void){
 	return slowFilter.detectNegPeak();
 }
 	
-void TempSensor::setFastFilterCoefficients(uint8_t b){
+bool TempSensor::isValidFilterCoefficient(uint8_t b){
+#ifdef TEMP_SENSOR_FILTER_MAX_B
+	if (b>TEMP_SENSOR_FILTER_MAX_B) {
+		logErrorInt(ERROR_INVALID_FILTER_COEFFICIENT, b);
+		return false;
+	}
+#endif
+	return true;
+}
+
+bool TempSensor::setFastFilterCoefficients(uint8_t b){
+	if (!isValidFilterCoefficient(b))
+		return false;
 	fastFilter.setCoefficients(b);
+	return true;
 }
 	
-void TempSensor::setSlowFilterCoefficients(uint8_t b){
+bool TempSensor::setSlowFilterCoefficients(uint8_t b){
+	if (!isValidFilterCoefficient(b))
+		return false;
 	slowFilter.setCoefficients(b);
+	return true;
 }
 
-void TempSensor::setSlopeFilterCoefficients(uint8_t b){
+bool TempSensor::setSlopeFilterCoefficients(uint8_t b){
+	if (!isValidFilterCoefficient(b))
+		return false;
 	slopeFilter.setCoefficients(b);
+	return true;
 }
 
 BasicTempSensor& TempSensor::sensor() {
@@ -22,6 +22,7 @@
 
 #include "Brewpi.h"
 #include "FilterCascaded.h"
+#include "FilterCascadedT.h"
 #include "TempSensorBasic.h"
 #include <stdlib.h>
 
@@ -31,7 +32,11 @@
 #define TEMP_SENSOR_CASCADED_FILTER 1
 #endif
 
-#if TEMP_SENSOR_CASCADED_FILTER
+#if TEMP_SENSOR_CASCADED_FILTER && TEMP_SENSOR_CONSTANT_SHIFT_FILTER
+typedef CascadedFilterDispatch<NUM_SECTIONS> TempSensorFilter;
+/* The largest b value the filters are compiled for. */
+#define TEMP_SENSOR_FILTER_MAX_B CASCADED_FILTER_MAX_B
+#elif TEMP_SENSOR_CASCADED_FILTER
 typedef CascadedFilter TempSensorFilter;
 #else
 typedef FixedFilter TempSensorFilter;
@@ -78,15 +83,21 @@ class TempSensor {
 	
 	temperature detectNegPeak(void);
 	
-	void setFastFilterCoefficients(uint8_t b);
+	/**
+	 * Set the b value of a filter. An invalid b value is logged and rejected: the filter is left as it is and
+	 * false is returned.
+	 */
+	bool setFastFilterCoefficients(uint8_t b);
 	
-	void setSlowFilterCoefficients(uint8_t b);
+	bool setSlowFilterCoefficients(uint8_t b);
 
-	void setSlopeFilterCoefficients(uint8_t b);
+	bool setSlopeFilterCoefficients(uint8_t b);
 	
 	BasicTempSensor& sensor();
 	 
 	private:	
+	static bool isValidFilterCoefficient(uint8_t b);
+
 	BasicTempSensor* _sensor;
 	TempSensorFilter fastFilter;
 	TempSensorFilter slowFilter;
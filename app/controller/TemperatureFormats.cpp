@@ -22,7 +22,7 @@
 #include <string.h>
 #include <limits.h>
 #include "TempControl.h"
-#include <stdarg.h>
+#include "JsonWriter.h"
 
 // See header file for details about the temp format used.
 
@@ -48,38 +48,27 @@ char * fixedPointToString(char * s, temperature rawValue, uint8_t numDecimals, u
 	return fixedPointToString(s, long_temperature(rawValue), numDecimals, maxLength);
 }
 
-// this gets rid of snprintf_P
-void mysnprintf_P(char* buf, int len, const char* fmt, ...)
-{
-	va_list args;
-	va_start (args, fmt );
-	vsnprintf_P(buf, len, fmt, args);
-	va_end (args);
-}
-
 char * fixedPointToString(char * s, long_temperature rawValue, uint8_t numDecimals, uint8_t maxLength){ 
-	s[0] = ' ';
+	char buf[16];	// sign + 7 digits integer part + point + 3 digits fraction part
+	buf[0] = ' ';
 	if(rawValue < 0l){
-		s[0] = '-';
+		buf[0] = '-';
 		rawValue = -rawValue;
 	}
 	
-	int intPart = longTempDiffToInt(rawValue); // rawValue is supposed to be without internal offset
+	long_temperature intPart = longTempDiffToInt(rawValue); // rawValue is supposed to be without internal offset
 	uint16_t fracPart;
-	const char* fmt;
 	uint16_t scale;
 	switch (numDecimals)
 	{
 		case 1:
-			fmt = PSTR("%d.%01d");
 			scale = 10;
 			break;
 		case 2:
-			fmt = PSTR("%d.%02d");
 			scale = 100;
 			break;
 		default:
-			fmt = PSTR("%d.%03d");
+			numDecimals = 3;
 			scale = 1000;
 	}
 	fracPart = ((rawValue & TEMP_FIXED_POINT_MASK) * scale + TEMP_FIXED_POINT_SCALE/2) >> TEMP_FIXED_POINT_BITS; // add 256 for rounding
@@ -87,7 +76,13 @@ char * fixedPointToString(char * s, long_temperature rawValue, uint8_t numDecima
 		intPart++;
 		fracPart = 0;
 	}
-	mysnprintf_P(&s[1], maxLength-1, fmt,  intPart, fracPart);
+	uint8_t length = 1+JsonWriter::formatDigits(&buf[1], intPart);
+	buf[length++] = '.';
+	length += JsonWriter::formatDigits(&buf[length], fracPart, numDecimals);
+	if (length > maxLength-1)
+		length = maxLength-1;
+	memcpy(s, buf, length);
+	s[length] = 0;
 	return s;
 }
 
@@ -108,7 +103,7 @@ long_temperature stringToFixedPoint(const char * numberString){
 	long_temperature intPart = 0;
 	long_temperature fracPart = 0;
 	
-	char * fractPtr = 0; //pointer to the point in the string
+	const char * fractPtr = 0; //pointer to the point in the string
 	bool negative = 0;
 	if(numberString[0] == '-'){
 		numberString++;
@@ -22,6 +22,10 @@
 
 #include "EepromTypes.h"
 
+/*
+ * Each platform defines EepromAccess with static readByte(), writeByte(), readBlock() and writeBlock(), and flush(),
+ * which writes the changes that an eeprom emulation holds back.
+ */
 #include "EepromAccessImpl.h"
 
 extern EepromAccess eepromAccess;
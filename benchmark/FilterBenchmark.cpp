@@ -0,0 +1,201 @@
+/*
+ * Copyright 2013 BrewPi/Elco Jacobs.
+ * Copyright 2013 Matthew McGowan.
+ *
+ * This file is part of BrewPi.
+ * 
+ * BrewPi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * BrewPi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with BrewPi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Micro-benchmarks for the temperature filters. TempSensor runs three cascaded filters per sensor every second
+ * and the touch screen driver on the Spark runs LowPassFilter on every touch sample.
+ * CascadedFilterT and CascadedFilterDispatch must give the same outputs as CascadedFilter, so they are checked against
+ * the CascadedFilter reference.
+ * Before the benchmarks run, the filter outputs are checked against the reference vectors in FilterReference.h,
+ * so an optimization that changes the results is caught here rather than in the control loop.
+ * Time per sample is reported in the time/sample column.
+ */
+
+#include "benchmark/benchmark.h"
+#include <stdio.h>
+
+#include "Brewpi.h"
+#include "FilterFixed.h"
+#include "FilterCascaded.h"
+#include "FilterCascadedT.h"
+#include "LowPassFilter.h"
+#include "FilterReference.h"
+
+#define FILTER_BENCHMARK_SAMPLES FILTER_REFERENCE_HASH_SAMPLES
+
+static temperature samples[FILTER_BENCHMARK_SAMPLES];
+
+static void initSamples() {
+	for (uint16_t i=0; i<FILTER_BENCHMARK_SAMPLES; i++)
+		samples[i] = filterReferenceInput(i);
+}
+
+/* The filters are set up the way TempSensor and the touch screen driver set them up: a = 2b+4. */
+static void setupFilter(FixedFilter& filter, uint8_t b) {
+	filter.setCoefficients(b);
+	filter.init(samples[0]);
+}
+
+static void setupFilter(CascadedFilter& filter, uint8_t b) {
+	filter.setCoefficients(b);
+	filter.init(samples[0]);
+}
+
+static void setupFilter(CascadedFilterDispatch<NUM_SECTIONS>& filter, uint8_t b) {
+	filter.setCoefficients(b);
+	filter.init(samples[0]);
+}
+
+/* b is a template argument, the argument is only there to select the overload */
+template <uint8_t B>
+static void setupFilter(CascadedFilterT<NUM_SECTIONS, B>& filter, uint8_t) {
+	filter.init(samples[0]);
+}
+
+static void setupFilter(LowPassFilter& filter, uint8_t b) {
+	filter.setCoefficients(2*b+4, b);
+	filter.init(samples[0]);
+}
+
+static int32_t filterSample(FixedFilter& filter, temperature sample) {
+	return filter.addDoublePrecision(tempRegularToPrecise(sample));
+}
+
+static int32_t filterSample(CascadedFilter& filter, temperature sample) {
+	return filter.add(sample);
+}
+
+static int32_t filterSample(CascadedFilterDispatch<NUM_SECTIONS>& filter, temperature sample) {
+	return filter.add(sample);
+}
+
+template <uint8_t B>
+static int32_t filterSample(CascadedFilterT<NUM_SECTIONS, B>& filter, temperature sample) {
+	return filter.add(sample);
+}
+
+static int32_t filterSample(LowPassFilter& filter, temperature sample) {
+	return filter.add(sample);
+}
+
+template <class Filter>
+static bool verifyFilter(const char* name, uint8_t b, const FilterReference& reference) {
+	Filter filter;
+	setupFilter(filter, b);
+	uint32_t hash = FILTER_REFERENCE_HASH_INIT;
+	for (uint16_t i=0; i<FILTER_REFERENCE_HASH_SAMPLES; i++) {
+		int32_t output = filterSample(filter, samples[i]);
+		if (i<FILTER_REFERENCE_SAMPLES && output!=reference.output[i]) {
+			fprintf(stderr, "%s b=%d: sample %d is %d, expected %d\n", name, b, i, output, reference.output[i]);
+			return false;
+		}
+		hash = filterReferenceHash(hash, output);
+	}
+	if (hash!=reference.hash) {
+		fprintf(stderr, "%s b=%d: output hash is 0x%08x, expected 0x%08x\n", name, b, hash, reference.hash);
+		return false;
+	}
+	return true;
+}
+
+template <class Filter>
+static bool verifyFilter(const char* name, const FilterReference* reference) {
+	bool ok = true;
+	for (uint8_t b=0; b<FILTER_REFERENCE_B_VALUES; b++)
+		ok = verifyFilter<Filter>(name, b, reference[b]) && ok;
+	return ok;
+}
+
+/* CascadedFilterT is compiled for each b value */
+template <uint8_t B>
+static bool verifyCascadedFilterT(const FilterReference* reference) {
+	bool ok = verifyFilter<CascadedFilterT<NUM_SECTIONS, B> >("CascadedFilterT", B, reference[B]);
+	return verifyCascadedFilterT<B-1>(reference) && ok;
+}
+
+template <>
+bool verifyCascadedFilterT<0>(const FilterReference* reference) {
+	return verifyFilter<CascadedFilterT<NUM_SECTIONS, 0> >("CascadedFilterT", 0, reference[0]);
+}
+
+template <class Filter>
+static void filterBenchmark(benchmark::State& state) {
+	Filter filter;
+	setupFilter(filter, uint8_t(state.range(0)));
+	for (auto _ : state) {
+		for (uint16_t i=0; i<FILTER_BENCHMARK_SAMPLES; i++)
+			benchmark::DoNotOptimize(filterSample(filter, samples[i]));
+	}
+	int64_t count = int64_t(state.iterations())*FILTER_BENCHMARK_SAMPLES;
+	state.SetItemsProcessed(count);
+	state.counters["time/sample"] = benchmark::Counter(double(count), benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+static void FixedFilter_addDoublePrecision(benchmark::State& state) {
+	filterBenchmark<FixedFilter>(state);
+}
+
+static void CascadedFilter_add(benchmark::State& state) {
+	filterBenchmark<CascadedFilter>(state);
+}
+
+static void CascadedFilterDispatch_add(benchmark::State& state) {
+	filterBenchmark<CascadedFilterDispatch<NUM_SECTIONS> >(state);
+}
+
+template <uint8_t B>
+static void CascadedFilterT_add(benchmark::State& state) {
+	filterBenchmark<CascadedFilterT<NUM_SECTIONS, B> >(state);
+}
+
+static void LowPassFilter_add(benchmark::State& state) {
+	filterBenchmark<LowPassFilter>(state);
+}
+
+BENCHMARK(FixedFilter_addDoublePrecision)->DenseRange(0, FILTER_REFERENCE_B_VALUES-1);
+BENCHMARK(CascadedFilter_add)->DenseRange(0, FILTER_REFERENCE_B_VALUES-1);
+BENCHMARK(CascadedFilterDispatch_add)->DenseRange(0, FILTER_REFERENCE_B_VALUES-1);
+BENCHMARK_TEMPLATE(CascadedFilterT_add, 0)->Arg(0);
+BENCHMARK_TEMPLATE(CascadedFilterT_add, 1)->Arg(1);
+BENCHMARK_TEMPLATE(CascadedFilterT_add, 2)->Arg(2);
+BENCHMARK_TEMPLATE(CascadedFilterT_add, 3)->Arg(3);
+BENCHMARK_TEMPLATE(CascadedFilterT_add, 4)->Arg(4);
+BENCHMARK_TEMPLATE(CascadedFilterT_add, 5)->Arg(5);
+BENCHMARK_TEMPLATE(CascadedFilterT_add, 6)->Arg(6);
+BENCHMARK(LowPassFilter_add)->DenseRange(0, FILTER_REFERENCE_B_VALUES-1);
+
+int main(int argc, char** argv) {
+	initSamples();
+	bool ok = verifyFilter<FixedFilter>("FixedFilter", fixedFilterReference);
+	ok = verifyFilter<CascadedFilter>("CascadedFilter", cascadedFilterReference) && ok;
+	ok = verifyFilter<CascadedFilterDispatch<NUM_SECTIONS> >("CascadedFilterDispatch", cascadedFilterReference) && ok;
+	ok = verifyCascadedFilterT<FILTER_REFERENCE_B_VALUES-1>(cascadedFilterReference) && ok;
+	ok = verifyFilter<LowPassFilter>("LowPassFilter", lowPassFilterReference) && ok;
+	if (!ok) {
+		fprintf(stderr, "Filter outputs differ from the reference vectors.\n");
+		return 1;
+	}
+
+	benchmark::Initialize(&argc, argv);
+	if (benchmark::ReportUnrecognizedArguments(argc, argv))
+		return 1;
+	benchmark::RunSpecifiedBenchmarks();
+	return 0;
+}
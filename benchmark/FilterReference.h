@@ -0,0 +1,234 @@
+/*
+ * Copyright 2013 BrewPi/Elco Jacobs.
+ * Copyright 2013 Matthew McGowan.
+ *
+ * This file is part of BrewPi.
+ * 
+ * BrewPi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * BrewPi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with BrewPi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "TemperatureFormats.h"
+
+/*
+ * Reference outputs of the temperature filters, used to check that changes to the filter code are bit-exact.
+ * The vectors were recorded from the filter implementations before they were optimized. Each filter is run
+ * with b values 0 to 6 (a = 2b+4) on filterReferenceInput(). The first FILTER_REFERENCE_SAMPLES outputs are
+ * stored as is, all FILTER_REFERENCE_HASH_SAMPLES outputs are folded into a FNV-1a hash to cover the tail of the response.
+ */
+
+#define FILTER_REFERENCE_B_VALUES 7
+#define FILTER_REFERENCE_SAMPLES 48
+#define FILTER_REFERENCE_HASH_SAMPLES 4096
+#define FILTER_REFERENCE_HASH_INIT 2166136261u
+
+/* A step from 20C to 25C after 8 samples, with a pseudo random ripple of up to 1/8C. */
+inline temperature filterReferenceInput(uint16_t i) {
+	int16_t ripple = int16_t(((i*2654435761u)>>20)&0x7F)-64;
+	return (i<8 ? intToTemp(20) : intToTemp(25)) + ripple;
+}
+
+inline uint32_t filterReferenceHash(uint32_t hash, int32_t output) {
+	for (uint8_t i=0; i<4; i++) {
+		hash ^= (uint32_t(output)>>(8*i)) & 0xFF;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+struct FilterReference {
+	int32_t output[FILTER_REFERENCE_SAMPLES];
+	uint32_t hash;
+};
+
+/* FixedFilter::addDoublePrecision, input converted with tempRegularToPrecise */
+static const FilterReference fixedFilterReference[FILTER_REFERENCE_B_VALUES] = {
+	{{
+		-943718400, -943312896, -942215168, -941165568, -940857344, -940754176, -940146432, -939507136,
+		-929000960, -897625744, -857809680, -825780076, -804171432, -791037133, -783247651, -778160111,
+		-774962598, -773508010, -772799552, -771873109, -771066437, -770958319, -771518813, -772048993,
+		-771857417, -771475952, -771609325, -771780721, -771337141, -770793368, -770827434, -771464388,
+		-772039577, -771877992, -771515265, -771659879, -771837830, -771397996, -770856330, -770891567,
+		-771529164, -772100608, -771931021, -771561229, -771700777, -771875429, -771433562, -770894784,
+	}, 0x7b7dfcef},
+	{{
+		-943718400, -943617024, -943291904, -942847936, -942481600, -942167492, -941756986, -941303576,
+		-938349667, -928916630, -913661801, -896071304, -878383137, -861862276, -847016243, -833894769,
+		-822549116, -813029226, -805118009, -798460713, -792910493, -788446628, -784989566, -782300560,
+		-780066241, -778212992, -776806659, -775725276, -774748856, -773878168, -773238108, -772884516,
+		-772700850, -772479862, -772237356, -772114639, -772052637, -771883255, -771649722, -771511436,
+		-771552105, -771676558, -771694954, -771638207, -771659474, -771708960, -771625817, -771459955,
+	}, 0x6f163c80},
+	{{
+		-943718400, -943693056, -943605440, -943468188, -943324262, -943173890, -942984581, -942764834,
+		-941899041, -939237843, -934551908, -928385417, -921210910, -913405927, -905236605, -896879629,
+		-888505975, -880279830, -872291827, -864574612, -857181717, -850181826, -843621387, -837496326,
+		-831763953, -826418216, -821481210, -816930694, -812710835, -808806486, -805233889, -802000295,
+		-799073448, -796391090, -793934246, -791717634, -789716000, -787873882, -786179092, -784652766,
+		-783308452, -782120913, -781035607, -780041948, -779163166, -778382483, -777652754, -776970110,
+	}, 0x86946411},
+	{{
+		-943718400, -943712064, -943689368, -943651549, -943607882, -943558350, -943494769, -943418192,
+		-943173949, -942454720, -941147905, -939328865, -937074029, -934452274, -931517376, -928309632,
+		-924873716, -921258039, -917497662, -913615707, -909641164, -905608067, -901546557, -897475044,
+		-893401555, -889341346, -885315965, -881336023, -877402476, -873524175, -869716876, -865994149,
+		-862359463, -858807331, -855340735, -851970155, -848696234, -845510968, -842415169, -839417390,
+		-836524769, -833734974, -831037365, -828430419, -825920637, -823505161, -821172918, -818922108,
+	}, 0xb0df62ba},
+	{{
+		-943718400, -943716816, -943711043, -943701135, -943689182, -943675096, -943656750, -943634201,
+		-943568593, -943380495, -943034396, -942540129, -941909116, -941152212, -940277676, -939291329,
+		-938200788, -937015369, -935741859, -934384648, -932949988, -931445868, -929879856, -928257064,
+		-926580298, -924854292, -923085585, -921278307, -919434325, -917557474, -915653432, -913727556,
+		-911782862, -909820151, -907842224, -905853773, -903857163, -901852574, -899842230, -897830272,
+		-895820589, -893814779, -891812291, -889814652, -887825339, -885845558, -883874384, -881913005,
+	}, 0x7a154dfc},
+	{{
+		-943718400, -943718004, -943716548, -943714013, -943710890, -943707141, -943702218, -943696103,
+		-943679050, -943630867, -943541723, -943412854, -943245979, -943042773, -942804356, -942531309,
+		-942224718, -941886157, -941516648, -941116673, -940687218, -940229759, -939745732, -939236021,
+		-938700980, -938141469, -937558839, -936953893, -936326902, -935678648, -935010404, -934323408,
+		-933618358, -932895422, -932155275, -931399087, -930627485, -929840567, -929038944, -928223724,
+		-927395982, -926556253, -925704546, -924841383, -923967787, -923084239, -922190695, -921287631,
+	}, 0x789bca25},
+	{{
+		-943718400, -943718301, -943717935, -943717294, -943716496, -943715529, -943714254, -943712662,
+		-943708312, -943696113, -943673486, -943640580, -943597671, -943545032, -943482803, -943410996,
+		-943329750, -943239331, -943139875, -943031387, -942914000, -942787973, -942653563, -942510895,
+		-942359963, -942200891, -942033930, -941859198, -941676686, -941486511, -941288919, -941084151,
+		-940872319, -940653404, -940427515, -940194890, -939955632, -939709719, -939457254, -939198469,
+		-938933592, -938662720, -938385822, -938102993, -937814457, -937520307, -937220506, -936915147,
+	}, 0x668e2b0f},
+};
+
+/* CascadedFilter::add */
+static const FilterReference cascadedFilterReference[FILTER_REFERENCE_B_VALUES] = {
+	{{
+		-14400, -14400, -14400, -14399, -14397, -14393, -14388, -14382,
+		-14374, -14361, -14331, -14260, -14127, -13924, -13663, -13369,
+		-13071, -12793, -12550, -12348, -12188, -12066, -11974, -11908,
+		-11862, -11830, -11810, -11797, -11788, -11783, -11779, -11776,
+		-11774, -11772, -11771, -11772, -11772, -11773, -11774, -11774,
+		-11773, -11772, -11772, -11772, -11772, -11773, -11774, -11774,
+	}, 0x96047166},
+	{{
+		-14400, -14400, -14400, -14400, -14400, -14400, -14400, -14399,
+		-14399, -14398, -14396, -14392, -14386, -14374, -14354, -14325,
+		-14283, -14227, -14158, -14075, -13979, -13871, -13755, -13631,
+		-13503, -13372, -13242, -13113, -12989, -12869, -12756, -12649,
+		-12550, -12459, -12376, -12301, -12233, -12172, -12118, -12070,
+		-12028, -11991, -11959, -11931, -11907, -11886, -11868, -11853,
+	}, 0xba7be93e},
+	{{
+		-14400, -14400, -14400, -14400, -14400, -14400, -14400, -14400,
+		-14400, -14400, -14400, -14400, -14400, -14400, -14399, -14398,
+		-14396, -14393, -14390, -14385, -14378, -14369, -14358, -14345,
+		-14329, -14311, -14289, -14264, -14236, -14205, -14171, -14134,
+		-14094, -14051, -14005, -13956, -13905, -13852, -13797, -13741,
+		-13683, -13624, -13564, -13503, -13442, -13381, -13319, -13258,
+	}, 0x1c47df15},
+	{{
+		-14400, -14400, -14400, -14400, -14400, -14400, -14400, -14400,
+		-14400, -14400, -14400, -14400, -14400, -14400, -14400, -14400,
+		-14400, -14400, -14400, -14400, -14400, -14400, -14399, -14399,
+		-14398, -14397, -14396, -14395, -14394, -14392, -14390, -14387,
+		-14385, -14381, -14378, -14374, -14369, -14364, -14358, -14352,
+		-14345, -14338, -14330, -14321, -14311, -14301, -14290, -14279,
+	}, 0xf5314243},
+	{{
+		-14400, -14400, -14400, -14400, -14400, -14400, -14400, -14400,
+		-14400, -14400, -14400, -14400, -14400, -14400, -14400, -14400,
+		-14400, -14400, -14400, -14400, -14400, -14400, -14400, -14400,
+		-14400, -14400, -14400, -14400, -14400, -14400, -14400, -14400,
+		-14400, -14400, -14400, -14400, -14400, -14399, -14399, -14399,
+		-14399, -14398, -14398, -14398, -14397, -14397, -14396, -14395,
+	}, 0xbba336ab},
+	{{
+		-14400, -14400, -14400, -14400, -14400, -14400, -14400, -14400,
+		-14400, -14400, -14400, -14400, -14400, -14400, -14400, -14400,
+		-14400, -14400, -14400, -14400, -14400, -14400, -14400, -14400,
+		-14400, -14400, -14400, -14400, -14400, -14400, -14400, -14400,
+		-14400, -14400, -14400, -14400, -14400, -14400, -14400, -14400,
+		-14400, -14400, -14400, -14400, -14400, -14400, -14400, -14400,
+	}, 0xf2c31668},
+	{{
+		-14400, -14400, -14400, -14400, -14400, -14400, -14400, -14400,
+		-14400, -14400, -14400, -14400, -14400, -14400, -14400, -14400,
+		-14400, -14400, -14400, -14400, -14400, -14400, -14400, -14400,
+		-14400, -14400, -14400, -14400, -14400, -14400, -14400, -14400,
+		-14400, -14400, -14400, -14400, -14400, -14400, -14400, -14400,
+		-14400, -14400, -14400, -14400, -14400, -14400, -14400, -14400,
+	}, 0x09c83491},
+};
+
+/* LowPassFilter::add, as used by the touch screen driver on the Spark */
+static const FilterReference lowPassFilterReference[FILTER_REFERENCE_B_VALUES] = {
+	{{
+		-14400, -14394, -14378, -14362, -14357, -14355, -14346, -14336,
+		-14176, -13697, -13090, -12601, -12271, -12071, -11952, -11874,
+		-11825, -11803, -11792, -11778, -11766, -11764, -11773, -11781,
+		-11778, -11772, -11774, -11777, -11770, -11762, -11762, -11772,
+		-11781, -11778, -11773, -11775, -11778, -11771, -11763, -11763,
+		-11773, -11782, -11779, -11774, -11776, -11778, -11772, -11763,
+	}, 0x118ef381},
+	{{
+		-14400, -14399, -14394, -14387, -14382, -14377, -14371, -14364,
+		-14319, -14175, -13942, -13673, -13404, -13151, -12925, -12725,
+		-12552, -12406, -12286, -12184, -12099, -12031, -11978, -11937,
+		-11903, -11875, -11854, -11837, -11822, -11809, -11799, -11794,
+		-11791, -11788, -11784, -11782, -11781, -11779, -11775, -11773,
+		-11773, -11775, -11776, -11775, -11775, -11776, -11775, -11772,
+	}, 0xbe62145e},
+	{{
+		-14400, -14400, -14399, -14397, -14394, -14392, -14389, -14386,
+		-14373, -14332, -14261, -14167, -14057, -13938, -13813, -13686,
+		-13558, -13433, -13311, -13193, -13080, -12973, -12873, -12780,
+		-12692, -12611, -12535, -12466, -12401, -12342, -12287, -12238,
+		-12193, -12152, -12115, -12081, -12051, -12023, -11997, -11973,
+		-11953, -11935, -11918, -11903, -11890, -11878, -11867, -11856,
+	}, 0x4f6af313},
+	{{
+		-14400, -14400, -14400, -14399, -14399, -14398, -14397, -14396,
+		-14392, -14381, -14361, -14334, -14299, -14259, -14214, -14165,
+		-14113, -14058, -14000, -13941, -13881, -13819, -13757, -13695,
+		-13633, -13571, -13509, -13449, -13389, -13329, -13271, -13215,
+		-13159, -13105, -13052, -13001, -12951, -12902, -12855, -12809,
+		-12765, -12722, -12681, -12641, -12603, -12566, -12531, -12496,
+	}, 0xe508ea94},
+	{{
+		-14400, -14400, -14400, -14400, -14400, -14400, -14400, -14399,
+		-14398, -14395, -14390, -14383, -14373, -14361, -14348, -14333,
+		-14316, -14298, -14279, -14258, -14236, -14213, -14189, -14165,
+		-14139, -14113, -14086, -14058, -14030, -14001, -13972, -13943,
+		-13913, -13883, -13853, -13823, -13792, -13762, -13731, -13700,
+		-13670, -13639, -13608, -13578, -13548, -13517, -13487, -13457,
+	}, 0xe8819639},
+	{{
+		-14400, -14400, -14400, -14400, -14400, -14400, -14400, -14400,
+		-14400, -14399, -14398, -14396, -14393, -14390, -14387, -14382,
+		-14378, -14373, -14367, -14361, -14354, -14347, -14340, -14332,
+		-14324, -14315, -14307, -14297, -14288, -14278, -14268, -14257,
+		-14246, -14235, -14224, -14213, -14201, -14189, -14177, -14164,
+		-14151, -14139, -14126, -14112, -14099, -14086, -14072, -14058,
+	}, 0x002dc5ba},
+	{{
+		-14400, -14400, -14400, -14400, -14400, -14400, -14400, -14400,
+		-14400, -14400, -14400, -14399, -14399, -14398, -14397, -14396,
+		-14395, -14393, -14392, -14390, -14388, -14386, -14384, -14382,
+		-14380, -14377, -14375, -14372, -14369, -14366, -14363, -14360,
+		-14357, -14354, -14350, -14347, -14343, -14339, -14335, -14332,
+		-14327, -14323, -14319, -14315, -14310, -14306, -14301, -14297,
+	}, 0x5c8a75e8},
+};
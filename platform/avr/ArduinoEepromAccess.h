@@ -36,4 +36,7 @@ public:
 	static void writeBlock(eptr_t target, const void* source, uint16_t size) {
 		eeprom_update_block(source, (void*)target, size);
 	}	
+	static void flush() {
+		// written right away
+	}
 };
@@ -75,6 +75,75 @@
 #endif	
 #endif
 
+/**
+ * Loop timing statistics take about 250 bytes of RAM, which the AVR can't spare.
+ */
+#ifndef BREWPI_LOOP_TIMING
+#define BREWPI_LOOP_TIMING 0
+#endif
+
+/**
+ * The temp sensor filters shift by variable amounts, which is slower, but a filter compiled per b value would take
+ * another copy of the filter code for each value, and the AVR is short of flash.
+ */
+#ifndef TEMP_SENSOR_CONSTANT_SHIFT_FILTER
+#define TEMP_SENSOR_CONSTANT_SHIFT_FILTER 0
+#endif
+
+/**
+ * The binary piLink protocol needs a frame buffer and more flash than the AVR has left.
+ */
+#ifndef BREWPI_PILINK_FRAMES
+#define BREWPI_PILINK_FRAMES 0
+#endif
+
+/**
+ * Telemetry subscriptions take about 90 bytes of RAM.
+ */
+#ifndef BREWPI_TELEMETRY
+#define BREWPI_TELEMETRY 0
+#endif
+
+/**
+ * There is no RAM for a transmit buffer, output goes to the 64 byte buffer of the serial port.
+ */
+#ifndef BREWPI_PILINK_TX_BUFFER
+#define BREWPI_PILINK_TX_BUFFER 0
+#endif
+
+/**
+ * A device batch holds a copy of every device definition in RAM.
+ */
+#ifndef BREWPI_DEVICE_BATCH
+#define BREWPI_DEVICE_BATCH 0
+#endif
+
+/**
+ * The copy of the device table takes about 350 bytes of RAM.
+ */
+#ifndef BREWPI_DEVICE_CACHE
+#define BREWPI_DEVICE_CACHE 0
+#endif
+
+/**
+ * Commands are received in a RAM buffer. This fits a device definition. A full set of settings and constants is
+ * larger, it is applied in parts as it comes in.
+ */
+#ifndef PILINK_COMMAND_SIZE
+#define PILINK_COMMAND_SIZE 128
+#endif
+
+/**
+ * The serial port has a 64 byte receive buffer, which holds about two short commands while the controller is busy.
+ */
+#ifndef PILINK_MAX_IN_FLIGHT
+#define PILINK_MAX_IN_FLIGHT 2
+#endif
+
+#ifndef PILINK_RECEIVE_WINDOW
+#define PILINK_RECEIVE_WINDOW 64
+#endif
+
 // BREWPI_SENSOR_PINS - can be disabled if only using onewire devices
 #ifndef BREWPI_SENSOR_PINS
 #define BREWPI_SENSOR_PINS 1
@@ -22,14 +22,21 @@ DisplayLcd.cpp
 
 DS2413.cpp
 
+EepromJournal.cpp
+
 EepromManager.cpp
 
+EepromRecords.cpp
+
 FilterCascaded.cpp
 
 FilterFixed.cpp
+JsonWriter.cpp
 
 Logger.cpp
 
+LoopTiming.cpp
+
 Main.cpp
 
 Menu.cpp
@@ -38,19 +45,26 @@ OLEDFourBit.cpp
 
 OneWire.cpp
 
+OneWireConversionScheduler.cpp
+
 OneWireTempSensor.cpp
 
 PiLink.cpp
+PiLinkFrames.cpp
+PiLinkTxBuffer.cpp
 
 Random.cpp
 
 RotaryEncoder.cpp
 
+Scheduler.cpp
+
 Sensor.cpp
 
 SettingsManager.cpp
 
 Simulator.cpp
+SimulatorRecorder.cpp
 
 SpiLcd.cpp
 
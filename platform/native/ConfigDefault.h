@@ -0,0 +1,82 @@
+/*
+ * Copyright 2013 BrewPi/Elco Jacobs.
+ * Copyright 2013 Matthew McGowan.
+ *
+ * This file is part of BrewPi.
+ * 
+ * BrewPi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * BrewPi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with BrewPi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+/**
+ * Do not change this file directly - rather edit Config.h
+ */
+
+/*
+ * The native build has no hardware. Sensors and actuators are simulated.
+ */
+#ifndef BREWPI_SIMULATE
+#define BREWPI_SIMULATE 1
+#endif
+
+/*
+ * Code size is not a concern on the host. TempControl objects each have their own state and the clock is per thread,
+ * so tools can run many independent controllers in parallel.
+ */
+#ifndef TEMP_CONTROL_STATIC
+#define TEMP_CONTROL_STATIC 0
+#endif
+
+#ifndef BREWPI_THREAD_LOCAL
+#define BREWPI_THREAD_LOCAL thread_local
+#endif
+
+#ifndef BREWPI_DS2413
+#define BREWPI_DS2413 0
+#endif
+
+#ifndef BREWPI_ACTUATOR_PINS
+#define BREWPI_ACTUATOR_PINS 0
+#endif
+
+#ifndef BREWPI_SENSOR_PINS
+#define BREWPI_SENSOR_PINS 0
+#endif
+
+#ifndef BREWPI_LCD
+#define BREWPI_LCD 0
+#endif
+
+#ifndef BREWPI_BUZZER
+#define BREWPI_BUZZER 0
+#endif
+
+#ifndef BREWPI_ROTARY_ENCODER
+#define BREWPI_ROTARY_ENCODER 0
+#endif
+
+#ifndef BREWPI_MENU
+#define BREWPI_MENU 0
+#endif
+
+/**
+ * File used to persist the eeprom contents between runs. Can be overridden at runtime
+ * with the BREWPI_EEPROM environment variable.
+ */
+#ifndef BREWPI_EEPROM_FILE
+#define BREWPI_EEPROM_FILE "brewpi-eeprom.bin"
+#endif
+
+#define BREWPI_BOARD 'n'
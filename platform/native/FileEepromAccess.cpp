@@ -0,0 +1,71 @@
+/*
+ * Copyright 2013 BrewPi/Elco Jacobs.
+ * Copyright 2013 Matthew McGowan.
+ *
+ * This file is part of BrewPi.
+ * 
+ * BrewPi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * BrewPi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with BrewPi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Brewpi.h"
+#include "FileEepromAccess.h"
+
+uint8_t FileEepromAccess::contents[EEPROM_SIZE];
+FILE* FileEepromAccess::file = NULL;
+
+void FileEepromAccess::open()
+{
+	const char* path = getenv("BREWPI_EEPROM");
+	if (path==NULL)
+		path = BREWPI_EEPROM_FILE;
+
+	// an erased eeprom reads as 0xFF
+	memset(contents, 0xFF, sizeof(contents));
+	file = fopen(path, "r+b");
+	if (file==NULL)
+		file = fopen(path, "w+b");
+	if (file==NULL) {
+		perror(path);		// carry on without persistence
+		return;
+	}
+	if (fread(contents, 1, sizeof(contents), file)<sizeof(contents))
+		store(0, sizeof(contents));		// new or truncated file
+}
+
+uint8_t* FileEepromAccess::image()
+{
+	static bool opened = false;
+	if (!opened) {
+		opened = true;
+		open();
+	}
+	return contents;
+}
+
+void FileEepromAccess::store(eptr_t offset, uint16_t size)
+{
+	if (file==NULL)
+		return;
+	if (fseek(file, offset, SEEK_SET) || fwrite(contents+offset, 1, size, file)!=size || fflush(file))
+		perror("eeprom write");
+}
+
+void FileEepromAccess::writeBlock(eptr_t target, const void* source, uint16_t size)
+{
+	uint8_t* data = image()+target;
+	if (!memcmp(data, source, size))
+		return;		// unchanged, like eeprom_update_block
+	memcpy(data, source, size);
+	store(target, size);
+}
@@ -0,0 +1,59 @@
+/*
+ * Copyright 2013 BrewPi/Elco Jacobs.
+ * Copyright 2013 Matthew McGowan.
+ *
+ * This file is part of BrewPi.
+ * 
+ * BrewPi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * BrewPi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with BrewPi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "EepromTypes.h"
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * Eeprom emulation backed by a file. The contents are kept in memory and each write is written through to the file,
+ * so settings and devices persist between runs, as they do on the controller.
+ * The file is opened on first access: BREWPI_EEPROM from the environment if set, else BREWPI_EEPROM_FILE.
+ */
+class FileEepromAccess
+{
+public:
+	static const uint16_t EEPROM_SIZE = 1024;
+
+	static uint8_t readByte(eptr_t offset) {
+		return image()[offset];
+	}
+	static void writeByte(eptr_t offset, uint8_t value) {
+		writeBlock(offset, &value, 1);
+	}
+	
+	static void readBlock(void* target, eptr_t offset, uint16_t size) {
+		memcpy(target, image()+offset, size);
+	}
+	static void writeBlock(eptr_t target, const void* source, uint16_t size);
+	static void flush() {
+		// written through on each write
+	}
+
+private:
+	static uint8_t* image();
+	static void open();
+	static void store(eptr_t offset, uint16_t size);
+
+	static uint8_t contents[EEPROM_SIZE];
+	static FILE* file;
+};
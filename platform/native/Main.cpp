@@ -0,0 +1,121 @@
+/*
+ * Copyright 2013 BrewPi/Elco Jacobs.
+ * Copyright 2013 Matthew McGowan.
+ *
+ * This file is part of BrewPi.
+ * 
+ * BrewPi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * BrewPi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with BrewPi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Brewpi.h"
+#include "PiLink.h"
+#include "Simulator.h"
+#include "SimulatorRecorder.h"
+#include "Ticks.h"
+
+#include <getopt.h>
+
+// setup and loop are in brewpi_config so they can be reused across projects
+extern void setup(void);
+extern void loop (void);
+
+static FILE* recordFile;
+
+static void writeRecords(const uint8_t* data, uint16_t length)
+{
+	fwrite(data, 1, length, recordFile);
+}
+
+static void usage(const char* name)
+{
+	fprintf(stderr, "usage: %s [--headless SECONDS [--record FILE]]\n", name);
+	fprintf(stderr, "  --headless SECONDS  run piLink commands from stdin until it is closed, then simulate SECONDS\n");
+	fprintf(stderr, "                      at full speed and exit\n");
+	fprintf(stderr, "  --record FILE       write binary state records to FILE while running headless\n");
+	exit(2);
+}
+
+/*
+ * Headless mode is for regression runs: the controller is configured with the commands on stdin,
+ * e.g. j{mode:b,beerSet:18}, and the simulation then runs without any pacing or serial output.
+ */
+static int runHeadless(uint32_t seconds, const char* recordPath)
+{
+	while (!stdIO.closed()) {
+		piLink.receive();
+		piLink.transmit();
+		wait.millis(1);
+	}
+	piLink.flush();
+
+	if (recordPath) {
+		recordFile = fopen(recordPath, "wb");
+		if (recordFile==NULL) {
+			perror(recordPath);
+			return 1;
+		}
+		SimulatorRecorder::begin(writeRecords, printTempInterval);
+	}
+
+	unsigned long start = millis();
+	simulateHeadless(seconds);
+	unsigned long elapsed = millis()-start;
+
+	if (recordFile) {
+		SimulatorRecorder::end();
+		fclose(recordFile);
+	}
+	fprintf(stderr, "simulated %lu seconds in %lu ms\n", (unsigned long)seconds, elapsed);
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	programArguments = argv;
+
+	static const struct option options[] = {
+		{ "headless", required_argument, NULL, 'H' },
+		{ "record", required_argument, NULL, 'r' },
+		{ NULL, 0, NULL, 0 }
+	};
+	bool headless = false;
+	uint32_t seconds = 0;
+	const char* recordPath = NULL;
+	int option;
+	while ((option = getopt_long(argc, argv, "H:r:", options, NULL))!=-1) {
+		switch (option) {
+			case 'H':
+				headless = true;
+				seconds = strtoul(optarg, NULL, 10);
+				break;
+			case 'r':
+				recordPath = optarg;
+				break;
+			default:
+				usage(argv[0]);
+		}
+	}
+	if (optind<argc || (recordPath && !headless))
+		usage(argv[0]);
+
+	setup();
+
+	if (headless)
+		return runHeadless(seconds, recordPath);
+
+	for (;;) {
+		loop();
+	}
+	return 0;
+}
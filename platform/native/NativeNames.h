@@ -0,0 +1,37 @@
+/*
+ * Copyright 2013 BrewPi/Elco Jacobs.
+ * Copyright 2013 Matthew McGowan.
+ *
+ * This file is part of BrewPi.
+ * 
+ * BrewPi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * BrewPi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with BrewPi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+/*
+ * Included ahead of every source file in the native build (see makefile).
+ * The application's globals 'alarm' (the alarm actuator) and 'wait' (the delay implementation) clash with the POSIX
+ * functions of the same name. The system headers declaring them are included first, then the application's globals
+ * are renamed. The application never calls the POSIX functions, so nothing else changes.
+ */
+
+#include <unistd.h>
+#include <sys/wait.h>
+#ifdef __cplusplus
+#include <condition_variable>		// has a member named wait
+#endif
+
+#define alarm brewpiAlarm
+#define wait brewpiWait
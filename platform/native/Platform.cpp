@@ -0,0 +1,97 @@
+/*
+ * Copyright 2013 BrewPi/Elco Jacobs.
+ * Copyright 2013 Matthew McGowan.
+ *
+ * This file is part of BrewPi.
+ * 
+ * BrewPi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * BrewPi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with BrewPi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Brewpi.h"
+
+#include <time.h>
+
+char** programArguments;
+
+/*
+ * Resetting the controller restarts the process. The eeprom file keeps the settings, as on the controller.
+ */
+void handleReset() 
+{ 
+	fflush(stdout);
+	if (programArguments)
+		execv("/proc/self/exe", programArguments);
+	exit(0);
+}
+
+static uint64_t monotonicMicros()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return uint64_t(now.tv_sec)*1000000u + now.tv_nsec/1000;
+}
+
+static const uint64_t startMicros = monotonicMicros();
+
+// like on the controller, millis() and micros() count from startup and wrap around
+unsigned long millis()
+{
+	return uint32_t((monotonicMicros()-startMicros)/1000);
+}
+
+unsigned long micros()
+{
+	return uint32_t(monotonicMicros()-startMicros);
+}
+
+long random(long howbig)
+{
+	return howbig>0 ? ::random() % howbig : 0;
+}
+
+long random(long howsmall, long howbig)
+{
+	return howsmall>=howbig ? howsmall : howsmall + random(howbig-howsmall);
+}
+
+char* ltoa(long value, char* buffer, int radix)
+{
+	// only decimal is used by the application
+	sprintf(buffer, radix==16 ? "%lx" : "%ld", value);
+	return buffer;
+}
+
+size_t Print::print(int value)
+{
+	return print(long(value));
+}
+
+size_t Print::print(unsigned int value)
+{
+	return print((unsigned long)value);
+}
+
+size_t Print::print(long value)
+{
+	char buf[24];
+	snprintf(buf, sizeof(buf), "%ld", value);
+	return write(buf);
+}
+
+size_t Print::print(unsigned long value)
+{
+	char buf[24];
+	snprintf(buf, sizeof(buf), "%lu", value);
+	return write(buf);
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright 2013 BrewPi/Elco Jacobs.
+ * Copyright 2013 Matthew McGowan.
+ *
+ * This file is part of BrewPi.
+ * 
+ * BrewPi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * BrewPi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with BrewPi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+/*
+ * Platform definitions for building the controller as a native (Linux) executable.
+ * There is no hardware, so devices are simulated and time is provided by the simulator.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+
+#define NATIVE 1
+
+#if !BREWPI_SIMULATE
+#error The native platform has no hardware: build with BREWPI_SIMULATE
+#endif
+
+#define strcpy_P strcpy
+#define strlcpy_P strncpy
+#define sprintf_P sprintf
+#define strcmp_P strcmp
+#define strchr_P strchr
+#define memcpy_P memcpy
+#define vsnprintf_P vsnprintf
+#define PROGMEM
+#define PSTR(x) x
+#define pgm_read_byte(x)  (*(x))
+
+typedef uint8_t byte;
+typedef bool boolean;
+typedef uint8_t DeviceAddress[8];
+
+using std::min;
+using std::max;
+
+#define constrain(amt,low,high) ((amt)<(low)?(low):((amt)>(high)?(high):(amt)))
+
+#define TWO_PI 6.283185307179586476925286766559
+
+/* The Arduino functions used by the application, implemented in Platform.cpp */
+unsigned long millis();
+unsigned long micros();
+long random(long howbig);
+long random(long howsmall, long howbig);
+char* ltoa(long value, char* buffer, int radix);
+
+/* The command line arguments, used to restart the process when the controller is reset. */
+extern char** programArguments;
+
+#include "Print.h"
+#include "StdIO.h"
@@ -0,0 +1,67 @@
+/*
+ * Copyright 2013 BrewPi/Elco Jacobs.
+ * Copyright 2013 Matthew McGowan.
+ *
+ * This file is part of BrewPi.
+ * 
+ * BrewPi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * BrewPi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with BrewPi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * The subset of the Arduino Print class used by the application.
+ */
+class Print {
+public:
+	virtual ~Print() {}
+
+	virtual size_t write(uint8_t c) = 0;
+
+	virtual size_t write(const uint8_t* buffer, size_t size) {
+		size_t n = 0;
+		while (size--)
+			n += write(*buffer++);
+		return n;
+	}
+
+	size_t write(const char* str) {
+		return str ? write((const uint8_t*)str, strlen(str)) : 0;
+	}
+
+	size_t print(const char* str) { return write(str); }
+	size_t print(char c) { return write(uint8_t(c)); }
+	size_t print(int value);
+	size_t print(unsigned int value);
+	size_t print(long value);
+	size_t print(unsigned long value);
+
+	size_t println() { return write("\r\n"); }
+	size_t println(const char* str) { return print(str) + println(); }
+};
+
+/**
+ * The subset of the Arduino Stream class used by the application.
+ */
+class Stream : public Print {
+public:
+	virtual int available() = 0;
+	virtual int read() = 0;
+	virtual int peek() = 0;
+	virtual void flush() = 0;
+};
@@ -0,0 +1,75 @@
+/*
+ * Copyright 2013 BrewPi/Elco Jacobs.
+ * Copyright 2013 Matthew McGowan.
+ *
+ * This file is part of BrewPi.
+ * 
+ * BrewPi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * BrewPi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with BrewPi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Brewpi.h"
+#include "StdIO.h"
+
+#include <unistd.h>
+#include <poll.h>
+
+StdIO::StdIO() : peeked(-1), eof(false)
+{
+}
+
+int StdIO::available()
+{
+	if (peeked>=0)
+		return 1;
+	if (eof)
+		return 0;
+	struct pollfd fd = { STDIN_FILENO, POLLIN, 0 };
+	if (poll(&fd, 1, 0)<=0 || !(fd.revents & (POLLIN|POLLHUP)))
+		return 0;
+	peeked = peek();
+	return peeked>=0 ? 1 : 0;
+}
+
+int StdIO::peek()
+{
+	if (peeked<0 && !eof) {
+		unsigned char c;
+		ssize_t count = ::read(STDIN_FILENO, &c, 1);
+		if (count==1)
+			peeked = c;
+		else if (count==0)
+			eof = true;		// input closed, keep running without input
+	}
+	return peeked;
+}
+
+int StdIO::read()
+{
+	int c = peek();
+	peeked = -1;
+	return c;
+}
+
+void StdIO::flush()
+{
+	fflush(stdout);
+}
+
+size_t StdIO::write(uint8_t c)
+{
+	putchar(c);
+	if (c=='\n')
+		fflush(stdout);
+	return 1;
+}
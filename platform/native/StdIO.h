@@ -0,0 +1,56 @@
+/*
+ * Copyright 2013 BrewPi/Elco Jacobs.
+ * Copyright 2013 Matthew McGowan.
+ *
+ * This file is part of BrewPi.
+ * 
+ * BrewPi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * BrewPi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with BrewPi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "Print.h"
+
+/**
+ * A Stream on the process' standard input and output, used as the PiLink serial port.
+ * Reading never blocks: available() returns 0 when no input is waiting. Output is flushed at the end of each line.
+ * To connect the script over a serial device, run the executable on a pty, e.g. with socat.
+ */
+class StdIO : public Stream {
+public:
+	StdIO();
+
+	void begin(unsigned long baud) {}
+
+	int available();
+	int read();
+	int peek();
+	void flush();
+
+	size_t write(uint8_t c);
+	using Print::write;
+
+	operator bool() { return true; }
+
+	/**
+	 * Returns true when the input has been closed and all of it has been read.
+	 */
+	bool closed() { return !available() && eof; }
+
+private:
+	int peeked;		// -1 when no character is buffered
+	bool eof;
+};
+
+extern StdIO stdIO;
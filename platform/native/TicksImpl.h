@@ -0,0 +1,45 @@
+/*
+ * Copyright 2013 BrewPi/Elco Jacobs.
+ * Copyright 2013 Matthew McGowan.
+ *
+ * This file is part of BrewPi.
+ * 
+ * BrewPi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * BrewPi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with BrewPi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <time.h>
+
+/*
+ * Time is driven by the simulator: each step advances the ticks by one second, independent of real time.
+ * Delays are real delays, so that waiting for serial input gives the other end time to send it.
+ */
+class NativeDelay {
+public:
+	void seconds(uint16_t seconds)	{ millis(uint32_t(seconds)*1000); }
+	void millis(uint32_t millis)	{ microseconds(millis*1000); }
+	void microseconds(uint32_t micros) {
+		struct timespec duration = { time_t(micros/1000000), long(micros%1000000)*1000 };
+		nanosleep(&duration, NULL);
+	}
+};
+
+typedef ExternalTicks TicksImpl;
+typedef NativeDelay DelayImpl;
+#define TICKS_IMPL_CONFIG
+#define DELAY_IMPL_CONFIG
+
+extern BREWPI_THREAD_LOCAL TicksImpl ticks;
+extern DelayImpl wait;
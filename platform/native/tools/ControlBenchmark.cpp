@@ -0,0 +1,287 @@
+/*
+ * Copyright 2013 BrewPi/Elco Jacobs.
+ * Copyright 2013 Matthew McGowan.
+ *
+ * This file is part of BrewPi.
+ * 
+ * BrewPi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * BrewPi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with BrewPi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * brewpi-control-benchmark runs the controller against the simulator through a fixed set of scenarios and reports
+ * how well it controlled the beer temperature. The runs are deterministic, so results of two firmware revisions
+ * can be compared directly.
+ *
+ *   brewpi-control-benchmark [-o results.json] [-c baseline.json [-t percent]]
+ *
+ * With -c, each metric is compared with the baseline and the exit status is 1 when any scenario got worse by more
+ * than the tolerance (default 10%).
+ */
+
+#include "Brewpi.h"
+#include "ControlRun.h"
+
+#include <unistd.h>
+#include <thread>
+#include <vector>
+
+#define HOURS(h) uint32_t((h)*3600ul)
+#define DAYS(d) HOURS((d)*24ul)
+
+struct BenchmarkScenario {
+	const char* name;
+	void (*configure)(ChamberParameters& chamber);
+	double setting;				// beer setting at the start
+	uint32_t settleTime;		// seconds run before the event
+	void (*event)(ControlRun& run);		// starts the measurement
+	uint32_t measureTime;		// seconds measured after the event
+};
+
+static void steadyChamber(ChamberParameters& chamber, double temp)
+{
+	chamber.beerTemp = temp;
+	chamber.fridgeTemp = temp;
+	chamber.fermentPower = 0;
+}
+
+static void configureStep(ChamberParameters& chamber)
+{
+	steadyChamber(chamber, 20);
+}
+
+static void stepSetting(ControlRun& run)
+{
+	run.changeSetting(15);
+}
+
+static void configureDoor(ChamberParameters& chamber)
+{
+	steadyChamber(chamber, 18);
+}
+
+static void openDoor(ControlRun& run)
+{
+	run.startMeasurement();
+	run.setDoorOpen(true);
+	run.run(HOURS(0.25));
+	run.setDoorOpen(false);
+}
+
+static void configureAmbient(ChamberParameters& chamber)
+{
+	steadyChamber(chamber, 18);
+	chamber.minRoomTemp = 8;
+	chamber.maxRoomTemp = 28;
+}
+
+static void startMeasurement(ControlRun& run)
+{
+	run.startMeasurement();
+}
+
+static void configureFerment(ChamberParameters& chamber)
+{
+	steadyChamber(chamber, 20);
+	chamber.fermentPower = 15;		// the simulated fermentation peaks between day 2 and 3 and ends after day 5
+}
+
+static const BenchmarkScenario scenarios[] = {
+	// beer setting lowered by 5C after settling
+	{ "step", configureStep, 20, DAYS(1), stepSetting, DAYS(3) },
+	// door open for 15 minutes
+	{ "door", configureDoor, 18, DAYS(2), openDoor, DAYS(1) },
+	// room temperature swinging between 8 and 28C every day
+	{ "ambient", configureAmbient, 18, DAYS(1), startMeasurement, DAYS(3) },
+	// heat produced by an active fermentation
+	{ "ferment", configureFerment, 20, 0, startMeasurement, DAYS(7) }
+};
+
+#define SCENARIO_COUNT (sizeof(scenarios)/sizeof(scenarios[0]))
+
+static ControlMetrics results[SCENARIO_COUNT];
+
+static void runScenario(const BenchmarkScenario* scenario, ControlMetrics* result)
+{
+	ChamberParameters chamber;
+	scenario->configure(chamber);
+	ControlRun run(chamber);
+	run.start(MODE_BEER_CONSTANT, scenario->setting);
+	run.run(scenario->settleTime);
+	scenario->event(run);
+	run.run(scenario->measureTime);
+	*result = run.metrics();
+}
+
+static void writeResults(FILE* file)
+{
+	fprintf(file, "{\"scenarios\":[\n");
+	for (size_t i=0; i<SCENARIO_COUNT; i++) {
+		const ControlMetrics& m = results[i];
+		fprintf(file, "{\"name\":\"%s\",\"overshoot\":%.4f,\"settleTime\":%u,\"settled\":%d,\"absError\":%.4f,"
+			"\"heatCycles\":%u,\"coolCycles\":%u,\"heatTime\":%u,\"coolTime\":%u}%s\n",
+			scenarios[i].name, m.overshoot, m.settlingTime, m.settled, m.absoluteError,
+			m.heatCycles, m.coolCycles, m.heatTime, m.coolTime, i+1<SCENARIO_COUNT ? "," : "");
+	}
+	fprintf(file, "]}\n");
+}
+
+/*
+ * Reads a file written by writeResults. Returns the number of scenarios read into baseline, in scenario order.
+ * Scenarios that are missing from the file have no baseline.
+ */
+static size_t readBaseline(FILE* file, ControlMetrics* baseline, bool* found)
+{
+	char line[512];
+	size_t count = 0;
+	while (fgets(line, sizeof(line), file)) {
+		char name[32];
+		ControlMetrics m;
+		int settled;
+		unsigned heatCycles, coolCycles, settlingTime, heatTime, coolTime;
+		if (sscanf(line, "{\"name\":\"%31[^\"]\",\"overshoot\":%lf,\"settleTime\":%u,\"settled\":%d,\"absError\":%lf,"
+				"\"heatCycles\":%u,\"coolCycles\":%u,\"heatTime\":%u,\"coolTime\":%u",
+				name, &m.overshoot, &settlingTime, &settled, &m.absoluteError,
+				&heatCycles, &coolCycles, &heatTime, &coolTime)!=9)
+			continue;
+		m.settlingTime = settlingTime;
+		m.settled = settled;
+		m.heatCycles = heatCycles;
+		m.coolCycles = coolCycles;
+		m.heatTime = heatTime;
+		m.coolTime = coolTime;
+		for (size_t i=0; i<SCENARIO_COUNT; i++) {
+			if (strcmp(scenarios[i].name, name)==0) {
+				baseline[i] = m;
+				found[i] = true;
+				count++;
+			}
+		}
+	}
+	return count;
+}
+
+/*
+ * Prints the change of one metric. Returns true when it got worse by more than the tolerance.
+ * The margin keeps tiny absolute changes of values close to zero from counting as a regression.
+ */
+static bool compareMetric(const char* scenario, const char* metric, double value, double base, double tolerance, double margin)
+{
+	bool worse = value > base + max(base*tolerance, margin);
+	printf("%-8s %-11s %10.3f %10.3f %+8.1f%%%s\n", scenario, metric, base, value,
+		base!=0 ? (value-base)*100/base : 0.0, worse ? "  WORSE" : "");
+	return worse;
+}
+
+static bool compare(const ControlMetrics* baseline, const bool* found, double tolerance)
+{
+	bool worse = false;
+	printf("%-8s %-11s %10s %10s %9s\n", "scenario", "metric", "baseline", "current", "change");
+	for (size_t i=0; i<SCENARIO_COUNT; i++) {
+		if (!found[i]) {
+			printf("%-8s no baseline\n", scenarios[i].name);
+			continue;
+		}
+		const ControlMetrics& m = results[i];
+		const ControlMetrics& b = baseline[i];
+		const char* name = scenarios[i].name;
+		worse |= compareMetric(name, "overshoot", m.overshoot, b.overshoot, tolerance, 0.02);
+		worse |= compareMetric(name, "settleHours", m.settlingTime/3600.0, b.settlingTime/3600.0, tolerance, 0.1);
+		worse |= compareMetric(name, "absError", m.absoluteError, b.absoluteError, tolerance, 0.05);
+		worse |= compareMetric(name, "heatCycles", m.heatCycles, b.heatCycles, tolerance, 1);
+		worse |= compareMetric(name, "coolCycles", m.coolCycles, b.coolCycles, tolerance, 1);
+		worse |= compareMetric(name, "heatHours", m.heatTime/3600.0, b.heatTime/3600.0, tolerance, 0.1);
+		worse |= compareMetric(name, "coolHours", m.coolTime/3600.0, b.coolTime/3600.0, tolerance, 0.1);
+		if (b.settled && !m.settled) {
+			printf("%-8s no longer settles  WORSE\n", name);
+			worse = true;
+		}
+	}
+	return worse;
+}
+
+static void printResults()
+{
+	printf("%-8s %9s %11s %7s %9s %10s %10s %9s %9s\n", "scenario", "overshoot", "settleHours", "settled",
+		"absError", "heatCycles", "coolCycles", "heatHours", "coolHours");
+	for (size_t i=0; i<SCENARIO_COUNT; i++) {
+		const ControlMetrics& m = results[i];
+		printf("%-8s %9.3f %11.2f %7d %9.3f %10u %10u %9.2f %9.2f\n", scenarios[i].name, m.overshoot,
+			m.settlingTime/3600.0, m.settled, m.absoluteError, m.heatCycles, m.coolCycles,
+			m.heatTime/3600.0, m.coolTime/3600.0);
+	}
+}
+
+static void usage(const char* name)
+{
+	fprintf(stderr, "usage: %s [-o results.json] [-c baseline.json [-t percent]]\n", name);
+	exit(2);
+}
+
+int main(int argc, char** argv)
+{
+	const char* outputPath = NULL;
+	const char* baselinePath = NULL;
+	double tolerance = 10;
+
+	int option;
+	while ((option = getopt(argc, argv, "o:c:t:h"))!=-1) {
+		switch (option) {
+			case 'o': outputPath = optarg; break;
+			case 'c': baselinePath = optarg; break;
+			case 't': tolerance = atof(optarg); break;
+			default: usage(argv[0]);
+		}
+	}
+	if (optind<argc)
+		usage(argv[0]);
+
+	// each scenario has its own controller, so they can run side by side
+	std::vector<std::thread> threads;
+	for (size_t i=0; i<SCENARIO_COUNT; i++)
+		threads.push_back(std::thread(runScenario, &scenarios[i], &results[i]));
+	for (size_t i=0; i<threads.size(); i++)
+		threads[i].join();
+
+	printResults();
+
+	if (outputPath) {
+		FILE* file = fopen(outputPath, "w");
+		if (file==NULL) {
+			perror(outputPath);
+			return 2;
+		}
+		writeResults(file);
+		fclose(file);
+	}
+
+	if (baselinePath) {
+		FILE* file = fopen(baselinePath, "r");
+		if (file==NULL) {
+			perror(baselinePath);
+			return 2;
+		}
+		ControlMetrics baseline[SCENARIO_COUNT];
+		bool found[SCENARIO_COUNT] = { false };
+		size_t count = readBaseline(file, baseline, found);
+		fclose(file);
+		if (count==0) {
+			fprintf(stderr, "%s: no benchmark results\n", baselinePath);
+			return 2;
+		}
+		printf("\n");
+		if (compare(baseline, found, tolerance/100))
+			return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,163 @@
+/*
+ * Copyright 2013 BrewPi/Elco Jacobs.
+ * Copyright 2013 Matthew McGowan.
+ *
+ * This file is part of BrewPi.
+ * 
+ * BrewPi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * BrewPi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with BrewPi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Brewpi.h"
+#include "ControlRun.h"
+#include "Ticks.h"
+
+ControlRun::ControlRun(const ChamberParameters& chamber) :
+	settleBand(0.25),
+	beerInput(true), fridgeInput(true), ambientInput(true),
+	beerSensor(TEMP_SENSOR_TYPE_BEER, &beerInput), fridgeSensor(TEMP_SENSOR_TYPE_FRIDGE, &fridgeInput),
+	door(false)
+{
+	control.beerSensor = &beerSensor;
+	control.fridgeSensor = &fridgeSensor;
+	control.ambientSensor = &ambientInput;
+	control.heater = &heater;
+	control.cooler = &cooler;
+	control.light = &light;
+	control.fan = &fan;
+	control.door = &door;
+	control.loadDefaultConstants();
+	control.loadDefaultSettings();
+
+	simulator.setTempControl(&control);
+	simulator.setFridgeVolume(chamber.fridgeVolume);
+	simulator.setBeerVolume(chamber.beerVolume);
+	simulator.setBeerDensity(chamber.beerDensity);
+	simulator.setHeatPower(chamber.heatPower);
+	simulator.setCoolPower(chamber.coolPower);
+	simulator.setRoomCoefficient(chamber.roomCoefficient);
+	simulator.setBeerCoefficient(chamber.beerCoefficient);
+	simulator.setDoorCoefficient(chamber.doorCoefficient);
+	simulator.setMinRoomTemp(chamber.minRoomTemp);
+	simulator.setMaxRoomTemp(chamber.maxRoomTemp);
+	simulator.setFermentMaxPowerOutput(chamber.fermentPower);
+	simulator.setBeerTemp(chamber.beerTemp);
+	simulator.setFridgeTemp(chamber.fridgeTemp);
+}
+
+void ControlRun::start(char mode, double setting)
+{
+	ticks.setMillis(0);
+	control.init();
+	control.initFilters();
+
+	// initialize the filters with the starting temperatures, as setup() does
+	simulator.step();
+	beerSensor.init();
+	fridgeSensor.init();
+
+	control.setMode(mode, true);
+	changeSetting(setting);
+}
+
+void ControlRun::changeSetting(double setting)
+{
+	if (control.modeIsBeer())
+		control.setBeerTemp(doubleToTemp(setting));
+	else
+		control.setFridgeTemp(doubleToTemp(setting));
+	startMeasurement();
+}
+
+double ControlRun::setting()
+{
+	temperature t = control.modeIsBeer() ? control.getBeerSetting() : control.getFridgeSetting();
+	return double(t-C_OFFSET)/TEMP_FIXED_POINT_SCALE;
+}
+
+double ControlRun::controlledTemp()
+{
+	return control.modeIsBeer() ? simulator.getBeerTemp() : simulator.getFridgeTemp();
+}
+
+void ControlRun::startMeasurement()
+{
+	memset(&m, 0, sizeof(m));
+	elapsed = 0;
+	lastOutside = 0;
+	target = setting();
+	double error = controlledTemp()-target;
+	approach = error>settleBand ? 1 : error<-settleBand ? -1 : 0;
+	reached = approach==0;
+	wasHeating = heater.isActive();
+	wasCooling = cooler.isActive();
+}
+
+void ControlRun::run(uint32_t seconds)
+{
+	while (seconds--)
+		step();
+}
+
+void ControlRun::step()
+{
+	// the same sequence as the simulator's control task
+	ticks.incMillis(1000);
+	control.updateTemperatures();
+	control.detectPeaks();
+	control.updatePID();
+	control.updateState();
+	control.updateOutputs();
+	simulator.step();
+	measure();
+}
+
+void ControlRun::measure()
+{
+	elapsed++;
+	double error = controlledTemp()-target;
+
+	m.absoluteError += fabs(error)/3600;
+	if (!reached)
+		reached = error*approach<=0;
+	if (reached) {
+		double excursion = approach ? -error*approach : fabs(error);
+		if (excursion>m.overshoot)
+			m.overshoot = excursion;
+	}
+	if (fabs(error)>settleBand)
+		lastOutside = elapsed;
+
+	bool heating = heater.isActive();
+	bool cooling = cooler.isActive();
+	if (heating) {
+		m.heatTime++;
+		if (!wasHeating)
+			m.heatCycles++;
+	}
+	if (cooling) {
+		m.coolTime++;
+		if (!wasCooling)
+			m.coolCycles++;
+	}
+	wasHeating = heating;
+	wasCooling = cooling;
+}
+
+ControlMetrics ControlRun::metrics()
+{
+	ControlMetrics result = m;
+	result.settlingTime = lastOutside;
+	result.settled = lastOutside<elapsed || elapsed==0;
+	return result;
+}
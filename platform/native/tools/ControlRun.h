@@ -0,0 +1,134 @@
+/*
+ * Copyright 2013 BrewPi/Elco Jacobs.
+ * Copyright 2013 Matthew McGowan.
+ *
+ * This file is part of BrewPi.
+ * 
+ * BrewPi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * BrewPi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with BrewPi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "Brewpi.h"
+#include "TempControl.h"
+#include "TempSensor.h"
+#include "TempSensorExternal.h"
+#include "Simulator.h"
+
+/**
+ * The physical properties of a simulated chamber and its starting temperatures.
+ * The defaults are those of the Simulator.
+ */
+struct ChamberParameters {
+	ChamberParameters() :
+		fridgeVolume(400), beerVolume(20), beerDensity(1.060), heatPower(25), coolPower(60),
+		roomCoefficient(1.67), beerCoefficient(3), doorCoefficient(20), minRoomTemp(13), maxRoomTemp(18), fermentPower(5),
+		beerTemp(22), fridgeTemp(20) {}
+
+	double fridgeVolume;		// liters
+	double beerVolume;			// liters
+	double beerDensity;			// SG
+	double heatPower;			// W
+	double coolPower;			// W
+	double roomCoefficient;		// W/K chamber <> room
+	double beerCoefficient;		// W/K chamber <> beer
+	double doorCoefficient;		// W/K chamber <> room while the door is open
+	double minRoomTemp;			// C, the room follows a daily sine between min and max
+	double maxRoomTemp;
+	double fermentPower;		// W, heat produced at the peak of fermentation
+	double beerTemp;			// C at the start of the run
+	double fridgeTemp;
+};
+
+/**
+ * How well the controlled temperature followed the setting, measured from startMeasurement().
+ * In beer modes this is the beer temperature, otherwise the fridge temperature.
+ */
+struct ControlMetrics {
+	double overshoot;			// C, the largest excursion past the setting once it was reached
+	uint32_t settlingTime;		// seconds until the temperature stayed within the settle band
+	bool settled;				// false when the temperature was outside the settle band at the end
+	double absoluteError;		// integral of |temperature - setting|, in C hours
+	uint16_t heatCycles;		// number of times the heater was switched on
+	uint16_t coolCycles;
+	uint32_t heatTime;			// seconds the heater was on
+	uint32_t coolTime;
+};
+
+/**
+ * A TempControl driving a simulated chamber, with its own sensors and actuators.
+ * Runs are independent of each other and of the application's tempControl, so each thread can have its own run.
+ * The clock is the calling thread's ticks object, which is reset by start().
+ */
+class ControlRun {
+public:
+	ControlRun(const ChamberParameters& chamber);
+
+	/**
+	 * Starts controlling in the given mode, like setup() does. Constants and estimators in control should be set before.
+	 * The setting is the beer setting in beer modes, the fridge setting otherwise.
+	 */
+	void start(char mode, double setting);
+
+	/**
+	 * Runs the controller and the simulation for the given number of seconds.
+	 */
+	void run(uint32_t seconds);
+
+	/**
+	 * Changes the beer or fridge setting, depending on the mode, and restarts the measurement.
+	 */
+	void changeSetting(double setting);
+
+	/**
+	 * Restarts the measurement from the current time, against the current setting.
+	 */
+	void startMeasurement();
+
+	void setDoorOpen(bool open) { door.setValue(open); }
+
+	ControlMetrics metrics();
+
+	/* The width of the band around the setting that counts as settled, in C either way. */
+	double settleBand;
+
+	TempControl control;
+	Simulator simulator;
+
+private:
+	void step();
+	void measure();
+	double setting();
+	double controlledTemp();		// the actual beer or fridge temperature, depending on the mode
+
+	ExternalTempSensor beerInput;
+	ExternalTempSensor fridgeInput;
+	ExternalTempSensor ambientInput;
+	TempSensor beerSensor;
+	TempSensor fridgeSensor;
+	ValueActuator heater;
+	ValueActuator cooler;
+	ValueActuator light;
+	ValueActuator fan;
+	ValueSensor<bool> door;
+
+	ControlMetrics m;
+	uint32_t elapsed;			// seconds since the measurement was started
+	uint32_t lastOutside;		// last time the beer was outside the settle band
+	double target;
+	int8_t approach;			// sign of the initial error, 0 when starting within the settle band
+	bool reached;
+	bool wasHeating;
+	bool wasCooling;
+};
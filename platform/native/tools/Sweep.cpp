@@ -0,0 +1,339 @@
+/*
+ * Copyright 2013 BrewPi/Elco Jacobs.
+ * Copyright 2013 Matthew McGowan.
+ *
+ * This file is part of BrewPi.
+ * 
+ * BrewPi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * BrewPi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with BrewPi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * brewpi-sweep runs the controller against the simulator for every combination of the given parameter values,
+ * spread over all cores, and ranks the parameter sets by overshoot, settling time and number of heat/cool cycles.
+ *
+ *   brewpi-sweep [-j threads] [-d days] [-n best] name=values...
+ *
+ * values is a single value, a list "1,2,5" or a range "from:to:step". The names are the piLink JSON keys of the
+ * control constants and estimators (Kp, idleRangeH, beerSlowFilt, heatEst...), the chamber parameters listed by -h
+ * and the beer setting, beerSet. The result is CSV on stdout, best first.
+ */
+
+#include "Brewpi.h"
+#include "ControlRun.h"
+#include "JsonKeys.h"
+
+#include <math.h>
+#include <unistd.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+/**
+ * The settings of one run. Parameters are applied to a copy of the defaults.
+ */
+struct SweepCase {
+	ControlConstants cc;
+	temperature heatEstimator;
+	temperature coolEstimator;
+	ChamberParameters chamber;
+	double beerSetting;
+};
+
+typedef void (*SweepSetter)(void* target, double value);
+
+static void setFixedPoint(void* target, double value)
+{
+	*(temperature*)target = temperature(lround(value*TEMP_FIXED_POINT_SCALE));
+}
+
+static void setUint8(void* target, double value)
+{
+	*(uint8_t*)target = uint8_t(value);
+}
+
+static void setUint16(void* target, double value)
+{
+	*(uint16_t*)target = uint16_t(value);
+}
+
+static void setDouble(void* target, double value)
+{
+	*(double*)target = value;
+}
+
+struct SweepParameter {
+	const char* name;
+	size_t offset;			// into SweepCase
+	SweepSetter set;
+};
+
+#define SWEEP_CC(key, field, set) { key, offsetof(SweepCase, cc)+offsetof(ControlConstants, field), set }
+#define SWEEP_CHAMBER(key, field) { key, offsetof(SweepCase, chamber)+offsetof(ChamberParameters, field), setDouble }
+
+static const SweepParameter sweepParameters[] = {
+	{ JSONKEY_beerSetting, offsetof(SweepCase, beerSetting), setDouble },
+	{ JSONKEY_heatEstimator, offsetof(SweepCase, heatEstimator), setFixedPoint },
+	{ JSONKEY_coolEstimator, offsetof(SweepCase, coolEstimator), setFixedPoint },
+
+	SWEEP_CC(JSONKEY_Kp, Kp, setFixedPoint),
+	SWEEP_CC(JSONKEY_Ki, Ki, setFixedPoint),
+	SWEEP_CC(JSONKEY_Kd, Kd, setFixedPoint),
+	SWEEP_CC(JSONKEY_iMaxError, iMaxError, setFixedPoint),
+	SWEEP_CC(JSONKEY_pidMax, pidMax, setFixedPoint),
+	SWEEP_CC(JSONKEY_idleRangeHigh, idleRangeHigh, setFixedPoint),
+	SWEEP_CC(JSONKEY_idleRangeLow, idleRangeLow, setFixedPoint),
+	SWEEP_CC(JSONKEY_heatingTargetUpper, heatingTargetUpper, setFixedPoint),
+	SWEEP_CC(JSONKEY_heatingTargetLower, heatingTargetLower, setFixedPoint),
+	SWEEP_CC(JSONKEY_coolingTargetUpper, coolingTargetUpper, setFixedPoint),
+	SWEEP_CC(JSONKEY_coolingTargetLower, coolingTargetLower, setFixedPoint),
+	SWEEP_CC(JSONKEY_maxHeatTimeForEstimate, maxHeatTimeForEstimate, setUint16),
+	SWEEP_CC(JSONKEY_maxCoolTimeForEstimate, maxCoolTimeForEstimate, setUint16),
+	SWEEP_CC(JSONKEY_fridgeFastFilter, fridgeFastFilter, setUint8),
+	SWEEP_CC(JSONKEY_fridgeSlowFilter, fridgeSlowFilter, setUint8),
+	SWEEP_CC(JSONKEY_fridgeSlopeFilter, fridgeSlopeFilter, setUint8),
+	SWEEP_CC(JSONKEY_beerFastFilter, beerFastFilter, setUint8),
+	SWEEP_CC(JSONKEY_beerSlowFilter, beerSlowFilter, setUint8),
+	SWEEP_CC(JSONKEY_beerSlopeFilter, beerSlopeFilter, setUint8),
+
+	SWEEP_CHAMBER("fridgeVolume", fridgeVolume),
+	SWEEP_CHAMBER("beerVolume", beerVolume),
+	SWEEP_CHAMBER("beerDensity", beerDensity),
+	SWEEP_CHAMBER("heatPower", heatPower),
+	SWEEP_CHAMBER("coolPower", coolPower),
+	SWEEP_CHAMBER("roomCoefficient", roomCoefficient),
+	SWEEP_CHAMBER("beerCoefficient", beerCoefficient),
+	SWEEP_CHAMBER("doorCoefficient", doorCoefficient),
+	SWEEP_CHAMBER("roomMin", minRoomTemp),
+	SWEEP_CHAMBER("roomMax", maxRoomTemp),
+	SWEEP_CHAMBER("fermentPower", fermentPower),
+	SWEEP_CHAMBER("beerStart", beerTemp),
+	SWEEP_CHAMBER("fridgeStart", fridgeTemp)
+};
+
+/**
+ * A swept parameter and the values it takes.
+ */
+struct SweepAxis {
+	const SweepParameter* parameter;
+	std::vector<double> values;
+};
+
+struct SweepResult {
+	ControlMetrics metrics;
+	uint32_t rankSum;
+};
+
+static std::vector<SweepAxis> axes;
+static std::vector<SweepResult> results;
+static SweepCase defaults;
+static uint32_t duration;
+
+static void usage(const char* name)
+{
+	fprintf(stderr, "usage: %s [-j threads] [-d days] [-n best] name=values...\n", name);
+	fprintf(stderr, "  values is a value, a list 1,2,5 or a range from:to:step\n");
+	fprintf(stderr, "  -j  number of worker threads, default all cores\n");
+	fprintf(stderr, "  -d  simulated days per run, default 7\n");
+	fprintf(stderr, "  -n  number of results to print, default 20, 0 for all\n");
+	fprintf(stderr, "names:");
+	for (size_t i=0; i<sizeof(sweepParameters)/sizeof(sweepParameters[0]); i++)
+		fprintf(stderr, " %s", sweepParameters[i].name);
+	fprintf(stderr, "\n");
+	exit(2);
+}
+
+static const SweepParameter* findParameter(const char* name, size_t length)
+{
+	for (size_t i=0; i<sizeof(sweepParameters)/sizeof(sweepParameters[0]); i++) {
+		if (strlen(sweepParameters[i].name)==length && strncmp(sweepParameters[i].name, name, length)==0)
+			return &sweepParameters[i];
+	}
+	return NULL;
+}
+
+/*
+ * Parses name=values into an axis. Returns false when the argument is not valid.
+ */
+static bool parseAxis(const char* arg, SweepAxis& axis)
+{
+	const char* values = strchr(arg, '=');
+	if (values==NULL || (axis.parameter = findParameter(arg, values-arg))==NULL)
+		return false;
+	values++;
+
+	double from, to, step;
+	if (sscanf(values, "%lf:%lf:%lf", &from, &to, &step)==3) {
+		if (step<=0 || to<from)
+			return false;
+		// count the steps rather than accumulating, so the last value is not lost to rounding
+		long count = lround(floor((to-from)/step+1e-9));
+		for (long i=0; i<=count; i++)
+			axis.values.push_back(from+i*step);
+		return true;
+	}
+	for (const char* p = values; *p; ) {
+		char* end;
+		axis.values.push_back(strtod(p, &end));
+		if (end==p || (*end!=',' && *end!=0))
+			return false;
+		p = *end ? end+1 : end;
+	}
+	return !axis.values.empty();
+}
+
+/*
+ * The combinations are numbered with the first axis varying slowest.
+ */
+static void caseFor(size_t index, SweepCase& sweepCase)
+{
+	sweepCase = defaults;
+	for (size_t a=axes.size(); a-->0; ) {
+		const SweepAxis& axis = axes[a];
+		axis.parameter->set((uint8_t*)&sweepCase+axis.parameter->offset, axis.values[index%axis.values.size()]);
+		index /= axis.values.size();
+	}
+}
+
+static void runCase(size_t index)
+{
+	SweepCase sweepCase;
+	caseFor(index, sweepCase);
+
+	ControlRun run(sweepCase.chamber);
+	run.control.cc = sweepCase.cc;
+	run.control.cs.heatEstimator = sweepCase.heatEstimator;
+	run.control.cs.coolEstimator = sweepCase.coolEstimator;
+	run.start(MODE_BEER_CONSTANT, sweepCase.beerSetting);
+	run.run(duration);
+	results[index].metrics = run.metrics();
+}
+
+static void worker(std::atomic<size_t>* next)
+{
+	size_t index;
+	while ((index = (*next)++)<results.size())
+		runCase(index);
+}
+
+/* The metrics used for ranking. Smaller is better. */
+static double overshootOf(const SweepResult& r) { return r.metrics.overshoot; }
+static double settlingOf(const SweepResult& r) { return r.metrics.settled ? r.metrics.settlingTime : 1e12; }
+static double cyclesOf(const SweepResult& r) { return r.metrics.heatCycles+r.metrics.coolCycles; }
+
+/*
+ * Adds the rank of each result for the metric to its rank sum. Equal values have equal rank.
+ */
+static void addRanks(double (*metric)(const SweepResult&))
+{
+	std::vector<size_t> order(results.size());
+	for (size_t i=0; i<order.size(); i++)
+		order[i] = i;
+	std::stable_sort(order.begin(), order.end(),
+		[metric](size_t a, size_t b) { return metric(results[a])<metric(results[b]); });
+
+	uint32_t rank = 0;
+	for (size_t i=0; i<order.size(); i++) {
+		if (i==0 || metric(results[order[i]])!=metric(results[order[i-1]]))
+			rank = i;
+		results[order[i]].rankSum += rank;
+	}
+}
+
+static void printResults(size_t count)
+{
+	std::vector<size_t> order(results.size());
+	for (size_t i=0; i<order.size(); i++)
+		order[i] = i;
+	std::stable_sort(order.begin(), order.end(),
+		[](size_t a, size_t b) { return results[a].rankSum<results[b].rankSum; });
+
+	printf("rank,rankSum,overshoot,settleHours,settled,heatCycles,coolCycles,absErrorHours,heatHours,coolHours");
+	for (size_t a=0; a<axes.size(); a++)
+		printf(",%s", axes[a].parameter->name);
+	printf("\n");
+
+	if (count==0 || count>order.size())
+		count = order.size();
+	for (size_t i=0; i<count; i++) {
+		size_t index = order[i];
+		const ControlMetrics& m = results[index].metrics;
+		printf("%u,%u,%.3f,%.2f,%d,%u,%u,%.3f,%.2f,%.2f", unsigned(i+1), results[index].rankSum,
+			m.overshoot, m.settlingTime/3600.0, m.settled, m.heatCycles, m.coolCycles,
+			m.absoluteError, m.heatTime/3600.0, m.coolTime/3600.0);
+		for (size_t a=0, rest=index; a<axes.size(); a++) {
+			size_t stride = 1;
+			for (size_t b=a+1; b<axes.size(); b++)
+				stride *= axes[b].values.size();
+			printf(",%g", axes[a].values[(rest/stride)%axes[a].values.size()]);
+		}
+		printf("\n");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned threads = std::thread::hardware_concurrency();
+	double days = 7;
+	size_t count = 20;
+
+	int option;
+	while ((option = getopt(argc, argv, "j:d:n:h"))!=-1) {
+		switch (option) {
+			case 'j': threads = atoi(optarg); break;
+			case 'd': days = atof(optarg); break;
+			case 'n': count = atoi(optarg); break;
+			default: usage(argv[0]);
+		}
+	}
+
+	size_t combinations = 1;
+	for (int i=optind; i<argc; i++) {
+		SweepAxis axis;
+		if (!parseAxis(argv[i], axis)) {
+			fprintf(stderr, "invalid parameter: %s\n", argv[i]);
+			usage(argv[0]);
+		}
+		combinations *= axis.values.size();
+		axes.push_back(axis);
+	}
+	if (threads==0 || days<=0)
+		usage(argv[0]);
+
+	// the defaults are those of a freshly configured controller, controlling the beer to 18C
+	ControlRun reference((ChamberParameters()));
+	defaults.cc = reference.control.cc;
+	defaults.heatEstimator = reference.control.cs.heatEstimator;
+	defaults.coolEstimator = reference.control.cs.coolEstimator;
+	defaults.beerSetting = 18;
+	duration = uint32_t(days*24*3600);
+
+	results.resize(combinations);
+	fprintf(stderr, "running %lu combinations of %.1f days on %u threads\n", (unsigned long)combinations, days, threads);
+
+	unsigned long start = millis();
+	std::atomic<size_t> next(0);
+	std::vector<std::thread> pool;
+	for (unsigned i=0; i<threads; i++)
+		pool.push_back(std::thread(worker, &next));
+	for (size_t i=0; i<pool.size(); i++)
+		pool[i].join();
+	fprintf(stderr, "done in %lu ms\n", millis()-start);
+
+	addRanks(overshootOf);
+	addRanks(settlingOf);
+	addRanks(cyclesOf);
+	printResults(count);
+	return 0;
+}
@@ -8,6 +8,7 @@
 #define strlcpy_P strncpy
 #define sprintf_P sprintf
 #define strcmp_P strcmp
+#define strchr_P strchr
 #define memcpy_P memcpy
 #define vsnprintf_P vsnprintf
 #define PROGMEM
@@ -1,21 +1,24 @@
-#pragma once
-
-// TODO - delegate to either EEPROM. emulation or flashee library
+/*
+ * Copyright 2013 BrewPi/Elco Jacobs.
+ * Copyright 2013 Matthew McGowan.
+ *
+ * This file is part of BrewPi.
+ * 
+ * BrewPi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * BrewPi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with BrewPi.  If not, see <http://www.gnu.org/licenses/>.
+ */
 
-class SparkEepromAccess
-{
-public:
-	static uint8_t readByte(eptr_t offset) {
-		return 0;
-	}
-	static void writeByte(eptr_t offset, uint8_t value) {
-		
-	}
-	
-	static void readBlock(void* target, eptr_t offset, uint16_t size) {
-	}
-	static void writeBlock(eptr_t target, const void* source, uint16_t size) {
-	}	
-};
+#pragma once
 
+#include "SparkEepromAccess.h"
 typedef SparkEepromAccess EepromAccess;
@@ -0,0 +1,39 @@
+/*
+ * Copyright 2013 BrewPi/Elco Jacobs.
+ * Copyright 2013 Matthew McGowan.
+ *
+ * This file is part of BrewPi.
+ * 
+ * BrewPi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * BrewPi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with BrewPi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * A region of flash memory, divided into equal sectors. Addresses are relative to the start of the region.
+ * Erasing a sector sets all its bits to 1, and programming can only clear bits, so a byte is programmed once between
+ * erases. Implementations can be internal or external flash, or a simulated flash for tests.
+ */
+class FlashDevice
+{
+public:
+	virtual uint16_t sectorSize() = 0;
+	virtual uint8_t sectorCount() = 0;
+
+	virtual void read(uint32_t address, void* target, uint16_t size) = 0;
+	virtual void program(uint32_t address, const void* source, uint16_t size) = 0;
+	virtual void eraseSector(uint8_t sector) = 0;
+};
@@ -0,0 +1,201 @@
+/*
+ * Copyright 2013 BrewPi/Elco Jacobs.
+ * Copyright 2013 Matthew McGowan.
+ *
+ * This file is part of BrewPi.
+ * 
+ * BrewPi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * BrewPi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with BrewPi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Brewpi.h"
+#include <stddef.h>
+
+#include "FlashEeprom.h"
+#include "Crc16.h"
+
+#define SECTOR_MAGIC 0x4542			// "BE"
+#define SEQUENCE_UNUSED 0xFFFFFFFF
+
+FlashEeprom::FlashEeprom(FlashDevice& flash) : flash(flash)
+{
+}
+
+void FlashEeprom::init()
+{
+	memset(image, 0xFF, sizeof(image));
+	memset(dirty, 0, sizeof(dirty));
+	memset(pageSector, NO_SECTOR, sizeof(pageSector));
+
+	uint8_t sectors = flash.sectorCount();
+	uint8_t newest = NO_SECTOR;
+	sequence = 0;
+	for (uint8_t s=0; s<sectors; s++) {
+		SectorHeader header;
+		readHeader(s, header);
+		if (header.magic!=SECTOR_MAGIC)		// new flash, or the power failed while the sector was erased
+			eraseSector(s, 1);
+		else if (header.sequence!=SEQUENCE_UNUSED && header.sequence!=~header.sequenceCheck)
+			eraseSector(s, header.eraseCount+1);		// the power failed before the log used the sector
+		else if (header.sequence!=SEQUENCE_UNUSED && (newest==NO_SECTOR || header.sequence>sequence)) {
+			newest = s;
+			sequence = header.sequence;
+		}
+	}
+
+	if (newest==NO_SECTOR) {
+		// start the log in the first sector
+		head = sectors-1;
+		nextSector();
+		return;
+	}
+
+	// the log runs through the sectors in turn, so the oldest sector in use is the first one after the newest
+	for (uint8_t i=1; i<=sectors; i++) {
+		uint8_t s = (newest+i)%sectors;
+		if (isInUse(s))
+			headSlot = readSector(s);
+	}
+	head = newest;
+
+	// the power failed before the sector after the newest was reclaimed
+	uint8_t next = (head+1)%sectors;
+	if (isInUse(next))
+		reclaim(next);
+}
+
+void FlashEeprom::writeBlock(eptr_t target, const void* source, uint16_t size)
+{
+	const uint8_t* data = (const uint8_t*)source;
+	for (uint16_t i=0; i<size; i++) {
+		if (image[target+i]!=data[i]) {
+			image[target+i] = data[i];
+			uint8_t page = (target+i)/PAGE_SIZE;
+			dirty[page>>3] |= 1<<(page&7);
+		}
+	}
+}
+
+void FlashEeprom::flush()
+{
+	for (uint8_t page=0; page<PAGE_COUNT; page++) {
+		if (dirty[page>>3] & (1<<(page&7)))
+			writePage(page);
+	}
+}
+
+bool FlashEeprom::isDirty()
+{
+	for (uint8_t i=0; i<sizeof(dirty); i++) {
+		if (dirty[i])
+			return true;
+	}
+	return false;
+}
+
+uint32_t FlashEeprom::eraseCount(uint8_t sector)
+{
+	SectorHeader header;
+	readHeader(sector, header);
+	return header.magic==SECTOR_MAGIC ? header.eraseCount : 0;
+}
+
+void FlashEeprom::readHeader(uint8_t sector, SectorHeader& header)
+{
+	flash.read(uint32_t(sector)*flash.sectorSize(), &header, sizeof(header));
+}
+
+bool FlashEeprom::isInUse(uint8_t sector)
+{
+	SectorHeader header;
+	readHeader(sector, header);
+	return header.magic==SECTOR_MAGIC && header.sequence!=SEQUENCE_UNUSED;
+}
+
+void FlashEeprom::eraseSector(uint8_t sector, uint32_t eraseCount)
+{
+	flash.eraseSector(sector);
+	uint32_t address = uint32_t(sector)*flash.sectorSize();
+	uint16_t magic = SECTOR_MAGIC;
+	flash.program(address+offsetof(SectorHeader, eraseCount), &eraseCount, sizeof(eraseCount));
+	flash.program(address+offsetof(SectorHeader, magic), &magic, sizeof(magic));
+}
+
+uint16_t FlashEeprom::readSector(uint8_t sector)
+{
+	uint8_t buffer[SLOT_SIZE];
+	uint16_t slots = slotsPerSector();
+	for (uint16_t i=0; i<slots; i++) {
+		flash.read(slotAddress(sector, i), buffer, SLOT_SIZE);
+		bool erased = true;
+		uint16_t crc = 0xFFFF;
+		for (uint8_t j=0; j<SLOT_SIZE; j++) {
+			erased = erased && buffer[j]==0xFF;
+			if (j<SLOT_SIZE-3)
+				crc = crc16Update(crc, buffer[j]);
+		}
+		if (erased)
+			return i;		// slots are written in order, so the rest are free
+		uint8_t page = buffer[0];
+		// a slot that was cut short is ignored, and the previous copy of the page is used
+		if (page<PAGE_COUNT && crc==(buffer[SLOT_SIZE-3] | (buffer[SLOT_SIZE-2]<<8)) && buffer[SLOT_SIZE-1]==0) {
+			memcpy(image+page*PAGE_SIZE, buffer+1, PAGE_SIZE);
+			pageSector[page] = sector;
+		}
+	}
+	return slots;
+}
+
+void FlashEeprom::writePage(uint8_t page)
+{
+	if (headSlot>=slotsPerSector())
+		nextSector();
+
+	uint8_t buffer[SLOT_SIZE];
+	buffer[0] = page;
+	memcpy(buffer+1, image+page*PAGE_SIZE, PAGE_SIZE);
+	uint16_t crc = 0xFFFF;
+	for (uint8_t j=0; j<SLOT_SIZE-3; j++)
+		crc = crc16Update(crc, buffer[j]);
+	buffer[SLOT_SIZE-3] = uint8_t(crc);
+	buffer[SLOT_SIZE-2] = uint8_t(crc>>8);
+	buffer[SLOT_SIZE-1] = 0;
+	flash.program(slotAddress(head, headSlot++), buffer, SLOT_SIZE);
+
+	pageSector[page] = head;
+	dirty[page>>3] &= ~(1<<(page&7));
+}
+
+void FlashEeprom::nextSector()
+{
+	uint8_t sectors = flash.sectorCount();
+	head = (head+1)%sectors;
+	headSlot = 0;
+	sequence++;
+	uint32_t values[2] = { sequence, ~sequence };
+	flash.program(uint32_t(head)*flash.sectorSize()+offsetof(SectorHeader, sequence), values, sizeof(values));
+
+	uint8_t next = (head+1)%sectors;
+	if (isInUse(next))
+		reclaim(next);
+}
+
+void FlashEeprom::reclaim(uint8_t sector)
+{
+	// the current sector was just started, so it has room for every page
+	for (uint8_t page=0; page<PAGE_COUNT; page++) {
+		if (pageSector[page]==sector)
+			writePage(page);
+	}
+	eraseSector(sector, eraseCount(sector)+1);
+}
@@ -0,0 +1,119 @@
+/*
+ * Copyright 2013 BrewPi/Elco Jacobs.
+ * Copyright 2013 Matthew McGowan.
+ *
+ * This file is part of BrewPi.
+ * 
+ * BrewPi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * BrewPi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with BrewPi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "Brewpi.h"
+#include "EepromTypes.h"
+#include "FlashDevice.h"
+
+/**
+ * Emulates an eeprom on flash. The contents are kept in RAM, so reads don't touch the flash, and writes change the
+ * RAM image and mark the pages they touch. flush() writes the changed pages to the flash in one batch.
+ *
+ * The flash is used as a log of page slots. Each slot holds the page number, the page, a CRC and a final zero byte, so
+ * a slot that was cut short by a power loss is ignored and the previous copy of the page is used. The sectors are used in turn: when
+ * the current sector is full, the log moves on to the next one, and the pages whose newest copy is in the sector after
+ * that are copied forward before it is erased. Every sector is erased equally often, and there is always an erased
+ * sector to move on to. The flash needs at least two sectors with room for every page.
+ *
+ * Each sector starts with a header that holds its erase count and, once the log uses it, a sequence number, which
+ * orders the sectors when the log is read back.
+ */
+class FlashEeprom
+{
+public:
+	static const uint16_t EEPROM_SIZE = 1024;
+	static const uint8_t PAGE_SIZE = 32;
+	static const uint8_t PAGE_COUNT = EEPROM_SIZE/PAGE_SIZE;
+
+	FlashEeprom(FlashDevice& flash);
+
+	/**
+	 * Reads the newest copy of each page from the flash. Pages that were never written read as 0xFF.
+	 * A flash without valid sectors is formatted.
+	 */
+	void init();
+
+	uint8_t readByte(eptr_t offset) {
+		return image[offset];
+	}
+	void writeByte(eptr_t offset, uint8_t value) {
+		writeBlock(offset, &value, 1);
+	}
+
+	void readBlock(void* target, eptr_t offset, uint16_t size) {
+		memcpy(target, image+offset, size);
+	}
+	void writeBlock(eptr_t target, const void* source, uint16_t size);
+
+	/**
+	 * Writes the changed pages to the flash.
+	 */
+	void flush();
+
+	/**
+	 * Determines if there are changes that are not written to the flash yet.
+	 */
+	bool isDirty();
+
+	/**
+	 * Number of times the sector was erased, as recorded in its header.
+	 */
+	uint32_t eraseCount(uint8_t sector);
+
+private:
+	struct SectorHeader {
+		uint16_t magic;				// written after the erase count
+		uint16_t reserved;
+		uint32_t eraseCount;
+		uint32_t sequence;			// 0xFFFFFFFF until the log uses the sector
+		uint32_t sequenceCheck;		// ~sequence, so a sequence that was cut short is detected
+	};
+
+	static const uint8_t SLOT_SIZE = 1+PAGE_SIZE+2+1;	// page number, page, CRC and a 0 written last
+	static const uint8_t NO_SECTOR = 0xFF;
+
+	uint16_t slotsPerSector() { return (flash.sectorSize()-sizeof(SectorHeader))/SLOT_SIZE; }
+	uint32_t slotAddress(uint8_t sector, uint16_t slot) {
+		return uint32_t(sector)*flash.sectorSize()+sizeof(SectorHeader)+uint32_t(slot)*SLOT_SIZE;
+	}
+
+	void readHeader(uint8_t sector, SectorHeader& header);
+	bool isInUse(uint8_t sector);
+	/* Erases the sector and writes a header with the next erase count. */
+	void eraseSector(uint8_t sector, uint32_t eraseCount);
+	/* Reads the pages of a sector into the image. Returns the number of slots that are used. */
+	uint16_t readSector(uint8_t sector);
+	/* Writes the page from the image to the next slot, moving on to the next sector when the current one is full. */
+	void writePage(uint8_t page);
+	/* Moves the log to the next sector, and makes room after it. */
+	void nextSector();
+	/* Copies the pages whose newest copy is in the sector to the current sector, and erases it. */
+	void reclaim(uint8_t sector);
+
+	FlashDevice& flash;
+	uint8_t image[EEPROM_SIZE];
+	uint8_t dirty[(PAGE_COUNT+7)/8];		// bit per page that changed since the last flush
+	uint8_t pageSector[PAGE_COUNT];		// sector of the newest copy of each page, NO_SECTOR if there is none
+	uint8_t head;						// the sector the log writes to
+	uint16_t headSlot;					// the next free slot in that sector
+	uint32_t sequence;					// sequence number of that sector
+};
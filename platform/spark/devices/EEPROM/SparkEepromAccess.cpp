@@ -0,0 +1,58 @@
+/*
+ * Copyright 2013 BrewPi/Elco Jacobs.
+ * Copyright 2013 Matthew McGowan.
+ *
+ * This file is part of BrewPi.
+ * 
+ * BrewPi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * BrewPi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with BrewPi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Brewpi.h"
+#include "SparkEepromAccess.h"
+#include "spi_flash.h"
+
+/**
+ * The sectors of the external SPI flash given to the eeprom emulation.
+ */
+class SparkFlashDevice : public FlashDevice
+{
+public:
+	static const uint16_t SECTOR_SIZE = 4096;
+
+	uint16_t sectorSize() { return SECTOR_SIZE; }
+	uint8_t sectorCount() { return SPARK_EEPROM_FLASH_SECTORS; }
+
+	void read(uint32_t address, void* target, uint16_t size) {
+		sFLASH_ReadBuffer((uint8_t*)target, SPARK_EEPROM_FLASH_ADDRESS+address, size);
+	}
+	void program(uint32_t address, const void* source, uint16_t size) {
+		sFLASH_WriteBuffer((uint8_t*)source, SPARK_EEPROM_FLASH_ADDRESS+address, size);
+	}
+	void eraseSector(uint8_t sector) {
+		sFLASH_EraseSector(SPARK_EEPROM_FLASH_ADDRESS+uint32_t(sector)*SECTOR_SIZE);
+	}
+};
+
+static SparkFlashDevice flashDevice;
+static FlashEeprom flashEeprom(flashDevice);
+
+FlashEeprom& SparkEepromAccess::eeprom()
+{
+	static bool initialized = false;
+	if (!initialized) {
+		initialized = true;
+		flashEeprom.init();
+	}
+	return flashEeprom;
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright 2013 BrewPi/Elco Jacobs.
+ * Copyright 2013 Matthew McGowan.
+ *
+ * This file is part of BrewPi.
+ * 
+ * BrewPi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * BrewPi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with BrewPi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "EepromTypes.h"
+#include "FlashEeprom.h"
+
+/* Start of the flash the eeprom is emulated in. The external flash of the Core is free for applications from 0x80000. */
+#ifndef SPARK_EEPROM_FLASH_ADDRESS
+#define SPARK_EEPROM_FLASH_ADDRESS 0x80000
+#endif
+
+/* Number of 4 KB sectors the emulation uses in turn. More sectors spread the erases over more flash. */
+#ifndef SPARK_EEPROM_FLASH_SECTORS
+#define SPARK_EEPROM_FLASH_SECTORS 4
+#endif
+
+/**
+ * Eeprom emulation in the external flash, see FlashEeprom. Writes are kept in RAM until flush(), which the
+ * EepromManager calls periodically and after it stored the settings.
+ */
+class SparkEepromAccess
+{
+public:
+	static uint8_t readByte(eptr_t offset) {
+		return eeprom().readByte(offset);
+	}
+	static void writeByte(eptr_t offset, uint8_t value) {
+		eeprom().writeByte(offset, value);
+	}
+	
+	static void readBlock(void* target, eptr_t offset, uint16_t size) {
+		eeprom().readBlock(target, offset, size);
+	}
+	static void writeBlock(eptr_t target, const void* source, uint16_t size) {
+		eeprom().writeBlock(target, source, size);
+	}
+
+	static void flush() {
+		eeprom().flush();
+	}
+
+private:
+	static FlashEeprom& eeprom();
+};
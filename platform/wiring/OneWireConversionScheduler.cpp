@@ -0,0 +1,148 @@
+/*
+ * Copyright 2013 BrewPi/Elco Jacobs.
+ * Copyright 2013 Matthew McGowan
+ *
+ * This file is part of BrewPi.
+ *
+ * BrewPi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * BrewPi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with BrewPi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Brewpi.h"
+#include "OneWireConversionScheduler.h"
+#include "OneWireTempSensor.h"
+#include "DallasTemperature.h"
+#include "OneWire.h"
+#include "Ticks.h"
+
+OneWireConversionScheduler::BusSlot OneWireConversionScheduler::slots[ONEWIRE_CONVERSION_MAX_BUSES];
+
+OneWireConversionScheduler::BusSlot* OneWireConversionScheduler::findSlot(OneWire* bus)
+{
+	for (uint8_t i=0; i<ONEWIRE_CONVERSION_MAX_BUSES; i++) {
+		if (slots[i].bus==bus)
+			return &slots[i];
+	}
+	return NULL;
+}
+
+bool OneWireConversionScheduler::registerSensor(OneWireTempSensor* sensor)
+{
+	if (sensor->scheduled)
+		return true;
+	if (sensor->oneWire==NULL)
+		return false;
+
+	BusSlot* slot = findSlot(sensor->oneWire);
+	if (slot==NULL) {
+		slot = findSlot(NULL);		// claim a free slot
+		if (slot==NULL)
+			return false;
+		slot->bus = sensor->oneWire;
+		slot->sensors = NULL;
+		slot->converting = false;
+		slot->fetched = false;
+	}
+	sensor->nextOnBus = slot->sensors;
+	slot->sensors = sensor;
+	sensor->scheduled = true;
+	return true;
+}
+
+void OneWireConversionScheduler::unregisterSensor(OneWireTempSensor* sensor)
+{
+	if (!sensor->scheduled)
+		return;
+
+	BusSlot* slot = findSlot(sensor->oneWire);
+	if (slot==NULL)
+		return;
+
+	for (OneWireTempSensor** link = &slot->sensors; *link!=NULL; link = &(*link)->nextOnBus) {
+		if (*link==sensor) {
+			*link = sensor->nextOnBus;
+			break;
+		}
+	}
+	sensor->nextOnBus = NULL;
+	sensor->scheduled = false;
+	if (slot->sensors==NULL)
+		slot->bus = NULL;		// release the slot, a pending conversion is simply abandoned
+}
+
+void OneWireConversionScheduler::update(OneWire* bus)
+{
+	BusSlot* slot = findSlot(bus);
+	if (slot==NULL || slot->bus==NULL)
+		return;
+
+	if (slot->converting) {
+		if (ticks.millis()-slot->conversionStart < ONEWIRE_CONVERSION_TIME)
+			return;		// results not ready yet, sensors keep returning the previous reading
+		fetchAll(slot);
+	}
+	startConversion(slot);
+}
+
+void OneWireConversionScheduler::startConversion(BusSlot* slot)
+{
+	// Skip ROM addresses every device on the bus. Devices that are not temp sensors ignore Convert T.
+	OneWire* bus = slot->bus;
+	bus->reset();
+	bus->skip();
+	bus->write(STARTCONVO);
+	slot->conversionStart = ticks.millis();
+	slot->converting = true;
+}
+
+void OneWireConversionScheduler::fetchAll(BusSlot* slot)
+{
+	for (OneWireTempSensor* s = slot->sensors; s!=NULL; s = s->nextOnBus) {
+		// disconnected sensors are re-initialized by their owner, which reads the sensor directly.
+		if (s->connected)
+			s->cachedTemp = s->readAndConstrainTemp();
+	}
+	slot->converting = false;
+	slot->fetched = true;
+	slot->fetchTime = ticks.millis();
+}
+
+uint16_t OneWireConversionScheduler::valueAge(OneWire* bus)
+{
+	BusSlot* slot = bus ? findSlot(bus) : NULL;		// findSlot(NULL) finds a free slot
+	if (slot==NULL || !slot->fetched)
+		return ONEWIRE_VALUE_AGE_UNKNOWN;
+	ticks_millis_t age = ticks.millis()-slot->fetchTime;
+	return age<ONEWIRE_VALUE_AGE_UNKNOWN ? uint16_t(age) : ONEWIRE_VALUE_AGE_UNKNOWN-1;
+}
+
+ticks_millis_t OneWireConversionScheduler::convertForScan(OneWire* bus)
+{
+	BusSlot* slot = findSlot(bus);
+	if (slot!=NULL) {
+		update(bus);		// reads a conversion that has completed
+		if (!slot->fetched) {
+			// the first conversion of the cycle is still running
+			ticks_millis_t elapsed = ticks.millis()-slot->conversionStart;
+			if (elapsed<ONEWIRE_CONVERSION_TIME)
+				wait.millis(ONEWIRE_CONVERSION_TIME-elapsed);
+			update(bus);
+		}
+		return slot->fetchTime;
+	}
+	bus->reset();
+	bus->skip();
+	bus->write(STARTCONVO);
+	wait.millis(ONEWIRE_CONVERSION_TIME);
+	return ticks.millis();
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright 2013 BrewPi/Elco Jacobs.
+ * Copyright 2013 Matthew McGowan
+ *
+ * This file is part of BrewPi.
+ *
+ * BrewPi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * BrewPi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with BrewPi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "Brewpi.h"
+#include "Ticks.h"
+
+class OneWire;
+class OneWireTempSensor;
+
+/*
+ * The number of onewire buses that can have a shared conversion cycle.
+ * Sensors on buses beyond this limit fall back to converting one sensor at a time.
+ */
+#ifndef ONEWIRE_CONVERSION_MAX_BUSES
+#define ONEWIRE_CONVERSION_MAX_BUSES 2
+#endif
+
+/* Time in milliseconds a DS18B20 needs to complete a 12-bit conversion. */
+#define ONEWIRE_CONVERSION_TIME 750
+
+/* Returned by valueAge() when the bus has no values read by the scheduler. */
+#define ONEWIRE_VALUE_AGE_UNKNOWN 0xFFFF
+
+/**
+ * Schedules temperature conversions for all temp sensors on a onewire bus together.
+ * Rather than addressing each sensor in turn, a single Skip-ROM Convert T is broadcast to the bus, so all sensors
+ * convert in parallel. Once the conversion time has elapsed, the scratchpads of all registered sensors are read in one pass
+ * and the result cached in each sensor. Sensors then read from the cache, and the next conversion is started.
+ * The cost per update is one reset/broadcast plus one scratchpad read per sensor, independent of when each sensor is read.
+ */
+class OneWireConversionScheduler {
+public:
+	/**
+	 * Adds the sensor to the conversion cycle of its bus. Registering a sensor that is already registered has no effect.
+	 * /return false if there is no free bus slot. The sensor should then request its own conversions.
+	 */
+	static bool registerSensor(OneWireTempSensor* sensor);
+
+	/**
+	 * Removes the sensor from the conversion cycle. When the last sensor on a bus is removed, the bus slot is released.
+	 */
+	static void unregisterSensor(OneWireTempSensor* sensor);
+
+	/**
+	 * Advances the conversion cycle for the bus. If a conversion has completed, all sensors on the bus are read
+	 * and a new conversion is started. This is cheap to call for every sensor read - only the first call after the
+	 * conversion window has elapsed accesses the bus.
+	 */
+	static void update(OneWire* bus);
+
+	/**
+	 * Milliseconds since the values of the sensors on the bus were read, at most ONEWIRE_VALUE_AGE_UNKNOWN-1.
+	 * ONEWIRE_VALUE_AGE_UNKNOWN when the bus is not in a conversion cycle, or the first conversion has not completed.
+	 */
+	static uint16_t valueAge(OneWire* bus);
+
+	/**
+	 * Makes sure the scratchpads of all temp sensors on the bus hold a completed conversion, so sensors that are not
+	 * registered, such as the probes in a hardware scan, can be read straight away. A bus in a conversion cycle
+	 * normally has one already, since the conversion is broadcast to all devices on the bus. Otherwise a single conversion
+	 * is broadcast and waited for.
+	 * /return the time at which the values were converted
+	 */
+	static ticks_millis_t convertForScan(OneWire* bus);
+
+private:
+	struct BusSlot {
+		OneWire* bus;
+		OneWireTempSensor* sensors;		// linked through OneWireTempSensor::nextOnBus
+		ticks_millis_t conversionStart;
+		ticks_millis_t fetchTime;		// when the values of the last conversion were read
+		bool converting;
+		bool fetched;					// false until the first conversion has been read
+	};
+
+	static BusSlot* findSlot(OneWire* bus);
+	static void startConversion(BusSlot* slot);
+	static void fetchAll(BusSlot* slot);
+
+	static BusSlot slots[ONEWIRE_CONVERSION_MAX_BUSES];
+};
@@ -0,0 +1,48 @@
+/*
+ * Copyright 2013 BrewPi/Elco Jacobs.
+ * Copyright 2013 Matthew McGowan.
+ *
+ * This file is part of BrewPi.
+ * 
+ * BrewPi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * BrewPi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with BrewPi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "Brewpi.h"
+#include "Ticks.h"
+
+/* Delay in milliseconds before the first reconnect attempt of a disconnected sensor. */
+#ifndef ONEWIRE_RECONNECT_DELAY
+#define ONEWIRE_RECONNECT_DELAY 1000
+#endif
+
+/* Maximum number of times the reconnect delay is doubled. 5 gives at most 32 seconds between attempts. */
+#ifndef ONEWIRE_RECONNECT_MAX_BACKOFF
+#define ONEWIRE_RECONNECT_MAX_BACKOFF 5
+#endif
+
+/**
+ * The time to wait before the next reconnect attempt of a disconnected sensor, after the given number of consecutive
+ * failed attempts. The first wait is ONEWIRE_RECONNECT_DELAY, and each further failure doubles it, up to
+ * ONEWIRE_RECONNECT_MAX_BACKOFF times.
+ */
+inline ticks_millis_t oneWireReconnectDelay(uint8_t failures)
+{
+	if (failures==0)
+		return 0;
+	if (failures>ONEWIRE_RECONNECT_MAX_BACKOFF+1)
+		failures = ONEWIRE_RECONNECT_MAX_BACKOFF+1;
+	return ticks_millis_t(ONEWIRE_RECONNECT_DELAY) << (failures-1);
+}
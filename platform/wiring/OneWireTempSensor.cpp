@@ -20,6 +20,7 @@
 
 #include "Brewpi.h"
 #include "OneWireTempSensor.h"
+#include "OneWireConversionScheduler.h"
 #include "DallasTemperature.h"
 #include "OneWire.h"
 #include "OneWireDevices.h"
@@ -28,6 +29,7 @@
 #include "TemperatureFormats.h"
 
 OneWireTempSensor::~OneWireTempSensor(){
+	OneWireConversionScheduler::unregisterSensor(this);
 	delete sensor;
 };
 
@@ -36,41 +38,104 @@ OneWireTempSensor::~OneWireTempSensor(){
  * This method is called when the sensor is first created and also any time the sensor reports it's disconnected.
  * If the result is TEMP_SENSOR_DISCONNECTED then subsequent calls to read() will also return TEMP_SENSOR_DISCONNECTED.
  * Clients should attempt to re-initialize the sensor by calling init() again. 
+ * The first initialization waits for the conversion to complete, so the sensor has a value straight away.
+ * Re-initializing a disconnected sensor does not block: see reconnect().
  */
 bool OneWireTempSensor::init(){
 
-	// save address and pinNr for log messages
-	char addressString[17];
-	printBytes(sensorAddress, 8, addressString);
-	#if BREWPI_DEBUG
-	uint8_t pinNr = oneWire->pinNr();
-	#endif
+	if (!connected)
+		return reconnect();
 
 	bool success = false;
 
-	if (sensor==NULL) {
-		sensor = new DallasTemperature(oneWire);
-		if (sensor==NULL) {
-			logErrorString(ERROR_SRAM_SENSOR, addressString);
-		}
-	}
+	if (!createDriver())
+		return false;
 	
 	logDebug("init onewire sensor");
 	// This quickly tests if the sensor is connected and initializes the reset detection.
 	// During the main TempControl loop, we don't want to spend many seconds
 	// scanning each sensor since this brings things to a halt.
-	if (sensor && sensor->initConnection(sensorAddress) && requestConversion()) {
+	if (sensor->initConnection(sensorAddress) && requestConversion()) {
 		logDebug("init onewire sensor - wait for conversion");
 		waitForConversion();
-		temperature temp = readAndConstrainTemp();
-		DEBUG_ONLY(logInfoIntStringTemp(INFO_TEMP_SENSOR_INITIALIZED, pinNr, addressString, temp));
-		success = temp!=DEVICE_DISCONNECTED && requestConversion();
+		success = completeInit(readAndConstrainTemp());
 	}	
 	setConnected(success);
+	if (!success)
+		scheduleReconnect(ticks.millis());
 	logDebug("init onewire sensor complete %d", success);
 	return success;
 }
 
+/**
+ * Steps the reconnect state machine of a disconnected sensor. Each call either does nothing (waiting for the
+ * backoff delay or the conversion to complete), starts a conversion, or reads the converted value.
+ * The delay between attempts doubles after each failed attempt, up to ONEWIRE_RECONNECT_MAX_BACKOFF.
+ * /return true when the sensor is connected again.
+ */
+bool OneWireTempSensor::reconnect()
+{
+	ticks_millis_t now = ticks.millis();
+	if (reconnectConverting) {
+		if (now-reconnectTime < ONEWIRE_CONVERSION_TIME)
+			return false;
+		reconnectConverting = false;
+		if (completeInit(readAndConstrainTemp())) {
+			reconnectBackoff = 0;
+			setConnected(true);
+			return true;
+		}
+	}
+	else {
+		if (now-reconnectTime < oneWireReconnectDelay(reconnectBackoff))
+			return false;
+		// requestTemperaturesByAddress() is used directly: the sensor only counts as connected once a value has been read.
+		if (createDriver() && sensor->initConnection(sensorAddress) && sensor->requestTemperaturesByAddress(sensorAddress)) {
+			reconnectConverting = true;
+			reconnectTime = now;
+			return false;
+		}
+	}
+	scheduleReconnect(now);
+	return false;
+}
+
+void OneWireTempSensor::scheduleReconnect(ticks_millis_t now)
+{
+	reconnectTime = now;
+	if (reconnectBackoff<=ONEWIRE_RECONNECT_MAX_BACKOFF)
+		reconnectBackoff++;
+}
+
+bool OneWireTempSensor::createDriver()
+{
+	if (sensor==NULL) {
+		sensor = new DallasTemperature(oneWire);
+		if (sensor==NULL) {
+			char addressString[17];
+			printBytes(sensorAddress, 8, addressString);
+			logErrorString(ERROR_SRAM_SENSOR, addressString);
+		}
+	}
+	return sensor!=NULL;
+}
+
+/**
+ * Stores the first value read after (re)initialization and starts the next conversion.
+ * /return true if the value is valid and the next conversion was started.
+ */
+bool OneWireTempSensor::completeInit(temperature temp)
+{
+	#if BREWPI_DEBUG
+	char addressString[17];
+	printBytes(sensorAddress, 8, addressString);
+	logInfoIntStringTemp(INFO_TEMP_SENSOR_INITIALIZED, oneWire->pinNr(), addressString, temp);
+	#endif
+	cachedTemp = temp;
+	// join the shared conversion cycle of the bus, or convert individually when the bus can't be scheduled
+	return temp!=DEVICE_DISCONNECTED && (OneWireConversionScheduler::registerSensor(this) || requestConversion());
+}
+
 bool OneWireTempSensor::requestConversion()
 {	
 	bool ok = sensor->requestTemperaturesByAddress(sensorAddress);
@@ -98,6 +163,12 @@ temperature OneWireTempSensor::read(){
 	if (!connected)
 		return TEMP_SENSOR_DISCONNECTED;
 	
+	if (scheduled) {
+		// reads the whole bus when a conversion has completed, otherwise leaves the cached value as is
+		OneWireConversionScheduler::update(oneWire);
+		return connected ? cachedTemp : TEMP_SENSOR_DISCONNECTED;
+	}
+
 	temperature temp = readAndConstrainTemp();
 	requestConversion();
 	return temp;
@@ -110,8 +181,11 @@ temperature OneWireTempSensor::readAndConstrainTemp()
 		setConnected(false);
 		return TEMP_SENSOR_DISCONNECTED;
 	}
-	
+	return rawToTemp(temp, calibrationOffset);
+}
+
+temperature OneWireTempSensor::rawToTemp(temperature raw, fixed4_4 calibrationOffset)
+{
 	const uint8_t shift = TEMP_FIXED_POINT_BITS-ONEWIRE_TEMP_SENSOR_PRECISION; // difference in precision between DS18B20 format and temperature adt
-	temp = constrainTemp(temp+calibrationOffset+(C_OFFSET>>shift), ((int) MIN_TEMP)>>shift, ((int) MAX_TEMP)>>shift)<<shift;
-	return temp;
+	return constrainTemp(raw+calibrationOffset+(C_OFFSET>>shift), ((int) MIN_TEMP)>>shift, ((int) MAX_TEMP)>>shift)<<shift;
 }
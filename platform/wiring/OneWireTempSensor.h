@@ -24,6 +24,8 @@
 #include "TempSensor.h"
 #include "DallasTemperature.h"
 #include "Ticks.h"
+#include "OneWireConversionScheduler.h"
+#include "OneWireReconnect.h"
 
 class DallasTemperature;
 class OneWire;
@@ -40,10 +42,12 @@ public:
 	 * /param calibration	A temperature value that is added to all readings. This can be used to calibrate the sensor.	 
 	 */
 	OneWireTempSensor(OneWire* bus, DeviceAddress address, fixed4_4 calibrationOffset)
-	: oneWire(bus), sensor(NULL) {		
+	: oneWire(bus), sensor(NULL), nextOnBus(NULL), scheduled(false), 
+	  reconnectTime(0), reconnectBackoff(0), reconnectConverting(false) {		
 		connected = true;  // assume connected. Transition from connected to disconnected prints a message.
 		memcpy(sensorAddress, address, sizeof(DeviceAddress));
 		this->calibrationOffset = calibrationOffset;
+		cachedTemp = TEMP_SENSOR_DISCONNECTED;
 	};
 	
 	~OneWireTempSensor();
@@ -54,11 +58,21 @@ public:
 	
 	bool init();
 	temperature read();
+
+	/**
+	 * Converts a raw DS18B20 reading to a temperature, with the calibration offset added and constrained to the range
+	 * of the temperature type.
+	 */
+	static temperature rawToTemp(temperature raw, fixed4_4 calibrationOffset);
 	
 	private:
 
 	void setConnected(bool connected);
 	bool requestConversion();
+	bool reconnect();
+	void scheduleReconnect(ticks_millis_t now);
+	bool createDriver();
+	bool completeInit(temperature temp);
 	void waitForConversion()
 	{
 		wait.millis(750);
@@ -77,5 +91,18 @@ public:
 
 	fixed4_4 calibrationOffset;		
 	bool connected;
-	
+
+	/**
+	 * Most recent reading, fetched by the conversion scheduler for this sensor's bus.
+	 */
+	temperature cachedTemp;
+	OneWireTempSensor* nextOnBus;	// next sensor sharing the bus conversion cycle
+	bool scheduled;					// true when conversions are done by OneWireConversionScheduler
+
+	// reconnect state for a disconnected sensor
+	ticks_millis_t reconnectTime;	// time of the last attempt, or start of the pending conversion
+	uint8_t reconnectBackoff;		// number of failed attempts, the delay between attempts is oneWireReconnectDelay(reconnectBackoff)
+	bool reconnectConverting;		// a conversion was requested, the value can be read after ONEWIRE_CONVERSION_TIME
+
+	friend class OneWireConversionScheduler;
 };
@@ -0,0 +1,92 @@
+/*
+ * Copyright 2013 BrewPi/Elco Jacobs.
+ * Copyright 2013 Matthew McGowan.
+ *
+ * This file is part of BrewPi.
+ * 
+ * BrewPi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * BrewPi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with BrewPi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gtest/gtest.h"
+#include <stdlib.h>
+#include <stddef.h>
+
+#include "EepromManager.h"
+#include "EepromFormat.h"
+
+#if BREWPI_DEVICE_CACHE
+
+class DeviceCacheTest : public ::testing::Test {
+protected:
+	static void SetUpTestCase() {
+		setenv("BREWPI_EEPROM", "/dev/null", 1);	// keep the eeprom in memory
+	}
+
+	virtual void SetUp() {
+		eepromAccess.writeByte(offsetof(EepromFormat, version), EEPROM_FORMAT_VERSION);
+		loadDevices();
+		DeviceConfig none;
+		clear((uint8_t*)&none, sizeof(none));
+		for (uint8_t slot=0; slot<EepromFormat::MAX_DEVICES; slot++)
+			EepromManager::storeDevice(none, slot);
+	}
+
+	static void loadDevices() { EepromManager::loadDevices(); }
+
+	static DeviceConfig device(DeviceHardware hardware, uint8_t pin, uint8_t address) {
+		DeviceConfig config;
+		clear((uint8_t*)&config, sizeof(config));
+		config.deviceHardware = hardware;
+		config.deviceFunction = DEVICE_CHAMBER_TEMP;
+		config.hw.pinNr = pin;
+		config.hw.address[0] = address;
+		config.hw.address[7] = address;
+		return config;
+	}
+};
+
+TEST_F(DeviceCacheTest, storedDeviceIsFetchedAndFound){
+	DeviceConfig sensor = device(DEVICE_HARDWARE_ONEWIRE_TEMP, 10, 0x28);
+	ASSERT_TRUE(EepromManager::storeDevice(sensor, 3));
+
+	DeviceConfig fetched;
+	ASSERT_TRUE(EepromManager::fetchDevice(fetched, 3));
+	ASSERT_EQ(0, memcmp(&sensor, &fetched, sizeof(sensor)));
+	ASSERT_EQ(3, EepromManager::findDevice(sensor));
+	ASSERT_EQ(INVALID_SLOT, EepromManager::findDevice(device(DEVICE_HARDWARE_ONEWIRE_TEMP, 10, 0x29))) << "other address";
+	ASSERT_EQ(INVALID_SLOT, EepromManager::findDevice(device(DEVICE_HARDWARE_ONEWIRE_TEMP, 11, 0x28))) << "other pin";
+	ASSERT_EQ(INVALID_SLOT, EepromManager::findDevice(device(DEVICE_HARDWARE_PIN, 10, 0)));
+}
+
+TEST_F(DeviceCacheTest, firstMatchingSlotIsFound){
+	EepromManager::storeDevice(device(DEVICE_HARDWARE_ONEWIRE_TEMP, 10, 0x28), 5);
+	EepromManager::storeDevice(device(DEVICE_HARDWARE_ONEWIRE_TEMP, 10, 0x28), 7);
+	EepromManager::storeDevice(device(DEVICE_HARDWARE_ONEWIRE_TEMP, 10, 0), 6);
+	ASSERT_EQ(5, EepromManager::findDevice(device(DEVICE_HARDWARE_ONEWIRE_TEMP, 10, 0x28)));
+	ASSERT_EQ(6, EepromManager::findDevice(device(DEVICE_HARDWARE_ONEWIRE_TEMP, 10, 0x30))) << "a device without address matches any address";
+
+	EepromManager::storeDevice(device(DEVICE_HARDWARE_ONEWIRE_TEMP, 10, 0), 2);
+	ASSERT_EQ(2, EepromManager::findDevice(device(DEVICE_HARDWARE_ONEWIRE_TEMP, 10, 0x28)));
+}
+
+TEST_F(DeviceCacheTest, noDevicesWithoutSettings){
+	eepromAccess.writeByte(offsetof(EepromFormat, version), 0xFF);
+	loadDevices();
+	DeviceConfig config;
+	ASSERT_FALSE(EepromManager::fetchDevice(config, 0));
+	ASSERT_FALSE(EepromManager::storeDevice(device(DEVICE_HARDWARE_PIN, 10, 0), 0));
+	ASSERT_EQ(INVALID_SLOT, EepromManager::findDevice(device(DEVICE_HARDWARE_NONE, 0, 0)));
+}
+
+#endif
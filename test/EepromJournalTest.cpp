@@ -0,0 +1,138 @@
+/*
+ * Copyright 2013 BrewPi/Elco Jacobs.
+ * Copyright 2013 Matthew McGowan.
+ *
+ * This file is part of BrewPi.
+ * 
+ * BrewPi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * BrewPi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with BrewPi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gtest/gtest.h"
+#include <stdlib.h>
+#include <stddef.h>
+
+#include "EepromJournal.h"
+#include "EepromFormat.h"
+
+#if BREWPI_EEPROM_JOURNAL
+
+class EepromJournalTest : public ::testing::Test {
+protected:
+	static void SetUpTestCase() {
+		setenv("BREWPI_EEPROM", "/dev/null", 1);	// keep the eeprom in memory
+	}
+
+	virtual void SetUp() {
+		for (eptr_t offset=0; offset<JOURNAL_SIZE; offset++)
+			eepromAccess.writeByte(JOURNAL_START+offset, 0);
+		init();
+	}
+
+	static const eptr_t JOURNAL_START = offsetof(EepromFormat, journal);
+	static const uint16_t JOURNAL_SIZE = sizeof(((EepromFormat*)0)->journal);
+
+	void init() { EepromJournal::init(JOURNAL_START, JOURNAL_SIZE); }
+
+	eptr_t head() { return EepromJournal::head; }
+	eptr_t newest(uint8_t type) { return EepromJournal::newest[type-1]; }
+};
+
+TEST_F(EepromJournalTest, newestRecordIsFoundAfterRestart){
+	ControlSettings cs = { 'b', 1, 2, 3, 4 };
+	EepromJournal::store(JOURNAL_RECORD_SETTINGS, &cs, sizeof(cs));
+	cs.beerSetting = 5;
+	EepromJournal::store(JOURNAL_RECORD_SETTINGS, &cs, sizeof(cs));
+
+	init();
+	ControlSettings fetched;
+	ASSERT_TRUE(EepromJournal::fetch(JOURNAL_RECORD_SETTINGS, &fetched, sizeof(fetched)));
+	ASSERT_EQ(0, memcmp(&cs, &fetched, sizeof(cs)));
+	ASSERT_FALSE(EepromJournal::fetch(JOURNAL_RECORD_CONSTANTS, &fetched, sizeof(fetched))) << "no constants were stored";
+}
+
+TEST_F(EepromJournalTest, unchangedDataIsNotWritten){
+	ControlSettings cs = { 'b', 1, 2, 3, 4 };
+	EepromJournal::store(JOURNAL_RECORD_SETTINGS, &cs, sizeof(cs));
+	eptr_t after = head();
+	EepromJournal::store(JOURNAL_RECORD_SETTINGS, &cs, sizeof(cs));
+	ASSERT_EQ(after, head());
+}
+
+TEST_F(EepromJournalTest, incompleteRecordIsIgnored){
+	ControlSettings cs = { 'b', 1, 2, 3, 4 };
+	EepromJournal::store(JOURNAL_RECORD_SETTINGS, &cs, sizeof(cs));
+	ControlSettings next = cs;
+	next.beerSetting = 5;
+	EepromJournal::store(JOURNAL_RECORD_SETTINGS, &next, sizeof(next));
+	eptr_t crc = head()-1;
+	eepromAccess.writeByte(crc, ~eepromAccess.readByte(crc));	// power lost before the crc was written
+
+	init();
+	ControlSettings fetched;
+	ASSERT_TRUE(EepromJournal::fetch(JOURNAL_RECORD_SETTINGS, &fetched, sizeof(fetched)));
+	ASSERT_EQ(0, memcmp(&cs, &fetched, sizeof(cs))) << "the previous record is used";
+}
+
+TEST_F(EepromJournalTest, otherTypesAreKeptWhenSwitchingBank){
+	ControlConstants cc;
+	memset(&cc, 0x5A, sizeof(cc));
+	EepromJournal::store(JOURNAL_RECORD_CONSTANTS, &cc, sizeof(cc));
+	eptr_t constants = newest(JOURNAL_RECORD_CONSTANTS);
+
+	ControlSettings cs = { 'b', 1, 2, 3, 4 };
+	for (uint8_t i=0; i<50 && newest(JOURNAL_RECORD_CONSTANTS)==constants; i++) {
+		cs.beerSetting++;
+		EepromJournal::store(JOURNAL_RECORD_SETTINGS, &cs, sizeof(cs));
+	}
+	ASSERT_GT(newest(JOURNAL_RECORD_CONSTANTS), constants) << "constants were copied to the other bank";
+
+	init();
+	ControlConstants fetchedConstants;
+	ControlSettings fetchedSettings;
+	ASSERT_TRUE(EepromJournal::fetch(JOURNAL_RECORD_CONSTANTS, &fetchedConstants, sizeof(fetchedConstants)));
+	ASSERT_EQ(0, memcmp(&cc, &fetchedConstants, sizeof(cc)));
+	ASSERT_TRUE(EepromJournal::fetch(JOURNAL_RECORD_SETTINGS, &fetchedSettings, sizeof(fetchedSettings)));
+	ASSERT_EQ(0, memcmp(&cs, &fetchedSettings, sizeof(cs)));
+}
+
+TEST_F(EepromJournalTest, recordsThatExactlyFillABankAreCopiedOnTheNextStore){
+	const uint16_t overhead = 8;	// header and CRC
+	ControlConstants cc;
+	memset(&cc, 0x5A, sizeof(cc));
+	ControlSettings cs = { 'b', 1, 2, 3, 4 };
+	const uint16_t bank = sizeof(cc)+overhead+2*(sizeof(cs)+overhead);
+	EepromJournal::init(JOURNAL_START, 2*bank);
+
+	EepromJournal::store(JOURNAL_RECORD_CONSTANTS, &cc, sizeof(cc));
+	EepromJournal::store(JOURNAL_RECORD_SETTINGS, &cs, sizeof(cs));
+	cs.beerSetting++;
+	EepromJournal::store(JOURNAL_RECORD_SETTINGS, &cs, sizeof(cs));
+	ASSERT_EQ(JOURNAL_START+bank, head()) << "the first bank is full";
+	cs.beerSetting++;
+	EepromJournal::store(JOURNAL_RECORD_SETTINGS, &cs, sizeof(cs));
+	ASSERT_EQ(JOURNAL_START+bank, newest(JOURNAL_RECORD_CONSTANTS)) << "constants were copied to the other bank";
+
+	// the first bank is overwritten when the journal switches back, the second must hold everything
+	for (eptr_t offset=0; offset<bank; offset++)
+		eepromAccess.writeByte(JOURNAL_START+offset, 0);
+	EepromJournal::init(JOURNAL_START, 2*bank);
+	ControlConstants fetchedConstants;
+	ControlSettings fetchedSettings;
+	ASSERT_TRUE(EepromJournal::fetch(JOURNAL_RECORD_CONSTANTS, &fetchedConstants, sizeof(fetchedConstants)));
+	ASSERT_EQ(0, memcmp(&cc, &fetchedConstants, sizeof(cc)));
+	ASSERT_TRUE(EepromJournal::fetch(JOURNAL_RECORD_SETTINGS, &fetchedSettings, sizeof(fetchedSettings)));
+	ASSERT_EQ(0, memcmp(&cs, &fetchedSettings, sizeof(cs)));
+}
+
+#endif
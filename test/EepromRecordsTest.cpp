@@ -0,0 +1,152 @@
+/*
+ * Copyright 2013 BrewPi/Elco Jacobs.
+ * Copyright 2013 Matthew McGowan.
+ *
+ * This file is part of BrewPi.
+ * 
+ * BrewPi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * BrewPi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with BrewPi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gtest/gtest.h"
+#include <stdlib.h>
+#include <stddef.h>
+
+#include "EepromRecords.h"
+#include "EepromManager.h"
+#include "EepromFormat.h"
+
+#if BREWPI_EEPROM_TLV
+
+class EepromRecordsTest : public ::testing::Test {
+protected:
+	static void SetUpTestCase() {
+		setenv("BREWPI_EEPROM", "/dev/null", 1);	// keep the eeprom in memory
+	}
+
+	virtual void SetUp() {
+		memset(devices, 0, sizeof(devices));
+	}
+
+	static DeviceConfig device(DeviceHardware hardware, uint8_t pin) {
+		DeviceConfig config;
+		clear((uint8_t*)&config, sizeof(config));
+		config.deviceHardware = hardware;
+		config.deviceFunction = hardware==DEVICE_HARDWARE_PIN ? DEVICE_CHAMBER_HEAT : DEVICE_CHAMBER_TEMP;
+		config.chamber = 1;
+		config.hw.pinNr = pin;
+		config.hw.invert = pin & 1;
+		if (hardware!=DEVICE_HARDWARE_PIN) {
+			memset(config.hw.address, pin, sizeof(DeviceAddress));
+			config.hw.calibration = -pin;
+		}
+		return config;
+	}
+
+	static bool same(const DeviceConfig& a, const DeviceConfig& b) {
+		return memcmp(&a, &b, sizeof(DeviceConfig))==0;
+	}
+
+	DeviceConfig devices[MAX_DEVICE_SLOT];
+};
+
+TEST_F(EepromRecordsTest, devicesAreLoadedInTheirSlots){
+	for (uint8_t slot=0; slot<MAX_DEVICE_SLOT; slot+=2)
+		devices[slot] = device(slot%4 ? DEVICE_HARDWARE_PIN : DEVICE_HARDWARE_ONEWIRE_TEMP, slot);
+	ASSERT_TRUE(EepromRecords::storeDevices(devices, MAX_DEVICE_SLOT));
+
+	DeviceConfig loaded[MAX_DEVICE_SLOT];
+	ASSERT_TRUE(EepromRecords::loadDevices(loaded, MAX_DEVICE_SLOT));
+	ASSERT_EQ(0, memcmp(devices, loaded, sizeof(devices)));
+}
+
+TEST_F(EepromRecordsTest, devicesThatDontFitAreNotStored){
+	uint8_t slot = 0;
+	for (;;) {
+		devices[slot] = device(DEVICE_HARDWARE_ONEWIRE_TEMP, slot);
+		if (EepromRecords::devicesSize(devices, slot+1)>EepromRecords::capacity())
+			break;
+		slot++;
+	}
+	ASSERT_GT(slot, 30) << "more onewire devices fit than in format 4";
+	ASSERT_TRUE(EepromRecords::storeDevices(devices, slot));
+	ASSERT_FALSE(EepromRecords::storeDevices(devices, slot+1));
+
+	DeviceConfig loaded[MAX_DEVICE_SLOT];
+	ASSERT_TRUE(EepromRecords::loadDevices(loaded, MAX_DEVICE_SLOT));
+	ASSERT_EQ(0, memcmp(devices, loaded, slot*sizeof(DeviceConfig))) << "the stored devices are intact";
+}
+
+TEST_F(EepromRecordsTest, devicesBeforeADamagedRecordAreLoaded){
+	devices[0] = device(DEVICE_HARDWARE_PIN, 1);
+	devices[1] = device(DEVICE_HARDWARE_PIN, 2);
+	devices[2] = device(DEVICE_HARDWARE_PIN, 4);
+	ASSERT_TRUE(EepromRecords::storeDevices(devices, 3));
+	eptr_t pin = offsetof(EepromFormat, records)+EepromRecords::deviceSize(devices[0])+7;
+	eepromAccess.writeByte(pin, 3);		// power lost while the record of slot 1 was rewritten
+
+	DeviceConfig loaded[MAX_DEVICE_SLOT];
+	ASSERT_FALSE(EepromRecords::loadDevices(loaded, MAX_DEVICE_SLOT));
+	ASSERT_TRUE(same(devices[0], loaded[0]));
+	ASSERT_EQ(DEVICE_NONE, loaded[1].deviceFunction);
+	ASSERT_EQ(DEVICE_NONE, loaded[2].deviceFunction) << "records after the damaged one are not trusted";
+}
+
+TEST_F(EepromRecordsTest, aRewriteCutShortKeepsTheDevicesBeforeTheCut){
+	DeviceConfig before[MAX_DEVICE_SLOT];
+	memset(before, 0, sizeof(before));
+	for (uint8_t slot=0; slot<12; slot++)
+		before[slot] = device(slot%3 ? DEVICE_HARDWARE_PIN : DEVICE_HARDWARE_ONEWIRE_TEMP, slot);
+	memcpy(devices, before, sizeof(devices));
+	memset(&devices[1], 0, sizeof(DeviceConfig));		// removed, the records after it move down
+	devices[4] = device(DEVICE_HARDWARE_ONEWIRE_TEMP, 20);	// grows, the records after it move up
+	devices[7] = device(DEVICE_HARDWARE_PIN, 21);
+	devices[14] = device(DEVICE_HARDWARE_PIN, 22);
+
+	const eptr_t start = offsetof(EepromFormat, records);
+	const uint16_t size = sizeof(((EepromFormat*)0)->records);
+	static uint8_t oldImage[size], newImage[size];
+	ASSERT_TRUE(EepromRecords::storeDevices(before, MAX_DEVICE_SLOT));
+	eepromAccess.readBlock(oldImage, start, size);
+	ASSERT_TRUE(EepromRecords::storeDevices(devices, MAX_DEVICE_SLOT));
+	eepromAccess.readBlock(newImage, start, size);
+	uint16_t written = EepromRecords::devicesSize(devices, MAX_DEVICE_SLOT);
+
+	// the power fails after each number of bytes of the new records are written over the old ones
+	for (uint16_t cut=0; cut<=written; cut++) {
+		eepromAccess.writeBlock(start, oldImage, size);
+		eepromAccess.writeBlock(start, newImage, cut);
+
+		DeviceConfig loaded[MAX_DEVICE_SLOT];
+		bool complete = EepromRecords::loadDevices(loaded, MAX_DEVICE_SLOT);
+		uint16_t recordEnd = 0;
+		for (uint8_t slot=0; slot<MAX_DEVICE_SLOT; slot++) {
+			recordEnd += EepromRecords::deviceSize(devices[slot]);
+			if (EepromRecords::deviceSize(devices[slot]) && recordEnd<=cut) {
+				ASSERT_TRUE(same(devices[slot], loaded[slot])) << "slot " << int(slot) << " cut at " << cut;
+			}
+			else {
+				ASSERT_TRUE(same(devices[slot], loaded[slot]) || same(before[slot], loaded[slot])
+					|| loaded[slot].deviceFunction==DEVICE_NONE) << "slot " << int(slot) << " cut at " << cut;
+			}
+		}
+		if (complete) {
+			ASSERT_TRUE(!memcmp(devices, loaded, sizeof(loaded)) || !memcmp(before, loaded, sizeof(loaded))) << "cut at " << cut;
+		}
+		if (cut==written) {
+			ASSERT_TRUE(complete);
+		}
+	}
+}
+
+#endif
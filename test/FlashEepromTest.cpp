@@ -0,0 +1,211 @@
+/*
+ * Copyright 2013 BrewPi/Elco Jacobs.
+ * Copyright 2013 Matthew McGowan.
+ *
+ * This file is part of BrewPi.
+ * 
+ * BrewPi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * BrewPi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with BrewPi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gtest/gtest.h"
+#include "FlashEeprom.h"
+
+/*
+ * A NOR flash in RAM. Programming can only clear bits, and attempts to set them are counted. The time the flash
+ * would be busy is added up from typical SPI flash timings, and the power can be cut after a number of bytes.
+ */
+class SimulatedFlash : public FlashDevice {
+public:
+	static const uint16_t SECTOR_SIZE = 4096;
+	static const uint8_t SECTORS = 4;
+	static const uint32_t ERASE_MICROS = 25000;		// per sector
+	static const uint32_t PROGRAM_MICROS = 10;		// per byte
+	static const uint16_t ERASE_COST = 64;			// bytes of the power budget an erase takes
+
+	uint8_t data[SECTORS*SECTOR_SIZE];
+	uint32_t erases[SECTORS];
+	uint32_t programmed;		// bytes
+	uint32_t busyMicros;
+	uint32_t violations;		// bits that were programmed from 0 to 1
+	int32_t power;			// bytes until the power fails, -1 for no limit
+
+	SimulatedFlash() : programmed(0), busyMicros(0), violations(0), power(-1) {
+		memset(data, 0, sizeof(data));		// a new flash isn't formatted
+		memset(erases, 0, sizeof(erases));
+	}
+
+	uint16_t sectorSize() { return SECTOR_SIZE; }
+	uint8_t sectorCount() { return SECTORS; }
+
+	void read(uint32_t address, void* target, uint16_t size) {
+		memcpy(target, data+address, size);
+	}
+
+	void program(uint32_t address, const void* source, uint16_t size) {
+		const uint8_t* bytes = (const uint8_t*)source;
+		for (uint16_t i=0; i<size && power!=0; i++) {
+			if (power>0)
+				power--;
+			uint8_t set = bytes[i] & ~data[address+i];
+			for (; set; set &= set-1)
+				violations++;
+			data[address+i] &= bytes[i];
+			programmed++;
+			busyMicros += PROGRAM_MICROS;
+		}
+	}
+
+	void eraseSector(uint8_t sector) {
+		if (power==0)
+			return;
+		if (power>0 && power<ERASE_COST) {
+			// cut short, half of the sector is erased
+			memset(data+sector*SECTOR_SIZE+SECTOR_SIZE/2, 0xFF, SECTOR_SIZE/2);
+			power = 0;
+			return;
+		}
+		if (power>0)
+			power -= ERASE_COST;
+		memset(data+sector*SECTOR_SIZE, 0xFF, SECTOR_SIZE);
+		erases[sector]++;
+		busyMicros += ERASE_MICROS;
+	}
+
+	bool powerFailed() { return power==0; }
+	void restorePower() { power = -1; }
+};
+
+static void fillPage(FlashEeprom& eeprom, uint8_t page, uint8_t value) {
+	uint8_t data[FlashEeprom::PAGE_SIZE];
+	memset(data, value, sizeof(data));
+	eeprom.writeBlock(page*FlashEeprom::PAGE_SIZE, data, sizeof(data));
+}
+
+static bool pageIs(FlashEeprom& eeprom, uint8_t page, uint8_t value) {
+	for (uint8_t i=0; i<FlashEeprom::PAGE_SIZE; i++) {
+		if (eeprom.readByte(page*FlashEeprom::PAGE_SIZE+i)!=value)
+			return false;
+	}
+	return true;
+}
+
+TEST(FlashEepromTest, contentsSurviveRestart){
+	SimulatedFlash flash;
+	FlashEeprom eeprom(flash);
+	eeprom.init();
+	ASSERT_EQ(0xFF, eeprom.readByte(0)) << "a new eeprom is erased";
+	ASSERT_EQ(0xFF, eeprom.readByte(FlashEeprom::EEPROM_SIZE-1));
+
+	eeprom.writeByte(0, 5);
+	eeprom.writeBlock(100, "brewpi", 6);
+	eeprom.flush();
+
+	FlashEeprom restarted(flash);
+	restarted.init();
+	char text[6];
+	restarted.readBlock(text, 100, sizeof(text));
+	ASSERT_EQ(5, restarted.readByte(0));
+	ASSERT_EQ(0, memcmp("brewpi", text, sizeof(text)));
+	ASSERT_EQ(0xFF, restarted.readByte(200));
+	ASSERT_EQ(0u, flash.violations);
+}
+
+TEST(FlashEepromTest, writesAreBatchedUntilFlush){
+	SimulatedFlash flash;
+	FlashEeprom eeprom(flash);
+	eeprom.init();
+	uint32_t programmed = flash.programmed;
+
+	for (uint8_t i=0; i<10; i++)
+		eeprom.writeByte(i, i);
+	eeprom.writeByte(FlashEeprom::PAGE_SIZE, 1);
+	ASSERT_EQ(programmed, flash.programmed) << "nothing is written before the flush";
+	ASSERT_TRUE(eeprom.isDirty());
+
+	eeprom.flush();
+	ASSERT_FALSE(eeprom.isDirty());
+	ASSERT_EQ(programmed+2*(FlashEeprom::PAGE_SIZE+4), flash.programmed) << "one slot per changed page";
+
+	eeprom.writeByte(3, 3);
+	ASSERT_FALSE(eeprom.isDirty()) << "unchanged bytes don't mark the page";
+}
+
+TEST(FlashEepromTest, erasesAreLevelledOverTheSectors){
+	SimulatedFlash flash;
+	FlashEeprom eeprom(flash);
+	eeprom.init();
+	for (uint8_t page=0; page<FlashEeprom::PAGE_COUNT; page++)
+		fillPage(eeprom, page, page);
+	eeprom.flush();
+
+	uint32_t busy = flash.busyMicros;
+	const uint16_t flushes = 5000;
+	for (uint16_t i=0; i<flushes; i++) {
+		eeprom.writeByte(40, uint8_t(i));
+		eeprom.writeByte(41, uint8_t(i>>8));
+		eeprom.flush();
+	}
+	busy = flash.busyMicros-busy;
+	ASSERT_LT(busy/flushes, 1000u) << "a flush of one page takes less than 1 ms, erases included";
+
+	uint32_t least = flash.erases[0], most = flash.erases[0];
+	for (uint8_t s=0; s<SimulatedFlash::SECTORS; s++) {
+		least = std::min(least, flash.erases[s]);
+		most = std::max(most, flash.erases[s]);
+		ASSERT_EQ(flash.erases[s], eeprom.eraseCount(s)) << "the header holds the erase count";
+	}
+	ASSERT_GT(least, 10u);
+	ASSERT_LE(most-least, 1u);
+	ASSERT_EQ(0u, flash.violations);
+
+	FlashEeprom restarted(flash);
+	restarted.init();
+	ASSERT_EQ(uint8_t(flushes-1), restarted.readByte(40));
+	ASSERT_EQ(uint8_t((flushes-1)>>8), restarted.readByte(41));
+	ASSERT_TRUE(pageIs(restarted, 5, 5)) << "pages that didn't change are copied forward";
+}
+
+TEST(FlashEepromTest, powerLossKeepsTheOtherPages){
+	// cut the power at many points, including while sectors are reclaimed
+	for (int32_t cut=0; cut<16000; cut+=37) {
+		SimulatedFlash flash;
+		FlashEeprom eeprom(flash);
+		eeprom.init();
+		for (uint8_t page=0; page<FlashEeprom::PAGE_COUNT; page++)
+			fillPage(eeprom, page, page);
+		eeprom.flush();
+
+		flash.power = cut;
+		uint16_t value = 0;
+		do {
+			value++;
+			fillPage(eeprom, 0, 100+value);
+			eeprom.flush();
+		} while (!flash.powerFailed());
+		flash.restorePower();
+
+		FlashEeprom restarted(flash);
+		restarted.init();
+		ASSERT_TRUE(pageIs(restarted, 0, 100+value) || pageIs(restarted, 0, value>1 ? 100+value-1 : 0)) << "cut at " << cut;
+		for (uint8_t page=1; page<FlashEeprom::PAGE_COUNT; page++)
+			ASSERT_TRUE(pageIs(restarted, page, page)) << "page " << int(page) << " cut at " << cut;
+
+		fillPage(restarted, 1, 0xAA);
+		restarted.flush();
+		FlashEeprom again(flash);
+		again.init();
+		ASSERT_TRUE(pageIs(again, 1, 0xAA)) << "cut at " << cut;
+		ASSERT_EQ(0u, flash.violations) << "cut at " << cut;
+	}
+}
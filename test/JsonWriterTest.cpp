@@ -0,0 +1,65 @@
+/*
+ * Copyright 2013 BrewPi/Elco Jacobs.
+ * Copyright 2013 Matthew McGowan.
+ *
+ * This file is part of BrewPi.
+ * 
+ * BrewPi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * BrewPi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with BrewPi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gtest/gtest.h"
+#include "JsonWriter.h"
+
+class StringCapture : public Print {
+public:
+	char data[64];
+	uint8_t length;
+
+	StringCapture() : length(0) { data[0] = 0; }
+
+	size_t write(uint8_t c) {
+		data[length++] = c;
+		data[length] = 0;
+		return 1;
+	}
+	using Print::write;
+};
+
+TEST(JsonWriterTest, formatDigitsMatchesPrintf){
+	char digits[11];
+	char expected[11];
+	const uint32_t values[] = { 0, 1, 9, 10, 99, 100, 255, 1000, 32767, 65535, 100000, 999999, 4294967295ul };
+	for (uint8_t i=0; i<sizeof(values)/sizeof(values[0]); i++) {
+		digits[JsonWriter::formatDigits(digits, values[i])] = 0;
+		snprintf(expected, sizeof(expected), "%lu", (unsigned long)values[i]);
+		ASSERT_STREQ(expected, digits);
+	}
+	digits[JsonWriter::formatDigits(digits, 7, 3)] = 0;
+	ASSERT_STREQ("007", digits) << "padded to the minimum number of digits";
+}
+
+TEST(JsonWriterTest, writesPairs){
+	StringCapture capture;
+	JsonWriter::writeKey(capture, PSTR("a"), true);
+	JsonWriter::writeSigned(capture, -1234);
+	JsonWriter::writeKey(capture, PSTR("b"), false);
+	JsonWriter::writeString(capture, "x");
+	JsonWriter::writeKey(capture, PSTR("c"), false);
+	JsonWriter::writeString(capture, NULL);
+	JsonWriter::writeKey(capture, PSTR("d"), false);
+	JsonWriter::writeChar(capture, 'b');
+	JsonWriter::writeKey(capture, PSTR("e"), false);
+	JsonWriter::writeSigned(capture, -2147483647l-1);
+	ASSERT_STREQ("{\"a\":-1234,\"b\":\"x\",\"c\":null,\"d\":\"b\",\"e\":-2147483648", capture.data);
+}
@@ -0,0 +1,35 @@
+/*
+ * Copyright 2013 BrewPi/Elco Jacobs.
+ * Copyright 2013 Matthew McGowan.
+ *
+ * This file is part of BrewPi.
+ * 
+ * BrewPi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * BrewPi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with BrewPi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gtest/gtest.h"
+#include "OneWireReconnect.h"
+
+TEST(OneWireReconnectTest, firstReconnectIsAfterTheInitialDelay){
+	ASSERT_EQ(ticks_millis_t(0), oneWireReconnectDelay(0)) << "A sensor that just disconnected is retried straight away";
+	ASSERT_EQ(ticks_millis_t(ONEWIRE_RECONNECT_DELAY), oneWireReconnectDelay(1)) << "The first failed attempt waits the initial delay";
+	ASSERT_EQ(ticks_millis_t(ONEWIRE_RECONNECT_DELAY)*2, oneWireReconnectDelay(2)) << "Each further failure doubles the delay";
+}
+
+TEST(OneWireReconnectTest, reconnectDelayIsLimited){
+	ticks_millis_t longest = ticks_millis_t(ONEWIRE_RECONNECT_DELAY) << ONEWIRE_RECONNECT_MAX_BACKOFF;
+	ASSERT_EQ(longest, oneWireReconnectDelay(ONEWIRE_RECONNECT_MAX_BACKOFF+1));
+	ASSERT_EQ(longest, oneWireReconnectDelay(ONEWIRE_RECONNECT_MAX_BACKOFF+2));
+	ASSERT_EQ(longest, oneWireReconnectDelay(255));
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright 2013 BrewPi/Elco Jacobs.
+ * Copyright 2013 Matthew McGowan.
+ *
+ * This file is part of BrewPi.
+ * 
+ * BrewPi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * BrewPi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with BrewPi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gtest/gtest.h"
+#include "PiLinkFrames.h"
+
+class FrameCapture : public Print {
+public:
+	uint8_t data[256];
+	uint8_t length;
+
+	FrameCapture() : length(0) {}
+
+	size_t write(uint8_t c) {
+		data[length++] = c;
+		return 1;
+	}
+	using Print::write;
+};
+
+// decodes the COBS frame in the capture, without the terminating zero
+static uint8_t decode(const FrameCapture& capture, uint8_t* out) {
+	uint8_t length = 0;
+	uint8_t i = 0;
+	while (i<capture.length-1) {
+		uint8_t code = capture.data[i++];
+		for (uint8_t j=1; j<code; j++)
+			out[length++] = capture.data[i++];
+		if (i<capture.length-1)
+			out[length++] = 0;
+	}
+	return length;
+}
+
+TEST(PiLinkFramesTest, crc16){
+	const char* check = "123456789";
+	uint16_t crc = 0xFFFF;
+	while (*check)
+		crc = PiLinkFrames::crc16(crc, *check++);
+	ASSERT_EQ(0x29B1, crc) << "CRC-16/CCITT check value";
+}
+
+TEST(PiLinkFramesTest, frameHasNoZerosAndDecodes){
+	FrameCapture capture;
+	PiLinkFrames::init(capture);
+	PiLinkFrames::begin('S');
+	PiLinkFrames::write(0);
+	PiLinkFrames::write16(0x1200);
+	PiLinkFrames::writeString("ab");
+	PiLinkFrames::end();
+
+	ASSERT_EQ(0, capture.data[capture.length-1]) << "frame is terminated by a zero";
+	for (uint8_t i=0; i<capture.length-1; i++)
+		ASSERT_NE(0, capture.data[i]) << "no zeros inside the frame";
+
+	uint8_t frame[256];
+	uint8_t length = decode(capture, frame);
+	const uint8_t expected[] = { 'S', 0, 0x00, 0x12, 2, 'a', 'b' };
+	ASSERT_EQ(sizeof(expected)+2, length);
+	ASSERT_EQ(0, memcmp(expected, frame, sizeof(expected)));
+
+	uint16_t crc = 0xFFFF;
+	for (uint8_t i=0; i<sizeof(expected); i++)
+		crc = PiLinkFrames::crc16(crc, expected[i]);
+	ASSERT_EQ(crc, frame[length-2] | (frame[length-1]<<8)) << "CRC is appended low byte first";
+}
+
+TEST(PiLinkFramesTest, longTextIsSplit){
+	FrameCapture capture;
+	PiLinkFrames::init(capture);
+	for (uint16_t i=0; i<PILINK_FRAME_SIZE; i++)
+		PiLinkFrames::writeText('x');
+	ASSERT_GT(capture.length, PILINK_FRAME_SIZE) << "a full text frame is sent";
+	uint8_t sent = capture.length;
+	PiLinkFrames::writeText('\n');
+	ASSERT_GT(capture.length, sent) << "the rest of the line is sent at the line end";
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright 2013 BrewPi/Elco Jacobs.
+ * Copyright 2013 Matthew McGowan.
+ *
+ * This file is part of BrewPi.
+ * 
+ * BrewPi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * BrewPi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with BrewPi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gtest/gtest.h"
+#include "PiLink.h"
+#include "TempControl.h"
+#include "TemperatureFormats.h"
+#include <string>
+
+class PiLinkTest : public ::testing::Test {
+protected:
+	static void SetUpTestCase() {
+		setenv("BREWPI_EEPROM", "/dev/null", 1);	// keep the eeprom in memory
+		PiLink::init();
+		tempControl.init();		// the temperature replies read the default sensors
+	}
+
+	/* Feeds the characters to piLink as if they came in on the serial port. */
+	static void receive(const std::string& input) {
+		for (size_t i=0; i<input.size(); i++)
+			PiLink::receiveChar(input[i]);
+	}
+
+	static uint8_t converterCount() { return PiLink::jsonParserConverterCount; }
+	static const char* converterKey(uint8_t i) { return PiLink::jsonParserConverters[i].key; }
+	static const void* findConverter(const char* key) {
+		PiLink::JsonParserConvert converter;
+		if (!PiLink::findJsonParserConverter(key, converter))
+			return NULL;
+		return converter.key;
+	}
+};
+
+TEST_F(PiLinkTest, jsonParserConvertersAreSorted){
+	for (uint8_t i=1; i<converterCount(); i++)
+		ASSERT_LT(strcmp(converterKey(i-1), converterKey(i)), 0) << converterKey(i) << " is out of order";
+}
+
+TEST_F(PiLinkTest, everySettingKeyIsFound){
+	for (uint8_t i=0; i<converterCount(); i++)
+		ASSERT_EQ(converterKey(i), findConverter(converterKey(i)));
+	ASSERT_EQ(NULL, findConverter("beerSe"));
+	ASSERT_EQ(NULL, findConverter("A"));
+	ASSERT_EQ(NULL, findConverter("z"));
+	ASSERT_EQ(NULL, findConverter(""));
+}
+
+TEST_F(PiLinkTest, settingsLargerThanTheCommandBufferAreApplied){
+	const char* constants = "\"tempSetMin\": 1.0, \"tempSetMax\": 30.0, \"pidMax\": 10.000, \"Kp\": 5.000, "
+		"\"Ki\": 0.250, \"Kd\": -1.500, \"iMaxErr\": 0.500, \"idleRangeH\": 1.000, \"idleRangeL\": -1.000, "
+		"\"heatTargetH\": 0.299, \"heatTargetL\": -0.199, \"coolTargetH\": 0.199, \"coolTargetL\": -0.299, "
+		"\"maxHeatTimeForEst\": 600, \"maxCoolTimeForEst\": 1200, \"lah\": 0, \"hs\": 0, ";
+	std::string json = "j{";
+	while (json.size()<PILINK_COMMAND_SIZE*3)
+		json += constants;
+	json += "\"Kp\": 7.500, \"maxCoolTimeForEst\": 900}";
+
+	tempControl.cc.Kp = 0;
+	tempControl.cc.tempSettingMax = 0;
+	receive(json);
+	ASSERT_EQ(stringToFixedPoint("7.5"), tempControl.cc.Kp) << "the last part of the object was applied";
+	ASSERT_EQ(900, tempControl.cc.maxCoolTimeForEstimate);
+	ASSERT_EQ(stringToTemp("30.0"), tempControl.cc.tempSettingMax) << "the first part of the object was applied";
+}
+
+TEST_F(PiLinkTest, aCommandWithARequestIdIsRunOnce){
+	PiLink::flush();
+	testing::internal::CaptureStdout();
+	receive("#5t");
+	PiLink::flush();
+	std::string output = testing::internal::GetCapturedStdout();
+
+	size_t reply = output.find("T#5:{");
+	ASSERT_NE(std::string::npos, reply) << output;
+	size_t ack = output.find("K#5:{}", reply);
+	ASSERT_NE(std::string::npos, ack) << output;
+	ASSERT_EQ(std::string::npos, output.find("T", reply+1)) << "the command ran twice: " << output;
+	ASSERT_EQ(std::string::npos, output.find("K", ack+1)) << output;
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2013 BrewPi/Elco Jacobs.
+ * Copyright 2013 Matthew McGowan.
+ *
+ * This file is part of BrewPi.
+ * 
+ * BrewPi is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * BrewPi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with BrewPi.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gtest/gtest.h"
+#include "PiLinkTxBuffer.h"
+
+class PortCapture : public Print {
+public:
+	uint8_t data[PILINK_TX_BUFFER_SIZE*2];
+	uint16_t length;
+
+	PortCapture() : length(0) {}
+
+	size_t write(uint8_t c) {
+		data[length++] = c;
+		return 1;
+	}
+	using Print::write;
+};
+
+TEST(PiLinkTxBufferTest, sendsAChunkPerPass){
+	PortCapture port;
+	PiLinkTxBuffer tx;
+	tx.init(port);
+	for (uint16_t i=0; i<PILINK_TX_CHUNK+10; i++)
+		tx.write(uint8_t(i));
+	ASSERT_EQ(0, port.length) << "output is only sent by transmit()";
+
+	tx.transmit();
+	ASSERT_EQ(PILINK_TX_CHUNK, port.length);
+	tx.transmit();
+	ASSERT_EQ(PILINK_TX_CHUNK+10, port.length);
+	ASSERT_EQ(0, tx.pending());
+	for (uint16_t i=0; i<port.length; i++)
+		ASSERT_EQ(uint8_t(i), port.data[i]);
+}
+
+TEST(PiLinkTxBufferTest, sendsNoMoreThanThePortHasRoomFor){
+	PortCapture port;
+	PiLinkTxBuffer tx;
+	tx.init(port);
+	uint16_t written = 0;
+	for (; written<PILINK_TX_HIGH_WATERMARK+1; written++)
+		tx.write(uint8_t(written));
+
+	tx.transmit(10);
+	ASSERT_EQ(10, port.length) << "the high watermark doesn't apply when the room is known";
+	tx.transmit(0);
+	ASSERT_EQ(10, port.length);
+	tx.transmit(PILINK_TX_BUFFER_SIZE);
+	ASSERT_EQ(written, port.length);
+	ASSERT_EQ(0, tx.pending());
+}
+
+TEST(PiLinkTxBufferTest, drainsToLowWatermarkAfterWrapAround){
+	PortCapture port;
+	PiLinkTxBuffer tx;
+	tx.init(port);
+	uint16_t written = 0;
+	// move the start of the buffer, so the output wraps around the end
+	for (; written<100; written++)
+		tx.write(uint8_t(written));
+	tx.flush();
+	for (; written<100+PILINK_TX_HIGH_WATERMARK+1; written++)
+		tx.write(uint8_t(written));
+
+	tx.transmit();
+	ASSERT_EQ(PILINK_TX_LOW_WATERMARK, tx.pending());
+	tx.flush();
+	ASSERT_EQ(written, port.length);
+	for (uint16_t i=0; i<port.length; i++)
+		ASSERT_EQ(uint8_t(i), port.data[i]);
+	ASSERT_EQ(PILINK_TX_HIGH_WATERMARK+1, tx.peakPending());
+}
+
+TEST(PiLinkTxBufferTest, spillsOldestBytesWhenFull){
+	PortCapture port;
+	PiLinkTxBuffer tx;
+	tx.init(port);
+	for (uint16_t i=0; i<PILINK_TX_BUFFER_SIZE+3; i++)
+		tx.write(uint8_t(i));
+
+	ASSERT_EQ(3, port.length) << "the oldest bytes are written to the port when the buffer is full";
+	ASSERT_EQ(3, tx.spilledBytes());
+	ASSERT_EQ(PILINK_TX_BUFFER_SIZE, tx.pending());
+	tx.flush();
+	for (uint16_t i=0; i<port.length; i++)
+		ASSERT_EQ(uint8_t(i), port.data[i]) << "no output is lost or reordered";
+}
@@ -157,4 +157,27 @@ TEST(TemperatureFormatsTest, tenthsToFixed){
     tempControl.cc.tempFormat = 'F';
     ASSERT_EQ(intToTemp(20), tenthsToFixed(680)) << "Test converting tenths 680 in Fahrenheit to internal temp format";
     ASSERT_EQ(intToTemp(20) + intToTempDiff(5)/10, tenthsToFixed(689)) << "Test converting tenths 689 in Fahrenheit to internal temp format";
-}
\ No newline at end of file
+}
+TEST(TemperatureFormatsTest, fixedPointToStringMatchesPrintf){
+    // fixedPointToString used to format with printf, the output must not change
+    char result[12];
+    char expected[12];
+    static const char* formats[] = { "%ld.%01d", "%ld.%02d", "%ld.%03d" };
+    static const uint16_t scales[] = { 10, 100, 1000 };
+    for (long_temperature value = -32768; value <= 32767; value++) {
+        for (uint8_t decimals = 1; decimals <= 3; decimals++) {
+            long_temperature magnitude = value < 0 ? -value : value;
+            long intPart = magnitude >> TEMP_FIXED_POINT_BITS;
+            uint16_t scale = scales[decimals-1];
+            uint16_t fracPart = ((magnitude & TEMP_FIXED_POINT_MASK) * scale + TEMP_FIXED_POINT_SCALE/2) >> TEMP_FIXED_POINT_BITS;
+            if (fracPart >= scale) {
+                intPart++;
+                fracPart = 0;
+            }
+            expected[0] = value < 0 ? '-' : ' ';
+            snprintf(&expected[1], 11, formats[decimals-1], intPart, fracPart);
+            ASSERT_STREQ(expected, fixedPointToString(result, value, decimals, 12)) << "value " << value << ", decimals " << int(decimals);
+        }
+    }
+    ASSERT_STREQ(" 12", fixedPointToString(result, intToTempDiff(12), 3, 4)) << "Test that the string is cut off at maxLength";
+}